@@ -1,9 +1,9 @@
 #include "Acrobot.h"
-#include "EvolutionParams.h"
+#include "Random.h"
 #include <random>
 #include "imgui_helpers.h"
 
-Acrobot::Acrobot(bool aStartUp, double aVariance)
+Acrobot::Acrobot(bool aStartUp, double aVariance, Neat::Random& aRandom)
 {
 	myInitState[0] = aStartUp ? PI : 0.0;
 	myInitState[1] = 0.0;
@@ -12,10 +12,10 @@ Acrobot::Acrobot(bool aStartUp, double aVariance)
 	if (aVariance > DBL_EPSILON)
 	{
 		std::uniform_real_distribution<> rand(-aVariance, aVariance);
-		myInitState[0] += rand(Neat::EvolutionParams::GetRandomGenerator()) * PI;
-		myInitState[1] += rand(Neat::EvolutionParams::GetRandomGenerator()) * PI;
-		myInitState[2] += rand(Neat::EvolutionParams::GetRandomGenerator()) * 3.0;
-		myInitState[3] += rand(Neat::EvolutionParams::GetRandomGenerator()) * 3.0;
+		myInitState[0] += rand(aRandom) * PI;
+		myInitState[1] += rand(aRandom) * PI;
+		myInitState[2] += rand(aRandom) * 3.0;
+		myInitState[3] += rand(aRandom) * 3.0;
 	}
 	Reset();
 }
@@ -26,6 +26,33 @@ void Acrobot::Reset()
 	myState[1] = myInitState[1];
 	myState[2] = myInitState[2];
 	myState[3] = myInitState[3];
+	myActionForce = 0.0;
+	myStepIdx = 0;
+}
+
+void Acrobot::Observe(std::span<double> someOutObservations) const
+{
+	someOutObservations[0] = GetPole1Angle();
+	someOutObservations[1] = GetPole2Angle();
+	someOutObservations[2] = GetPole1Velocity();
+	someOutObservations[3] = GetPole2Velocity();
+}
+
+void Acrobot::Act(std::span<const double> someActions)
+{
+	myActionForce = 0.0;
+	if (someActions[0] > someActions[1] && someActions[0] > someActions[2])
+		myActionForce = -1.0;
+	else if (someActions[2] > someActions[0] && someActions[2] > someActions[1])
+		myActionForce = +1.0;
+}
+
+double Acrobot::Step()
+{
+	Update(myActionForce, myDeltaTime);
+	myStepIdx++;
+
+	return ArePolesUp() ? 1.0 : 0.0;
 }
 
 void Acrobot::Update(double aForceAmplitude, double aDeltaTime)
@@ -1,12 +1,28 @@
 #pragma once
 
+#include "Environment.h"
+
+namespace Neat { class Random; }
+
 #define PI 3.14159265358979323846
 
-class Acrobot
+class Acrobot : public Neat::Environment
 {
 public:
-	Acrobot(bool aStartUp, double aVariance);
-	void Reset();
+	Acrobot(bool aStartUp, double aVariance, Neat::Random& aRandom);
+	void Reset() override;
+
+	// Neat::Environment, the steps where both poles are up are rewarded
+	size_t GetObservationsCount() const override { return 4; }
+	size_t GetActionsCount() const override { return 3; }
+	void Observe(std::span<double> someOutObservations) const override;
+	void Act(std::span<const double> someActions) override;
+	double Step() override;
+	bool IsDone() const override { return myStepIdx >= myMaxSteps; }
+	double GetRewardBound() const override { return static_cast<double>(myMaxSteps - myStepIdx); } // At most 1 per step
+
+	double GetActionForce() const { return myActionForce; } // Amplitude chosen by the last Act
+	uint GetMaxSteps() const { return myMaxSteps; }
 	void Update(double aForceAmplitude, double aDeltaTime);
 	void Draw();
 
@@ -21,6 +37,8 @@ public:
 	bool ArePolesSlow() const;
 
 private:
+	friend class AcrobotBatch;
+
 	void Step(double* dydt, double* y, double aForce);
 
 	// Runge - Kutta 4th order integration method
@@ -41,6 +59,11 @@ private:
 	// 3 : Pole2Velosity
 	double myState[4];
 	double myInitState[4];
+
+	double myActionForce = 0.0;
+	double myDeltaTime = 0.02;
+	uint myMaxSteps = 1250; // 25 seconds
+	uint myStepIdx = 0;
 };
 
 typedef std::vector<Acrobot> Acrobots;
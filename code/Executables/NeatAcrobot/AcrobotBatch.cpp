@@ -0,0 +1,176 @@
+#include "AcrobotBatch.h"
+
+AcrobotBatch::AcrobotBatch(const Acrobots& someSystems)
+{
+	Assert(!someSystems.empty());
+
+	const Acrobot& params = someSystems.front();
+	myPole1Length = params.myPole1Length;
+	myPole2Length = params.myPole2Length;
+	myPole1Mass = params.myPole1Mass;
+	myPole2Mass = params.myPole2Mass;
+	myGravity = params.myGravity;
+	myInputForce = params.myInputForce;
+	myPoleFriction = params.myPoleFriction;
+	myPoleFailureAngle = params.myPoleFailureAngle;
+	myDeltaTime = params.myDeltaTime;
+	myMaxSteps = params.myMaxSteps;
+
+	const size_t count = someSystems.size();
+	myInitStates.resize(ourStateSize * count);
+	for (size_t s = 0; s < count; ++s)
+	{
+		for (size_t i = 0; i < ourStateSize; ++i)
+			myInitStates[i * count + s] = someSystems[s].myInitState[i];
+	}
+
+	myStates.resize(ourStateSize * count);
+	myWrappedPoleAngles.resize(2 * count);
+	myActionForces.resize(count);
+	myK1.resize(ourStateSize * count);
+	myK2.resize(ourStateSize * count);
+	myK3.resize(ourStateSize * count);
+	myK4.resize(ourStateSize * count);
+	myTmp.resize(ourStateSize * count);
+	Reset();
+}
+
+void AcrobotBatch::Reset()
+{
+	myStates = myInitStates;
+	std::fill(myActionForces.begin(), myActionForces.end(), 0.0);
+	WrapPoleAngles();
+	myStepIdx = 0;
+}
+
+void AcrobotBatch::Observe(std::span<double> someOutObservations) const
+{
+	const size_t count = GetBatchSize();
+	const double* y = myStates.data();
+	double* observations = someOutObservations.data();
+
+	for (size_t s = 0; s < count; ++s)
+	{
+		observations[s] = myWrappedPoleAngles[s];
+		observations[count + s] = myWrappedPoleAngles[count + s];
+		observations[2 * count + s] = y[2 * count + s];
+		observations[3 * count + s] = y[3 * count + s];
+	}
+}
+
+void AcrobotBatch::Act(std::span<const double> someActions)
+{
+	const size_t count = GetBatchSize();
+	const double* actions0 = someActions.data();
+	const double* actions1 = actions0 + count;
+	const double* actions2 = actions1 + count;
+
+	for (size_t s = 0; s < count; ++s)
+	{
+		bool isLeft = actions0[s] > actions1[s] && actions0[s] > actions2[s];
+		bool isRight = actions2[s] > actions0[s] && actions2[s] > actions1[s];
+		myActionForces[s] = isLeft ? -1.0 : (isRight ? 1.0 : 0.0);
+	}
+}
+
+double AcrobotBatch::Step()
+{
+	RK4(myDeltaTime);
+	WrapPoleAngles();
+	myStepIdx++;
+
+	// Same as Acrobot::ArePolesUp
+	const size_t count = GetBatchSize();
+	double reward = 0.0;
+	for (size_t s = 0; s < count; ++s)
+	{
+		bool isPole1Up = std::abs(myWrappedPoleAngles[s]) < myPoleFailureAngle;
+		bool isPole2Up = std::abs(myWrappedPoleAngles[count + s]) < myPoleFailureAngle;
+		reward += isPole1Up && isPole2Up ? 1.0 : 0.0;
+	}
+	return reward;
+}
+
+void AcrobotBatch::WrapPoleAngles()
+{
+	const size_t count = GetBatchSize();
+	const double* y = myStates.data();
+
+	// Same as Acrobot::GetPole1Angle and Acrobot::GetPole2Angle
+	for (size_t s = 0; s < count; ++s)
+	{
+		double pole1Angle = PI - y[s];
+		double pole2Angle = PI - y[s] + y[count + s];
+		myWrappedPoleAngles[s] = std::atan2(std::sin(pole1Angle), std::cos(pole1Angle));
+		myWrappedPoleAngles[count + s] = std::atan2(std::sin(pole2Angle), std::cos(pole2Angle));
+	}
+}
+
+void AcrobotBatch::ComputeDerivatives(double* dydt, const double* y) const
+{
+	const size_t count = GetBatchSize();
+
+	const double I1 = myPole1Mass * myPole1Length * myPole1Length;
+	const double I2 = myPole2Mass * myPole2Length * myPole2Length;
+
+	for (size_t s = 0; s < count; ++s)
+	{
+		double angle1 = y[s];
+		double angle2 = y[count + s];
+		double velocity1 = y[2 * count + s];
+		double velocity2 = y[3 * count + s];
+
+		double sin1 = std::sin(angle1);
+		double cos1 = std::cos(angle1);
+		double sin2 = std::sin(angle2);
+		double cos2 = std::cos(angle2);
+		double sin1p2 = sin1 * cos2 + cos1 * sin2; // Two sin/cos pairs instead of three calls
+
+		double m1 = I1 + I2 + myPole2Mass * myPole1Length * myPole1Length + myPole2Mass * myPole1Length * myPole2Length * cos2;
+		double m2 = I2 + myPole2Mass * myPole1Length * 0.5 * myPole2Length * cos2;
+		double m3 = I2;
+		double c1 = myPole2Mass * myPole1Length * 0.5 * myPole2Length * sin2;
+		double f2 = myPole2Mass * myGravity * myPole2Length * sin1p2;
+		double f1 = (myPole1Mass * 0.5 * myPole1Length + myPole2Mass * myPole1Length) * myGravity * sin1 + f2;
+
+		// M * ddy = H - G - C * dy, solved in closed form instead of inverting M.
+		// C * dy is (-c1 * v1 * v2, -c1 * v1 * v2) with the column major C of Acrobot::Step.
+		double cdy = c1 * velocity1 * velocity2;
+		double b1 = cdy - f1;
+		double b2 = myActionForces[s] * myInputForce - f2 + cdy;
+		double invDeterminant = 1.0 / (m1 * m3 - m2 * m2);
+
+		dydt[s] = velocity1;
+		dydt[count + s] = velocity2;
+		dydt[2 * count + s] = (m3 * b1 - m2 * b2) * invDeterminant - myPoleFriction * velocity1;
+		dydt[3 * count + s] = (m1 * b2 - m2 * b1) * invDeterminant - myPoleFriction * velocity2;
+	}
+}
+
+void AcrobotBatch::RK4(double aDeltaTime)
+{
+	const size_t size = myStates.size();
+	double* y = myStates.data();
+	double* k1 = myK1.data();
+	double* k2 = myK2.data();
+	double* k3 = myK3.data();
+	double* k4 = myK4.data();
+	double* tmp = myTmp.data();
+
+	ComputeDerivatives(k1, y);
+
+	for (size_t i = 0; i < size; ++i)
+		tmp[i] = y[i] + (aDeltaTime / 2.0) * k1[i];
+	ComputeDerivatives(k2, tmp);
+
+	for (size_t i = 0; i < size; ++i)
+		tmp[i] = y[i] + (aDeltaTime / 2.0) * k2[i];
+	ComputeDerivatives(k3, tmp);
+
+	for (size_t i = 0; i < size; ++i)
+		tmp[i] = y[i] + aDeltaTime * k3[i];
+	ComputeDerivatives(k4, tmp);
+
+	for (size_t i = 0; i < size; ++i)
+		y[i] = y[i] + (aDeltaTime / 6.0) * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Acrobot.h"
+
+// Acrobots stepped in lockstep, with one array per state variable so the RK4 steps vectorize over the instances.
+// Steps like Acrobot::Step, the instances share the physical parameters of the first system.
+class AcrobotBatch : public Neat::BatchEnvironment
+{
+public:
+	AcrobotBatch(const Acrobots& someSystems);
+
+	size_t GetBatchSize() const override { return myActionForces.size(); }
+	size_t GetObservationsCount() const override { return 4; }
+	size_t GetActionsCount() const override { return 3; }
+
+	void Reset() override;
+	void Observe(std::span<double> someOutObservations) const override;
+	void Act(std::span<const double> someActions) override;
+	double Step() override;
+	bool IsDone() const override { return myStepIdx >= myMaxSteps; }
+	double GetRewardBound() const override { return static_cast<double>(myMaxSteps - myStepIdx) * GetBatchSize(); }
+
+	uint GetMaxSteps() const { return myMaxSteps; }
+
+private:
+	static constexpr size_t ourStateSize = 4;
+
+	// The states are SoA: the variable i of the instance s is at [i * GetBatchSize() + s], see Acrobot::myState
+	void ComputeDerivatives(double* dydt, const double* y) const;
+
+	// Runge - Kutta 4th order integration method
+	void RK4(double aDeltaTime);
+	void WrapPoleAngles();
+
+	double myPole1Length = 1.0;
+	double myPole2Length = 1.0;
+	double myPole1Mass = 1.0;
+	double myPole2Mass = 1.0;
+	double myGravity = 9.81;
+	double myInputForce = 15.0;
+	double myPoleFriction = 0.0;
+	double myPoleFailureAngle = 0.2094384 * 5.0;
+
+	std::vector<double> myInitStates;
+	std::vector<double> myStates;
+	std::vector<double> myWrappedPoleAngles; // Pole1 then Pole2, in [-PI, PI], computed once per step for the reward and the observations
+	std::vector<double> myActionForces;
+
+	// RK4 scratch states
+	std::vector<double> myK1, myK2, myK3, myK4, myTmp;
+
+	double myDeltaTime = 0.02;
+	uint myMaxSteps = 1250;
+	uint myStepIdx = 0;
+};
+
+typedef std::vector<AcrobotBatch> AcrobotBatchPool;
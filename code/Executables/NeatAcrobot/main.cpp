@@ -1,6 +1,11 @@
 #include "Acrobot.h"
+#include "AcrobotBatch.h"
 
+#include "NeatCartPole/TrainingDashboard.h"
+
+#include "BackgroundTraining.h"
 #include "Genome.h"
+#include "Evaluator.h"
 #include "EvolutionParams.h"
 #include "Specie.h"
 #include "Population.h"
@@ -17,7 +22,14 @@
 #include "imgui_helpers.h"
 
 #include <iostream>
+#include <memory>
 #include <random>
+#include <thread>
+
+#define USE_PRUNING 0 // 1 to stop the evaluations that can't reach the median fitness of the generation anymore, faster but not deterministic
+#define BACKGROUND_TRAINING 1 // 1 to run TrainNeat while the window is open, with a dashboard of the generations and the best genome swapped into the view
+
+void TrainNeat(Neat::BackgroundTraining* aBackgroundTraining = nullptr);
 
 class NeatAcrobotModule : public Core::Module
 {
@@ -41,6 +53,9 @@ private:
 	Acrobot* mySystem = nullptr;
 	bool myNeatControl = false;
 	Neat::Genome* myBalancingGenome = nullptr;
+
+	std::unique_ptr<Neat::BackgroundTraining> myTraining;
+	TrainingDashboard myDashboard;
 };
 
 void NeatAcrobotModule::OnInitialize()
@@ -54,12 +69,19 @@ void NeatAcrobotModule::OnInitialize()
 	myGui = myGuiEntity.AddComponent<Render::EntityGuiComponent>(myWindow, false);
 	myGui->myCallback = [this]() { OnGuiUpdate(); };
 
-	mySystem = new Acrobot(false, 0.0);
+	Neat::Random random(Neat::EvolutionParams::GetRandomSeed(), 1);
+	mySystem = new Acrobot(false, 0.0, random);
 	myBalancingGenome = new Neat::Genome("neat/acrobot");
+
+#if BACKGROUND_TRAINING
+	myTraining = std::make_unique<Neat::BackgroundTraining>();
+	myTraining->Start([this]() { TrainNeat(myTraining.get()); });
+#endif
 }
 
 void NeatAcrobotModule::OnFinalize()
 {
+	myTraining.reset();
 	SafeDelete(myBalancingGenome);
 	SafeDelete(mySystem);
 
@@ -84,23 +106,18 @@ void NeatAcrobotModule::OnUpdate(Core::Module::UpdateType aType)
 			enterPressed = false;
 		}
 
+		// The best genome of the background training takes control as soon as it improves, the system keeps its state
+		if (myTraining)
+			myTraining->GetBestGenome().ConsumeLatest(*myBalancingGenome);
+
 		if (myNeatControl)
 		{
-			std::vector<double> inputs;
-			inputs.push_back(mySystem->GetPole1Angle());
-			inputs.push_back(mySystem->GetPole2Angle());
-			inputs.push_back(mySystem->GetPole1Velocity());
-			inputs.push_back(mySystem->GetPole2Velocity());
-			std::vector<double> outputs;
-			myBalancingGenome->Evaluate(inputs, outputs);
-
-			double force = 0.0;
-			if (outputs[0] > outputs[1] && outputs[0] > outputs[2])
-				force = -1.0;
-			else if (outputs[2] > outputs[0] && outputs[2] > outputs[1])
-				force = +1.0;
-
-			mySystem->Update(force, Core::TimeModule::GetInstance()->GetDeltaTimeSec());
+			double observations[4];
+			double actions[3];
+			mySystem->Observe(observations);
+			myBalancingGenome->Evaluate(observations, actions);
+			mySystem->Act(actions);
+			mySystem->Update(mySystem->GetActionForce(), Core::TimeModule::GetInstance()->GetDeltaTimeSec());
 		}
 		else
 		{
@@ -130,97 +147,79 @@ void NeatAcrobotModule::OnGuiUpdate()
 	{
 		ImGui::Text("Manual control");
 	}
+
+	if (myTraining)
+		myDashboard.Draw(myTraining->GetTelemetry(), myTraining->IsRunning());
 }
 
-void EvaluatePopulationAsync(Thread::WorkerPool& aPool, Acrobots& someSystems, Neat::Population& aPopulation, size_t aStartIdx, size_t aEndIdx)
+double EvaluateGenome(Neat::Genome& aGenome, AcrobotBatch& aBatch, Neat::EpisodeRunner& aRunner, double aFitnessCutoff, bool& anOutIsPruned)
 {
-	aPool.RequestJob([&someSystems, &aPopulation, aStartIdx, aEndIdx]() {
-		for (size_t i = aStartIdx; i < aEndIdx; ++i)
-		{
-			if (Neat::Genome* genome = aPopulation.GetGenome(i))
-			{
-				double fitness = 0.0;
-
-				double deltaTime = 0.02;
-				uint maxSteps = static_cast<uint>(25.0 / deltaTime);
-				double fitnessStep = 1.0 / static_cast<double>(maxSteps * someSystems.size());
-
-				for (Acrobot system : someSystems)
-				{
-					system.Reset();
-
-					for (uint t = 0; t < maxSteps; ++t)
-					{
-						std::vector<double> inputs;
-						inputs.push_back(system.GetPole1Angle());
-						inputs.push_back(system.GetPole2Angle());
-						inputs.push_back(system.GetPole1Velocity());
-						inputs.push_back(system.GetPole2Velocity());
-						std::vector<double> outputs;
-						genome->Evaluate(inputs, outputs);
-
-						double force = 0.0;
-						if (outputs[0] > outputs[1] && outputs[0] > outputs[2])
-							force = -1.0;
-						else if (outputs[2] > outputs[0] && outputs[2] > outputs[1])
-							force = +1.0;
-
-						system.Update(force, deltaTime);
-
-						if (system.ArePolesUp())
-							fitness += fitnessStep;
-					}
-				}
-
-				genome->SetFitness(fitness);
-			}
-		}
-	});
+	// Average ratio of rewarded steps, all the systems are stepped in lockstep
+	double maxReward = static_cast<double>(aBatch.GetMaxSteps()) * aBatch.GetBatchSize();
+	double reward = aRunner.Run(aGenome, aBatch, aFitnessCutoff * maxReward);
+	anOutIsPruned = aRunner.IsPruned();
+	return reward / maxReward;
 }
 
-void TrainNeat()
+void TrainNeat(Neat::BackgroundTraining* aBackgroundTraining /*= nullptr*/)
 {
 	Thread::WorkerPool threadPool(Thread::WorkerPriority::High);
 #if DEBUG_BUILD
 	threadPool.SetWorkersCount(3); // Using several threads is slower in Debug...
 #else
-	threadPool.SetWorkersCount();
+	// The background training leaves a core to the rendering
+	threadPool.SetWorkersCount(aBackgroundTraining ? std::max(std::thread::hardware_concurrency(), 2u) - 1 : UINT_MAX);
 #endif
 
+	// Control tasks don't need double precision, and the float rational backend vectorizes well
+	Neat::EvolutionParams::ourPhenotypePrecision = Neat::Phenotype::Precision::Float;
+	Neat::EvolutionParams::ourPhenotypeActivation = Neat::Phenotype::Activation::Rational;
+
+	// The populations fork their streams from the stream 0
+	Neat::Random random(Neat::EvolutionParams::GetRandomSeed(), 1);
+
 	Acrobots systems;
 	uint systemsCount = 4;
 	systems.reserve(2 * (systemsCount + 1));
-	//systems.push_back(Acrobot(true, 0.0));
+	//systems.push_back(Acrobot(true, 0.0, random));
 	//for (uint i = 0; i < systemsCount; ++i)
-	//	systems.push_back(Acrobot(true, 0.1));
-	systems.push_back(Acrobot(false, 0.0));
+	//	systems.push_back(Acrobot(true, 0.1, random));
+	systems.push_back(Acrobot(false, 0.0, random));
 	//for (uint i = 0; i < systemsCount; ++i)
-	//	systems.push_back(Acrobot(false, 0.1));
+	//	systems.push_back(Acrobot(false, 0.1, random));
 
-	AcrobotPool systemsPool;
-	systemsPool.resize(threadPool.GetWorkersCount(), systems);
+	AcrobotBatchPool systemsPool;
+	systemsPool.resize(threadPool.GetWorkersCount(), AcrobotBatch(systems));
 
 	Neat::Population population = Neat::Population(500, 4, 3);
 	Neat::Population::TrainingCallbacks callbacks;
 
-	callbacks.myEvaluateGenomes = [&population, &threadPool, &systemsPool]() {
-		size_t runPerThread = population.GetSize() / threadPool.GetWorkersCount() + 1;
-		size_t startIdx = 0;
-		uint systemPoolIdx = 0;
-		while (startIdx < population.GetSize())
-		{
-			EvaluatePopulationAsync(threadPool, systemsPool[systemPoolIdx], population, startIdx, startIdx + runPerThread);
-			startIdx = std::min(population.GetSize(), startIdx + runPerThread);
-			systemPoolIdx++;
-		}
-		threadPool.WaitIdle();
-		};
+	callbacks.myParallelFor = [&threadPool](size_t aCount, const std::function<void(size_t)>& aJob) {
+		threadPool.ParallelFor(aCount, aJob);
+	};
+
+	// Every worker resets its own systems and reuses its own buffers, nothing is allocated while evaluating
+	std::vector<Neat::EpisodeRunner> runners(threadPool.GetWorkersCount());
+	Neat::Evaluator evaluator(threadPool.GetWorkersCount(), [&systemsPool, &runners](Neat::Genome& aGenome, size_t aWorkerIdx, double aFitnessCutoff, bool& anOutIsPruned) {
+		return EvaluateGenome(aGenome, systemsPool[aWorkerIdx], runners[aWorkerIdx], aFitnessCutoff, anOutIsPruned);
+	});
+#if USE_PRUNING
+	evaluator.EnablePruning(0.5);
+#endif
+	// The systems are the same at every generation, the fitness only depends on the phenotype
+	population.EnableFitnessCache(true);
+	callbacks.myEvaluateGenomes = [&population, &evaluator, &callbacks]() {
+		evaluator.EvaluateGenomes(population, callbacks.myParallelFor);
+	};
 
 	int generationIdx = 0;
-	callbacks.myOnTrainGenerationEnd = [&population, &generationIdx]() {
+	callbacks.myOnTrainGenerationEnd = [&population, &evaluator, &generationIdx]() {
 		population.Check();
 		std::cout << "Population Size : " << population.GetSize() << std::endl;
 		std::cout << "Species Count : " << population.GetSpecies().size() << std::endl;
+		std::cout << "Evaluation Utilization : " << 100.0 * evaluator.GetStats().GetUtilization() << "%" << std::endl;
+		std::cout << "Pruned Evaluations : " << evaluator.GetStats().myPrunedCount << std::endl;
+		std::cout << "Fitness Cache Hits : " << 100.0 * population.GetFitnessCacheStats().GetHitRate() << "%" << std::endl;
 		if (const Neat::Genome* bestGenome = population.GetBestGenome())
 		{
 			std::cout << "Generation " << generationIdx << ": Best Fitness : " << bestGenome->GetFitness() << std::endl;
@@ -237,11 +236,18 @@ void TrainNeat()
 
 	uint64 startTime = Core::TimeModule::GetInstance()->GetCurrentTimeMs();
 
-	population.TrainGenerations(callbacks, 1000, DBL_MAX);
+	if (aBackgroundTraining)
+		aBackgroundTraining->TrainGenerations(population, callbacks, 1000, DBL_MAX);
+	else
+		population.TrainGenerations(callbacks, 1000, DBL_MAX);
 
 	uint64 duration = Core::TimeModule::GetInstance()->GetCurrentTimeMs() - startTime;
 	std::cout << "Training duration (ms) : " << duration << std::endl;
 
+	// A training interrupted by closing the window doesn't replace the saved genome
+	if (aBackgroundTraining && aBackgroundTraining->IsStopRequested())
+		return;
+
 	if (const Neat::Genome* bestGenome = population.GetBestGenome())
 	{
 		bestGenome->SaveToFile("neat/acrobot");
@@ -259,7 +265,9 @@ int main()
 	unsigned int seed = rd();
 	Neat::EvolutionParams::SetRandomSeed(seed);
 
+#if !BACKGROUND_TRAINING
 	TrainNeat();
+#endif
 
 	Render::RenderModule::Register();
 	NeatAcrobotModule::Register();
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "Core_Defines.h"
+#include "Core_Assert.h"
+#include "Core_glm.h"
+#include "Core_Log.h"
+#include "Core_Utils.h"
@@ -0,0 +1,666 @@
+#include "Genome.h"
+#include "EvolutionParams.h"
+#include "Phenotype.h"
+#include "Population.h"
+#include "Specie.h"
+
+#include "Core_CommandLine.h"
+#include "Core_Thread.h"
+
+#include "rapidjson/document.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+
+namespace
+{
+	struct SavedGenome
+	{
+		const char* myName;
+		const char* myFilePath;
+	};
+
+	const SavedGenome ourSavedGenomes[] = {
+		{ "xor", "neat/xor" },
+		{ "cartPole", "neat/cartPole" },
+		{ "acrobot", "neat/acrobot" },
+		{ "locomotion", "neat/locomotion" },
+	};
+
+	struct PhenotypeConfig
+	{
+		const char* myName;
+		Neat::Phenotype::Precision myPrecision;
+		Neat::Phenotype::Activation myActivation;
+	};
+
+	const PhenotypeConfig ourPhenotypeConfigs[] = {
+		{ "double/exact", Neat::Phenotype::Precision::Double, Neat::Phenotype::Activation::Exact },
+		{ "double/rational", Neat::Phenotype::Precision::Double, Neat::Phenotype::Activation::Rational },
+		{ "double/table", Neat::Phenotype::Precision::Double, Neat::Phenotype::Activation::Table },
+		{ "float/exact", Neat::Phenotype::Precision::Float, Neat::Phenotype::Activation::Exact },
+		{ "float/rational", Neat::Phenotype::Precision::Float, Neat::Phenotype::Activation::Rational },
+		{ "float/table", Neat::Phenotype::Precision::Float, Neat::Phenotype::Activation::Table },
+	};
+
+	const size_t ourReproductionPopulationSize = 500;
+	const int ourReproductionGenerationsCount = 30;
+	const uint ourWorkersCounts[] = { 1, 2, 4, 8, 16, 32 };
+
+	const size_t ourCheckpointPopulationSize = 10000;
+	const int ourCheckpointGenerationsCount = 10;
+
+	const size_t ourSamplesCount = 4096;
+	const size_t ourBatchSizes[] = { 1, 4, 16, 64, 256 };
+	const double ourMinDurationSec = 0.5;
+
+	// Synthetic genomes of the operations suite, grown by mutations from 4 inputs and 2 outputs, i.e. 10 initial links with the bias
+	const size_t ourSyntheticLinksCounts[] = { 10, 100, 1000, 10000 };
+	const size_t ourSyntheticInputCount = 4;
+	const size_t ourSyntheticOutputCount = 2;
+
+	const size_t ourTrainPopulationSize = 150;
+
+	const size_t ourTimingSamplesCount = 50;
+	const size_t ourMinTimingSamplesCount = 5;
+	const double ourMaxTimingDurationSec = 2.0; // The slowest operations stop at ourMinTimingSamplesCount
+	const double ourMinSampleDurationSec = 0.0005; // The fast operations are repeated within a sample, for the clock resolution
+	const size_t ourMaxRepeatsCount = 1 << 16;
+
+	const double ourRegressionTolerance = 0.2; // Of the median against the baseline, above the noise of the fastest operations
+
+	// Runs aFunction, which processes ourSamplesCount samples, until ourMinDurationSec is reached
+	template<typename Function>
+	double MeasureSamplesPerSecond(Function aFunction)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		size_t samplesCount = 0;
+		Clock::time_point start = Clock::now();
+		double elapsedSec = 0.0;
+		do
+		{
+			aFunction();
+			samplesCount += ourSamplesCount;
+			elapsedSec = std::chrono::duration<double>(Clock::now() - start).count();
+		} while (elapsedSec < ourMinDurationSec);
+
+		return static_cast<double>(samplesCount) / elapsedSec;
+	}
+
+	// Per repeat durations of an operation
+	struct Timings
+	{
+		double myMedianSec = 0.0;
+		double myP95Sec = 0.0;
+		size_t mySamplesCount = 0;
+		size_t myRepeatsCount = 0; // Per sample
+	};
+
+	// Each sample times aRun(repeatsCount), after an untimed aPrepare(repeatsCount) which resets the state the operation changes
+	template<typename Prepare, typename Run>
+	Timings MeasureTimings(Prepare aPrepare, Run aRun)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		auto measureSample = [&aPrepare, &aRun](size_t aRepeatsCount) {
+			aPrepare(aRepeatsCount);
+			Clock::time_point start = Clock::now();
+			aRun(aRepeatsCount);
+			return std::chrono::duration<double>(Clock::now() - start).count();
+		};
+
+		// The calibration samples also warm the caches up
+		Timings timings;
+		timings.myRepeatsCount = 1;
+		while (timings.myRepeatsCount < ourMaxRepeatsCount && measureSample(timings.myRepeatsCount) < ourMinSampleDurationSec)
+			timings.myRepeatsCount *= 2;
+
+		std::vector<double> samples;
+		Clock::time_point start = Clock::now();
+		while (samples.size() < ourTimingSamplesCount &&
+			(samples.size() < ourMinTimingSamplesCount || std::chrono::duration<double>(Clock::now() - start).count() < ourMaxTimingDurationSec))
+		{
+			samples.push_back(measureSample(timings.myRepeatsCount) / static_cast<double>(timings.myRepeatsCount));
+		}
+
+		std::sort(samples.begin(), samples.end());
+		timings.mySamplesCount = samples.size();
+		timings.myMedianSec = 0.5 * (samples[(samples.size() - 1) / 2] + samples[samples.size() / 2]);
+		timings.myP95Sec = samples[static_cast<size_t>(std::ceil(0.95 * static_cast<double>(samples.size()))) - 1]; // Nearest rank
+		return timings;
+	}
+
+	std::string FormatDuration(double aDurationSec)
+	{
+		if (aDurationSec < 1e-6)
+			return FormatString("%.1f ns", aDurationSec * 1e9);
+		if (aDurationSec < 1e-3)
+			return FormatString("%.2f us", aDurationSec * 1e6);
+		if (aDurationSec < 1.0)
+			return FormatString("%.2f ms", aDurationSec * 1e3);
+		return FormatString("%.2f s", aDurationSec);
+	}
+
+	struct OperationGenome
+	{
+		std::string myName;
+		std::string myFilePath; // Of the initial genome of the populations of TrainOneGeneration
+		Neat::Genome myGenome;
+	};
+
+	// Operation of a genome, named "operation/genome" to be compared with the baseline
+	struct OperationResult
+	{
+		std::string myName;
+		size_t myNodesCount = 0;
+		size_t myLinksCount = 0;
+		Timings myTimings;
+	};
+
+	// Grows a genome by mutations until it has at least aLinksCount links, mostly new links between the existing nodes
+	Neat::Genome CreateSyntheticGenome(size_t aLinksCount)
+	{
+		Neat::EvolutionParams params;
+		params.myNewLinkProba = 1.0;
+		params.myNewNodeProba = 0.2;
+
+		// The numbers are reserved from the process wide counter, as the genomes loaded from a file
+		Neat::Random random(aLinksCount);
+		std::uint64_t firstInnovationId = Neat::EvolutionParams::ReserveInnovationNumbers((ourSyntheticInputCount + 1) * ourSyntheticOutputCount);
+		Neat::Genome genome(ourSyntheticInputCount, ourSyntheticOutputCount, random, params, firstInnovationId);
+		while (genome.GetGenesCount() < aLinksCount)
+			genome.Mutate(random, params, Neat::EvolutionParams::ReserveInnovationNumbers(Neat::EvolutionParams::ourMutationInnovationsCount));
+		return genome;
+	}
+}
+
+// Returns false when an activation exceeds its tolerance
+bool CheckActivationErrors()
+{
+	bool isValid = true;
+	std::cout << "activation errors" << std::endl;
+	for (const PhenotypeConfig& config : ourPhenotypeConfigs)
+	{
+		double maxError = Neat::Phenotype::MeasureActivationError(config.myPrecision, config.myActivation);
+		double tolerance = Neat::Phenotype::GetActivationMaxError(config.myActivation);
+		bool isWithinTolerance = maxError <= tolerance;
+		std::cout << FormatString("  %-16s : max error %.2e, tolerance %.0e%s", config.myName, maxError, tolerance, isWithinTolerance ? "" : " FAILED") << std::endl;
+		isValid &= isWithinTolerance;
+	}
+	return isValid;
+}
+
+void BenchmarkEvaluation(const SavedGenome& aSavedGenome)
+{
+	Neat::Genome genome(aSavedGenome.myFilePath);
+	if (genome.GetGenesCount() == 0)
+	{
+		std::cout << aSavedGenome.myName << " : could not load " << aSavedGenome.myFilePath << std::endl;
+		return;
+	}
+
+	const Neat::Phenotype& compiled = genome.Compile();
+	const size_t inputCount = compiled.GetInputCount();
+	const size_t outputCount = compiled.GetOutputCount();
+
+	std::default_random_engine randomGenerator(0);
+	std::uniform_real_distribution<> rand(-1.0, 1.0);
+
+	// AoS samples, as fed to Genome::Evaluate by the training loops
+	std::vector<std::vector<double>> samples(ourSamplesCount, std::vector<double>(inputCount));
+	for (std::vector<double>& sample : samples)
+		for (double& input : sample)
+			input = rand(randomGenerator);
+
+	std::vector<double> referenceOutputs(ourSamplesCount * outputCount);
+	std::vector<double> outputs;
+	double referenceSamplesPerSec = MeasureSamplesPerSecond([&]() {
+		for (size_t s = 0; s < ourSamplesCount; ++s)
+		{
+			genome.Evaluate(samples[s], outputs);
+			for (size_t o = 0; o < outputCount; ++o)
+				referenceOutputs[s * outputCount + o] = outputs[o];
+		}
+	});
+
+	std::cout << FormatString("%s (%zu nodes, %zu links evaluated)", aSavedGenome.myName, compiled.GetEvaluatedNodesCount(), compiled.GetLinksCount()) << std::endl;
+	std::cout << FormatString("  Genome::Evaluate          : %12.0f samples/s", referenceSamplesPerSec) << std::endl;
+
+	for (const PhenotypeConfig& config : ourPhenotypeConfigs)
+	{
+		Neat::EvolutionParams::ourPhenotypePrecision = config.myPrecision;
+		Neat::EvolutionParams::ourPhenotypeActivation = config.myActivation;
+		Neat::Phenotype phenotype = genome.Compile();
+
+		std::cout << "  " << config.myName << std::endl;
+		for (size_t batchSize : ourBatchSizes)
+		{
+			// SoA inputs and outputs, one chunk per batch
+			std::vector<double> batchInputs(ourSamplesCount * inputCount);
+			std::vector<double> batchOutputs(ourSamplesCount * outputCount);
+			for (size_t batchStart = 0; batchStart < ourSamplesCount; batchStart += batchSize)
+				for (size_t i = 0; i < inputCount; ++i)
+					for (size_t s = 0; s < batchSize; ++s)
+						batchInputs[batchStart * inputCount + i * batchSize + s] = samples[batchStart + s][i];
+
+			double batchSamplesPerSec = MeasureSamplesPerSecond([&]() {
+				for (size_t batchStart = 0; batchStart < ourSamplesCount; batchStart += batchSize)
+				{
+					phenotype.EvaluateBatch(
+						std::span<const double>(batchInputs.data() + batchStart * inputCount, batchSize * inputCount),
+						std::span<double>(batchOutputs.data() + batchStart * outputCount, batchSize * outputCount),
+						batchSize);
+				}
+			});
+
+			// Error against the double precision, exact activation, evaluation
+			double maxError = 0.0;
+			for (size_t batchStart = 0; batchStart < ourSamplesCount; batchStart += batchSize)
+				for (size_t o = 0; o < outputCount; ++o)
+					for (size_t s = 0; s < batchSize; ++s)
+						maxError = std::max(maxError, std::abs(batchOutputs[batchStart * outputCount + o * batchSize + s] - referenceOutputs[(batchStart + s) * outputCount + o]));
+
+			std::cout << FormatString("    EvaluateBatch(%3zu)    : %12.0f samples/s (x%.1f, max error %.2e)", batchSize, batchSamplesPerSec, batchSamplesPerSec / referenceSamplesPerSec, maxError) << std::endl;
+		}
+	}
+
+	Neat::EvolutionParams::ourPhenotypePrecision = Neat::Phenotype::Precision::Double;
+	Neat::EvolutionParams::ourPhenotypeActivation = Neat::Phenotype::Activation::Exact;
+}
+
+void BenchmarkReproduction(const SavedGenome& aSavedGenome)
+{
+	using Clock = std::chrono::steady_clock;
+
+	if (Neat::Genome(aSavedGenome.myFilePath).GetGenesCount() == 0)
+		return;
+
+	std::cout << FormatString("reproduction of %s (%zu genomes, %d generations)", aSavedGenome.myName, ourReproductionPopulationSize, ourReproductionGenerationsCount) << std::endl;
+
+	double referenceDurationSec = 0.0;
+	for (uint workersCount : ourWorkersCounts)
+	{
+		if (workersCount > std::thread::hardware_concurrency())
+			break;
+
+		Thread::WorkerPool threadPool(Thread::WorkerPriority::High);
+		threadPool.SetWorkersCount(workersCount);
+
+		Neat::EvolutionParams::SetRandomSeed(0);
+		Neat::Population population(ourReproductionPopulationSize, aSavedGenome.myFilePath);
+
+		// Random fitnesses, drawn from the streams of the genomes to be the same for any workers count
+		Neat::Population::TrainingCallbacks callbacks;
+		callbacks.myEvaluateGenomes = [&population]() {
+			for (size_t i = 0; i < population.GetSize(); ++i)
+			{
+				Neat::Random random = population.GetEvaluationRandom(i);
+				std::uniform_real_distribution<> rand(0.0, 1.0);
+				population.GetGenome(i)->SetFitness(rand(random));
+			}
+		};
+
+		double durationSec = 0.0;
+		callbacks.myParallelFor = [&threadPool, &durationSec](size_t aCount, const std::function<void(size_t)>& aJob) {
+			Clock::time_point start = Clock::now();
+			threadPool.ParallelFor(aCount, aJob);
+			durationSec += std::chrono::duration<double>(Clock::now() - start).count();
+		};
+
+		for (int i = 0; i < ourReproductionGenerationsCount; ++i)
+			population.TrainOneGeneration(callbacks);
+
+		// The genes count of the population, to check that the result doesn't depend on the workers count
+		size_t genesCount = 0;
+		for (size_t i = 0; i < population.GetSize(); ++i)
+			genesCount += population.GetGenome(i)->GetGenesCount();
+
+		if (workersCount == 1)
+			referenceDurationSec = durationSec;
+
+		std::cout << FormatString("  %2u workers              : %8.2f ms/generation (x%.1f, %zu genes)", workersCount,
+			1000.0 * durationSec / ourReproductionGenerationsCount, referenceDurationSec / durationSec, genesCount) << std::endl;
+	}
+}
+
+void BenchmarkCheckpoint(const SavedGenome& aSavedGenome)
+{
+	using Clock = std::chrono::steady_clock;
+
+	if (Neat::Genome(aSavedGenome.myFilePath).GetGenesCount() == 0)
+		return;
+
+	Neat::EvolutionParams::SetRandomSeed(0);
+	Neat::Population population(ourCheckpointPopulationSize, aSavedGenome.myFilePath);
+
+	// A few generations with random fitnesses, to get species and genomes of different sizes
+	Neat::Population::TrainingCallbacks callbacks;
+	callbacks.myEvaluateGenomes = [&population]() {
+		for (size_t i = 0; i < population.GetSize(); ++i)
+		{
+			Neat::Random random = population.GetEvaluationRandom(i);
+			std::uniform_real_distribution<> rand(0.0, 1.0);
+			population.GetGenome(i)->SetFitness(rand(random));
+		}
+	};
+	for (int i = 0; i < ourCheckpointGenerationsCount; ++i)
+		population.TrainOneGeneration(callbacks);
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "NeatBench";
+	std::filesystem::create_directories(directory);
+	std::string checkpointPath = (directory / "checkpoint").string();
+
+	Clock::time_point start = Clock::now();
+	bool saved = population.SaveCheckpoint(checkpointPath.c_str());
+	double binarySaveSec = std::chrono::duration<double>(Clock::now() - start).count();
+
+	start = Clock::now();
+	Neat::Population resumedPopulation(checkpointPath.c_str());
+	double binaryLoadSec = std::chrono::duration<double>(Clock::now() - start).count();
+
+	// The text format only stores genomes, one file each
+	start = Clock::now();
+	for (size_t i = 0; i < population.GetSize(); ++i)
+		population.GetGenome(i)->SaveToFile((directory / FormatString("genome_%zu", i)).string().c_str());
+	double textSaveSec = std::chrono::duration<double>(Clock::now() - start).count();
+
+	size_t genesCount = 0;
+	start = Clock::now();
+	for (size_t i = 0; i < population.GetSize(); ++i)
+		genesCount += Neat::Genome((directory / FormatString("genome_%zu", i)).string().c_str()).GetGenesCount();
+	double textLoadSec = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::cout << FormatString("checkpoint of %s (%zu genomes, %zu genes, %.1f MB)", aSavedGenome.myName, population.GetSize(), genesCount,
+		saved ? std::filesystem::file_size(checkpointPath) / (1024.0 * 1024.0) : 0.0) << std::endl;
+	std::cout << FormatString("  binary population     : save %8.1f ms, load %8.1f ms (%zu genomes resumed)", 1000.0 * binarySaveSec, 1000.0 * binaryLoadSec, resumedPopulation.GetSize()) << std::endl;
+	std::cout << FormatString("  text genomes          : save %8.1f ms, load %8.1f ms", 1000.0 * textSaveSec, 1000.0 * textLoadSec) << std::endl;
+
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+}
+
+void BenchmarkGenomeOperations(const OperationGenome& anOperationGenome, const std::filesystem::path& aDirectory, std::vector<OperationResult>& someOutResults)
+{
+	Neat::Genome genome = anOperationGenome.myGenome;
+	const Neat::Phenotype& compiled = genome.Compile();
+	std::cout << FormatString("operations of %s (%zu nodes, %zu links)", anOperationGenome.myName.c_str(), genome.GetNodesCount(), genome.GetGenesCount()) << std::endl;
+
+	Neat::EvolutionParams params;
+	Neat::Random random(0);
+
+	auto addResult = [&](const char* anOperationName, const Timings& someTimings) {
+		OperationResult& result = someOutResults.emplace_back();
+		result.myName = FormatString("%s/%s", anOperationName, anOperationGenome.myName.c_str());
+		result.myNodesCount = genome.GetNodesCount();
+		result.myLinksCount = genome.GetGenesCount();
+		result.myTimings = someTimings;
+		std::cout << FormatString("  %-22s: median %10s, p95 %10s (%zu samples of %zu)", anOperationName,
+			FormatDuration(someTimings.myMedianSec).c_str(), FormatDuration(someTimings.myP95Sec).c_str(), someTimings.mySamplesCount, someTimings.myRepeatsCount) << std::endl;
+	};
+
+	// A close relative, as the parents and the genomes of a specie are, so that the crossover and the distance go through all
+	// the genes: the weights are mutated and a link is added
+	Neat::Genome relative = genome;
+	relative.SetFitness(1.0);
+	Neat::EvolutionParams relativeParams;
+	relativeParams.myNewLinkProba = 1.0;
+	relativeParams.myNewNodeProba = 0.0;
+	relative.Mutate(random, relativeParams, Neat::EvolutionParams::ReserveInnovationNumbers(Neat::EvolutionParams::ourMutationInnovationsCount));
+
+	std::vector<double> inputs(compiled.GetInputCount());
+	std::uniform_real_distribution<> rand(-1.0, 1.0);
+	for (double& input : inputs)
+		input = rand(random);
+	std::vector<double> outputs;
+	addResult("Evaluate", MeasureTimings([](size_t /*aRepeatsCount*/) {}, [&](size_t aRepeatsCount) {
+		for (size_t i = 0; i < aRepeatsCount; ++i)
+			genome.Evaluate(inputs, outputs);
+	}));
+
+	std::vector<Neat::Genome> mutants;
+	std::uint64_t firstInnovationId = 0;
+	addResult("Mutate", MeasureTimings([&](size_t aRepeatsCount) {
+		mutants.assign(aRepeatsCount, genome);
+		firstInnovationId = Neat::EvolutionParams::ReserveInnovationNumbers(aRepeatsCount * Neat::EvolutionParams::ourMutationInnovationsCount);
+	}, [&](size_t aRepeatsCount) {
+		for (size_t i = 0; i < aRepeatsCount; ++i)
+			mutants[i].Mutate(random, params, firstInnovationId + i * Neat::EvolutionParams::ourMutationInnovationsCount);
+	}));
+	mutants.clear();
+
+	// The children are destroyed out of the timings
+	std::vector<Neat::Genome> children;
+	addResult("Crossover", MeasureTimings([&](size_t aRepeatsCount) {
+		children.clear();
+		children.reserve(aRepeatsCount);
+	}, [&](size_t aRepeatsCount) {
+		for (size_t i = 0; i < aRepeatsCount; ++i)
+			children.emplace_back(&relative, &genome, random);
+	}));
+	children.clear();
+
+	Neat::Specie specie(params, 1);
+	specie.AddGenome(&genome);
+	specie.ChooseRepresentative(random);
+	size_t belongingCount = 0;
+	addResult("BelongsToSpecie", MeasureTimings([](size_t /*aRepeatsCount*/) {}, [&](size_t aRepeatsCount) {
+		for (size_t i = 0; i < aRepeatsCount; ++i)
+			belongingCount += specie.BelongsToSpecie(&relative) ? 1 : 0;
+	}));
+	specie.ClearGenomes();
+	if (belongingCount == 0)
+		std::cout << "  the relative is not of the specie, BelongsToSpecie stopped before the end of the genes" << std::endl;
+
+	// Serial, the scaling with the workers is measured by BenchmarkReproduction.
+	// The samples evolve their population, so each one trains a population restored from the same checkpoint, taken after
+	// a first generation for the species to be formed.
+	Neat::Population* trainedPopulation = nullptr;
+	Neat::Population::TrainingCallbacks callbacks;
+	callbacks.myEvaluateGenomes = [&trainedPopulation]() {
+		for (size_t i = 0; i < trainedPopulation->GetSize(); ++i)
+		{
+			Neat::Random random = trainedPopulation->GetEvaluationRandom(i);
+			std::uniform_real_distribution<> rand(0.0, 1.0);
+			trainedPopulation->GetGenome(i)->SetFitness(rand(random));
+		}
+	};
+
+	std::string checkpointPath = (aDirectory / (anOperationGenome.myName + "_checkpoint")).string();
+	{
+		Neat::EvolutionParams::SetRandomSeed(0);
+		Neat::Population population(ourTrainPopulationSize, anOperationGenome.myFilePath.c_str());
+		trainedPopulation = &population;
+		population.TrainOneGeneration(callbacks);
+		if (!population.SaveCheckpoint(checkpointPath.c_str()))
+		{
+			std::cout << "  could not save " << checkpointPath << ", TrainOneGeneration is skipped" << std::endl;
+			return;
+		}
+	}
+
+	// The populations are restored and destroyed out of the timings
+	std::vector<std::unique_ptr<Neat::Population>> populations;
+	addResult("TrainOneGeneration", MeasureTimings([&](size_t aRepeatsCount) {
+		populations.clear();
+		for (size_t i = 0; i < aRepeatsCount; ++i)
+			populations.push_back(std::make_unique<Neat::Population>(checkpointPath.c_str()));
+	}, [&](size_t aRepeatsCount) {
+		for (size_t i = 0; i < aRepeatsCount; ++i)
+		{
+			trainedPopulation = populations[i].get();
+			trainedPopulation->TrainOneGeneration(callbacks);
+		}
+	}));
+	populations.clear();
+}
+
+std::vector<OperationResult> BenchmarkOperations(const std::filesystem::path& aDirectory)
+{
+	std::vector<OperationGenome> operationGenomes;
+
+	// The synthetic genomes are saved to be the initial genome of the populations, as the saved ones
+	std::filesystem::create_directories(aDirectory);
+	for (size_t linksCount : ourSyntheticLinksCounts)
+	{
+		OperationGenome& operationGenome = operationGenomes.emplace_back();
+		operationGenome.myName = FormatString("synthetic%zu", linksCount);
+		operationGenome.myFilePath = (aDirectory / operationGenome.myName).string();
+		operationGenome.myGenome = CreateSyntheticGenome(linksCount);
+		operationGenome.myGenome.SaveToFile(operationGenome.myFilePath.c_str());
+	}
+
+	for (const SavedGenome& savedGenome : ourSavedGenomes)
+	{
+		Neat::Genome genome(savedGenome.myFilePath);
+		if (genome.GetGenesCount() == 0)
+		{
+			std::cout << savedGenome.myName << " : could not load " << savedGenome.myFilePath << std::endl;
+			continue;
+		}
+		operationGenomes.push_back({ savedGenome.myName, savedGenome.myFilePath, genome });
+	}
+
+	std::vector<OperationResult> results;
+	for (const OperationGenome& operationGenome : operationGenomes)
+		BenchmarkGenomeOperations(operationGenome, aDirectory, results);
+	return results;
+}
+
+bool SaveOperationResults(const std::vector<OperationResult>& someResults, const char* aFilePath)
+{
+	rapidjson::StringBuffer buffer;
+	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+	writer.StartObject();
+	writer.Key("benchmarks");
+	writer.StartArray();
+	for (const OperationResult& result : someResults)
+	{
+		writer.StartObject();
+		writer.Key("name");
+		writer.String(result.myName.c_str());
+		writer.Key("nodes");
+		writer.Uint64(result.myNodesCount);
+		writer.Key("links");
+		writer.Uint64(result.myLinksCount);
+		writer.Key("medianNs");
+		writer.Double(result.myTimings.myMedianSec * 1e9);
+		writer.Key("p95Ns");
+		writer.Double(result.myTimings.myP95Sec * 1e9);
+		writer.Key("samples");
+		writer.Uint64(result.myTimings.mySamplesCount);
+		writer.Key("repeats");
+		writer.Uint64(result.myTimings.myRepeatsCount);
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	std::ofstream file(aFilePath);
+	file << buffer.GetString() << std::endl;
+	return file.good();
+}
+
+// Prints the medians relatively to the ones of a previous run saved by SaveOperationResults, the operations slower by more
+// than ourRegressionTolerance are counted in anOutRegressionsCount
+bool CompareOperationResults(const std::vector<OperationResult>& someResults, const char* aBaselinePath, size_t& anOutRegressionsCount)
+{
+	anOutRegressionsCount = 0;
+
+	std::ifstream file(aBaselinePath);
+	std::stringstream content;
+	content << file.rdbuf();
+
+	rapidjson::Document baseline;
+	baseline.Parse(content.str().c_str());
+	if (!file || baseline.HasParseError() || !baseline.IsObject() || !baseline.HasMember("benchmarks") || !baseline["benchmarks"].IsArray())
+	{
+		std::cout << "could not read the baseline " << aBaselinePath << std::endl;
+		return false;
+	}
+
+	std::cout << "comparison with " << aBaselinePath << std::endl;
+	for (const OperationResult& result : someResults)
+	{
+		const rapidjson::Value* baselineResult = nullptr;
+		for (const rapidjson::Value& value : baseline["benchmarks"].GetArray())
+		{
+			if (value.IsObject() && value.HasMember("name") && value["name"].IsString() && result.myName == value["name"].GetString())
+				baselineResult = &value;
+		}
+
+		if (!baselineResult || !baselineResult->HasMember("medianNs") || !(*baselineResult)["medianNs"].IsNumber())
+		{
+			std::cout << FormatString("  %-40s: not in the baseline", result.myName.c_str()) << std::endl;
+			continue;
+		}
+
+		double ratio = result.myTimings.myMedianSec * 1e9 / (*baselineResult)["medianNs"].GetDouble();
+		bool isRegression = ratio > 1.0 + ourRegressionTolerance;
+		if (isRegression)
+			anOutRegressionsCount++;
+		std::cout << FormatString("  %-40s: x%.2f%s", result.myName.c_str(), ratio, isRegression ? " REGRESSION" : "") << std::endl;
+	}
+	return true;
+}
+
+// -operations : only the operations suite, without the throughput and scaling benchmarks
+// -json : file of the operations results, NeatBench.json by default
+// -baseline : results of a previous run to compare with, fails on a regression of a median
+// Always checks the errors of the approximate activations first, and fails when one exceeds its tolerance
+int main(int argc, char* argv[])
+{
+	Core::CommandLine commandLine;
+	commandLine.Parse(argc, argv);
+
+	for (const char* pathOption : { "json", "baseline" })
+	{
+		if (commandLine.IsSet(pathOption) && commandLine.GetValue(pathOption).empty())
+		{
+			std::cout << "missing path for -" << pathOption << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	// The benchmarks still run, the failure is reported by the exit code
+	bool areActivationsValid = CheckActivationErrors();
+
+	if (!commandLine.IsSet("operations"))
+	{
+		for (const SavedGenome& savedGenome : ourSavedGenomes)
+			BenchmarkEvaluation(savedGenome);
+
+		for (const SavedGenome& savedGenome : ourSavedGenomes)
+			BenchmarkReproduction(savedGenome);
+
+		for (const SavedGenome& savedGenome : ourSavedGenomes)
+			BenchmarkCheckpoint(savedGenome);
+	}
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "NeatBenchOperations";
+	std::vector<OperationResult> results = BenchmarkOperations(directory);
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+
+	std::string jsonPath = commandLine.IsSet("json") ? commandLine.GetValue("json") : "NeatBench.json";
+	if (!SaveOperationResults(results, jsonPath.c_str()))
+		std::cout << "could not save " << jsonPath << std::endl;
+
+	if (commandLine.IsSet("baseline"))
+	{
+		size_t regressionsCount = 0;
+		if (!CompareOperationResults(results, commandLine.GetValue("baseline").c_str(), regressionsCount) || regressionsCount > 0)
+			return EXIT_FAILURE;
+	}
+
+	return areActivationsValid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
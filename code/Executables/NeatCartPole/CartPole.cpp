@@ -1,19 +1,18 @@
 #include "CartPole.h"
-#include "EvolutionParams.h"
+#include "Random.h"
 #include <random>
 #include "imgui_helpers.h"
-#include <format>
 
-CartPole::CartPole(double aStartPoleAngle, double aVariance, bool aHighStartVelocities)
+CartPole::CartPole(double aStartPoleAngle, double aVariance, bool aHighStartVelocities, Neat::Random& aRandom)
 {
 	myInitPoleAngle = aStartPoleAngle;
 	if (aVariance > DBL_EPSILON)
 	{
 		std::uniform_real_distribution<> rand(-aVariance, aVariance);
-		myInitPoleAngle += rand(Neat::EvolutionParams::GetRandomGenerator()) * PI;
-		myInitCartPosition = rand(Neat::EvolutionParams::GetRandomGenerator()) * myCartTrackSize;
-		myInitPoleVelocity = rand(Neat::EvolutionParams::GetRandomGenerator()) * (aHighStartVelocities ? 10.0 : 3.0);
-		myInitCartVelocity = rand(Neat::EvolutionParams::GetRandomGenerator()) * (aHighStartVelocities ? 10.0 : 3.0);
+		myInitPoleAngle += rand(aRandom) * PI;
+		myInitCartPosition = rand(aRandom) * myCartTrackSize;
+		myInitPoleVelocity = rand(aRandom) * (aHighStartVelocities ? 10.0 : 3.0);
+		myInitCartVelocity = rand(aRandom) * (aHighStartVelocities ? 10.0 : 3.0);
 	}
 	Reset();
 }
@@ -24,6 +23,29 @@ void CartPole::Reset()
 	myPoleVelocity = myInitPoleVelocity;
 	myCartPosition = myInitCartPosition;
 	myCartVelocity = myInitCartVelocity;
+	myActionForce = 0.0;
+	myStepIdx = 0;
+}
+
+void CartPole::Observe(std::span<double> someOutObservations) const
+{
+	someOutObservations[0] = GetPoleAngle();
+	someOutObservations[1] = myPoleVelocity;
+	someOutObservations[2] = myCartPosition;
+	someOutObservations[3] = myCartVelocity;
+}
+
+void CartPole::Act(std::span<const double> someActions)
+{
+	myActionForce = someActions[0] < someActions[1] ? -1.0 : 1.0;
+}
+
+double CartPole::Step()
+{
+	Update(myActionForce, myDeltaTime);
+	myStepIdx++;
+
+	return IsPoleUp() && IsSlowAndCentered() ? 1.0 : 0.0;
 }
 
 void CartPole::Update(double aForceAmplitude, double aDeltaTime)
@@ -105,10 +127,10 @@ void CartPole::Draw(const glm::vec2& aMousePos)
 	draw_list->AddLine(cartPos, poleEndPos, 0xFFFF0000, 5.f);
 
 	double angleDegrees = GetPoleAngle() * 180.0 / PI;
-	draw_list->AddText(trackPos + ImVec2(0.f, 50.f), 0xFFFFFFFF, std::format("Angle : {}", angleDegrees).c_str());
-	draw_list->AddText(trackPos + ImVec2(0.f, 75.f), 0xFFFFFFFF, std::format("Position : {}", myCartPosition).c_str());
-	draw_list->AddText(trackPos + ImVec2(0.f, 100.f), 0xFFFFFFFF, std::format("Pole Velocity : {}", myPoleVelocity).c_str());
-	draw_list->AddText(trackPos + ImVec2(0.f, 125.f), 0xFFFFFFFF, std::format("Cart Velocity : {}", myCartVelocity).c_str());
+	draw_list->AddText(trackPos + ImVec2(0.f, 50.f), 0xFFFFFFFF, FormatString("Angle : %g", angleDegrees).c_str());
+	draw_list->AddText(trackPos + ImVec2(0.f, 75.f), 0xFFFFFFFF, FormatString("Position : %g", myCartPosition).c_str());
+	draw_list->AddText(trackPos + ImVec2(0.f, 100.f), 0xFFFFFFFF, FormatString("Pole Velocity : %g", myPoleVelocity).c_str());
+	draw_list->AddText(trackPos + ImVec2(0.f, 125.f), 0xFFFFFFFF, FormatString("Cart Velocity : %g", myCartVelocity).c_str());
 
 	draw_list->AddCircleFilled(poleEndPos, 5.f, 0xFFFF0000);
 	draw_list->AddCircleFilled(ImVec2(aMousePos.x, aMousePos.y), 5.f, 0xFFFF0000);
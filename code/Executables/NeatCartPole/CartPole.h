@@ -1,11 +1,25 @@
 #pragma once
 
+#include "Environment.h"
+
+namespace Neat { class Random; }
+
 #define PI 3.14159265358979323846
 
-struct CartPole
+struct CartPole : public Neat::Environment
 {
-	CartPole(double aStartPoleAngle, double aVariance, bool aHighStartVelocities);
-	void Reset();
+	CartPole(double aStartPoleAngle, double aVariance, bool aHighStartVelocities, Neat::Random& aRandom);
+	void Reset() override;
+
+	// Neat::Environment, the steps where the pole is up, slow and centered are rewarded
+	size_t GetObservationsCount() const override { return 4; }
+	size_t GetActionsCount() const override { return 2; }
+	void Observe(std::span<double> someOutObservations) const override;
+	void Act(std::span<const double> someActions) override;
+	double Step() override;
+	bool IsDone() const override { return myStepIdx >= myMaxSteps; }
+	bool IsTerminated() const override { return myTerminateOnFailure && !IsPoleUp(); }
+	double GetRewardBound() const override { return IsTerminated() ? 0.0 : static_cast<double>(myMaxSteps - myStepIdx); }
 
 	void Update(double aForce, double aDeltaTime);
 	double GetPoleAngle() const { return std::atan2(std::sin(myPoleAngle), std::cos(myPoleAngle)); }
@@ -35,6 +49,12 @@ struct CartPole
 
 	double myGravitationalAcceleration = 9.81;
 	double myInputForce = 10.0;
+
+	double myActionForce = 0.0; // Amplitude chosen by the last Act
+	double myDeltaTime = 0.02;
+	uint myMaxSteps = 1500; // 30 seconds
+	uint myStepIdx = 0;
+	bool myTerminateOnFailure = false; // Balancing task, the episode ends as soon as the pole falls
 };
 
 typedef std::vector<CartPole> CartPoles;
@@ -0,0 +1,146 @@
+#include "CartPoleBatch.h"
+
+CartPoleBatch::CartPoleBatch(const CartPoles& someSystems)
+{
+	Assert(!someSystems.empty());
+
+	const CartPole& params = someSystems.front();
+	myPoleMass = params.myPoleMass;
+	myPoleLength = params.myPoleLength;
+	myPoleFailureAngle = params.myPoleFailureAngle;
+	myPoleFriction = params.myPoleFriction;
+	myCartMass = params.myCartMass;
+	myCartTrackSize = params.myCartTrackSize;
+	myCartFriction = params.myCartFriction;
+	myGravitationalAcceleration = params.myGravitationalAcceleration;
+	myInputForce = params.myInputForce;
+	myDeltaTime = params.myDeltaTime;
+	myMaxSteps = params.myMaxSteps;
+	myTerminateOnFailure = params.myTerminateOnFailure;
+
+	for (const CartPole& system : someSystems)
+	{
+		myInitPoleAngles.push_back(system.myInitPoleAngle);
+		myInitPoleVelocities.push_back(system.myInitPoleVelocity);
+		myInitCartPositions.push_back(system.myInitCartPosition);
+		myInitCartVelocities.push_back(system.myInitCartVelocity);
+	}
+
+	myPoleAngles.resize(someSystems.size());
+	myWrappedPoleAngles.resize(someSystems.size());
+	myPoleVelocities.resize(someSystems.size());
+	myCartPositions.resize(someSystems.size());
+	myCartVelocities.resize(someSystems.size());
+	myActionForces.resize(someSystems.size());
+	myActiveMasks.resize(someSystems.size());
+	Reset();
+}
+
+void CartPoleBatch::Reset()
+{
+	myPoleAngles = myInitPoleAngles;
+	myPoleVelocities = myInitPoleVelocities;
+	myCartPositions = myInitCartPositions;
+	myCartVelocities = myInitCartVelocities;
+	std::fill(myActionForces.begin(), myActionForces.end(), 0.0);
+	WrapPoleAngles();
+	myActiveCount = 0;
+	for (size_t s = 0, e = GetBatchSize(); s < e; ++s)
+	{
+		bool isPoleUp = std::abs(myWrappedPoleAngles[s]) <= myPoleFailureAngle;
+		myActiveMasks[s] = myTerminateOnFailure && !isPoleUp ? 0.0 : 1.0;
+		myActiveCount += myTerminateOnFailure && !isPoleUp ? 0 : 1;
+	}
+	myStepIdx = 0;
+}
+
+void CartPoleBatch::Observe(std::span<double> someOutObservations) const
+{
+	const size_t count = GetBatchSize();
+	double* angles = someOutObservations.data();
+	double* poleVelocities = angles + count;
+	double* cartPositions = poleVelocities + count;
+	double* cartVelocities = cartPositions + count;
+
+	for (size_t s = 0; s < count; ++s)
+	{
+		angles[s] = myWrappedPoleAngles[s];
+		poleVelocities[s] = myPoleVelocities[s];
+		cartPositions[s] = myCartPositions[s];
+		cartVelocities[s] = myCartVelocities[s];
+	}
+}
+
+void CartPoleBatch::Act(std::span<const double> someActions)
+{
+	const size_t count = GetBatchSize();
+	const double* actions0 = someActions.data();
+	const double* actions1 = actions0 + count;
+
+	for (size_t s = 0; s < count; ++s)
+		myActionForces[s] = actions0[s] < actions1[s] ? -1.0 : 1.0;
+}
+
+double CartPoleBatch::Step()
+{
+	Update(myDeltaTime);
+	WrapPoleAngles();
+	myStepIdx++;
+
+	// Same as CartPole::IsPoleUp && CartPole::IsSlowAndCentered, and CartPole::IsTerminated
+	double reward = 0.0;
+	double activeCount = 0.0;
+	for (size_t s = 0, e = GetBatchSize(); s < e; ++s)
+	{
+		bool isPoleUp = std::abs(myWrappedPoleAngles[s]) <= myPoleFailureAngle;
+		bool isSlowAndCentered = std::abs(myCartPositions[s]) <= myCartTrackSize / 10.0 && std::abs(myCartVelocities[s]) <= 1.0 && std::abs(myPoleVelocities[s]) <= 1.0;
+		myActiveMasks[s] = myTerminateOnFailure && !isPoleUp ? 0.0 : myActiveMasks[s];
+		reward += isPoleUp && isSlowAndCentered ? myActiveMasks[s] : 0.0;
+		activeCount += myActiveMasks[s];
+	}
+	myActiveCount = static_cast<size_t>(activeCount);
+	return reward;
+}
+
+void CartPoleBatch::WrapPoleAngles()
+{
+	// Same as CartPole::GetPoleAngle
+	for (size_t s = 0, e = GetBatchSize(); s < e; ++s)
+		myWrappedPoleAngles[s] = std::atan2(std::sin(myPoleAngles[s]), std::cos(myPoleAngles[s]));
+}
+
+void CartPoleBatch::Update(double aDeltaTime)
+{
+	const double totalMass = myCartMass + myPoleMass;
+	double* angles = myPoleAngles.data();
+	double* poleVelocities = myPoleVelocities.data();
+	double* cartPositions = myCartPositions.data();
+	double* cartVelocities = myCartVelocities.data();
+	const double* actionForces = myActionForces.data();
+
+	// Branchless version of CartPole::Update, so the compiler can vectorize the loop
+	for (size_t s = 0, e = GetBatchSize(); s < e; ++s)
+	{
+		double sinAngle = std::sin(angles[s]);
+		double cosAngle = std::cos(angles[s]);
+		double force = actionForces[s] * myInputForce;
+		bool isBlocked = (force > 0.0 && cartPositions[s] >= myCartTrackSize) || (force < 0.0 && cartPositions[s] <= -myCartTrackSize);
+		force = isBlocked ? 0.0 : force;
+
+		double tmp = (force + myPoleMass * myPoleLength * poleVelocities[s] * poleVelocities[s] * sinAngle) / totalMass;
+
+		double poleAcceleration = (myGravitationalAcceleration * sinAngle - cosAngle * tmp) / (myPoleLength * (4.0 / 3.0 - myPoleMass * cosAngle * cosAngle / totalMass));
+		poleAcceleration -= poleVelocities[s] * myPoleFriction;
+
+		double cartAcceleration = tmp - myPoleMass * myPoleLength * poleVelocities[s] * poleAcceleration * cosAngle / totalMass;
+		cartAcceleration -= cartVelocities[s] * myCartFriction;
+
+		poleVelocities[s] += aDeltaTime * poleAcceleration;
+		angles[s] += aDeltaTime * poleVelocities[s];
+
+		double cartVelocity = cartVelocities[s] + aDeltaTime * cartAcceleration;
+		bool isStopped = (cartVelocity > 0.0 && cartPositions[s] >= myCartTrackSize) || (cartVelocity < 0.0 && cartPositions[s] <= -myCartTrackSize);
+		cartVelocities[s] = isStopped ? 0.0 : cartVelocity;
+		cartPositions[s] += aDeltaTime * cartVelocities[s];
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CartPole.h"
+
+// CartPoles stepped in lockstep, with one array per state variable so the updates vectorize over the instances.
+// Steps like CartPole::Step, the instances share the physical parameters of the first system.
+class CartPoleBatch : public Neat::BatchEnvironment
+{
+public:
+	CartPoleBatch(const CartPoles& someSystems);
+
+	size_t GetBatchSize() const override { return myPoleAngles.size(); }
+	size_t GetObservationsCount() const override { return 4; }
+	size_t GetActionsCount() const override { return 2; }
+
+	void Reset() override;
+	void Observe(std::span<double> someOutObservations) const override;
+	void Act(std::span<const double> someActions) override;
+	double Step() override;
+	bool IsDone() const override { return myStepIdx >= myMaxSteps; }
+	bool IsTerminated() const override { return myActiveCount == 0; }
+	double GetRewardBound() const override { return static_cast<double>(myMaxSteps - myStepIdx) * myActiveCount; }
+
+	uint GetMaxSteps() const { return myMaxSteps; }
+
+private:
+	void Update(double aDeltaTime);
+	void WrapPoleAngles();
+
+	std::vector<double> myInitPoleAngles;
+	std::vector<double> myInitPoleVelocities;
+	std::vector<double> myInitCartPositions;
+	std::vector<double> myInitCartVelocities;
+
+	std::vector<double> myPoleAngles;
+	std::vector<double> myWrappedPoleAngles; // In [-PI, PI], computed once per step for the reward and the observations
+	std::vector<double> myPoleVelocities;
+	std::vector<double> myCartPositions;
+	std::vector<double> myCartVelocities;
+	std::vector<double> myActionForces;
+	std::vector<double> myActiveMasks; // 1 until the instance terminates, then 0 and it doesn't collect rewards anymore
+	size_t myActiveCount = 0;
+
+	double myPoleMass = 0.1;
+	double myPoleLength = 0.5; // Half
+	double myPoleFailureAngle = 0.2094384;
+	double myPoleFriction = 0.1;
+	double myCartMass = 1.0;
+	double myCartTrackSize = 2.4; // Half
+	double myCartFriction = 0.0;
+	double myGravitationalAcceleration = 9.81;
+	double myInputForce = 10.0;
+
+	double myDeltaTime = 0.02;
+	uint myMaxSteps = 1500;
+	uint myStepIdx = 0;
+	bool myTerminateOnFailure = false;
+};
+
+typedef std::vector<CartPoleBatch> CartPoleBatchPool;
@@ -0,0 +1,99 @@
+#include "TrainingDashboard.h"
+
+#include "imgui_helpers.h"
+
+void TrainingDashboard::Draw(const Neat::Telemetry& aTelemetry, bool anIsTraining)
+{
+	// The telemetry was cleared by a new training
+	if (aTelemetry.GetRecordsCount() < myNextRecordIdx)
+		Clear();
+
+	myNewRecords.clear();
+	myNextRecordIdx = aTelemetry.CopyRecords(myNewRecords, myNextRecordIdx);
+	for (const Neat::Telemetry::GenerationRecord& record : myNewRecords)
+		AddRecord(record);
+
+	const ImGuiViewport* viewport = ImGui::GetMainViewport();
+	ImGui::SetNextWindowPos(ImVec2(viewport->Pos.x + viewport->Size.x - 10.f, viewport->Pos.y + 10.f), ImGuiCond_FirstUseEver, ImVec2(1.f, 0.f));
+	ImGui::SetNextWindowSize(ImVec2(480.f, 720.f), ImGuiCond_FirstUseEver);
+	if (ImGui::Begin("Training"))
+	{
+		if (myGenerations.empty())
+		{
+			ImGui::TextUnformatted(anIsTraining ? "Waiting for the first generation" : "No generation");
+		}
+		else
+		{
+			size_t lastIdx = myGenerations.size() - 1;
+			ImGui::Text("Generation %.0f%s", myGenerations[lastIdx], anIsTraining ? "" : " (ended)");
+			ImGui::Text("Best fitness %.4f, %.0f species, %.0f evaluations/s", myBestFitnesses[lastIdx], mySpeciesCounts[lastIdx], myEvaluationsPerSec[lastIdx]);
+
+			const int count = static_cast<int>(myGenerations.size());
+			const ImVec2 plotSize(-1.f, 120.f);
+			const ImPlotAxisFlags axisFlags = ImPlotAxisFlags_AutoFit;
+
+			if (ImPlot::BeginPlot("Best fitness", plotSize, ImPlotFlags_NoLegend))
+			{
+				ImPlot::SetupAxes(nullptr, nullptr, axisFlags, axisFlags);
+				ImPlot::PlotLine("best fitness", myGenerations.data(), myBestFitnesses.data(), count);
+				ImPlot::EndPlot();
+			}
+
+			if (ImPlot::BeginPlot("Species", plotSize, ImPlotFlags_NoLegend))
+			{
+				ImPlot::SetupAxes(nullptr, nullptr, axisFlags, axisFlags);
+				ImPlot::PlotLine("species", myGenerations.data(), mySpeciesCounts.data(), count);
+				ImPlot::EndPlot();
+			}
+
+			if (ImPlot::BeginPlot("Evaluations/s", plotSize, ImPlotFlags_NoLegend))
+			{
+				ImPlot::SetupAxes(nullptr, nullptr, axisFlags, axisFlags);
+				ImPlot::PlotLine("evaluations/s", myGenerations.data(), myEvaluationsPerSec.data(), count);
+				ImPlot::EndPlot();
+			}
+
+			if (ImPlot::BeginPlot("Phases (ms)", plotSize))
+			{
+				ImPlot::SetupAxes(nullptr, nullptr, axisFlags, axisFlags);
+				for (size_t phase = 0; phase < static_cast<size_t>(Neat::Telemetry::Phase::Count); ++phase)
+					ImPlot::PlotLine(Neat::Telemetry::GetPhaseName(static_cast<Neat::Telemetry::Phase>(phase)), myGenerations.data(), myPhaseDurationsMs[phase].data(), count);
+				ImPlot::EndPlot();
+			}
+
+			if (ImPlot::BeginPlot("Links", plotSize))
+			{
+				ImPlot::SetupAxes(nullptr, nullptr, axisFlags, axisFlags);
+				ImPlot::PlotLine("average", myGenerations.data(), myAverageLinksCounts.data(), count);
+				ImPlot::PlotLine("max", myGenerations.data(), myMaxLinksCounts.data(), count);
+				ImPlot::EndPlot();
+			}
+		}
+	}
+	ImGui::End();
+}
+
+void TrainingDashboard::AddRecord(const Neat::Telemetry::GenerationRecord& aRecord)
+{
+	myGenerations.push_back(static_cast<double>(aRecord.myGeneration));
+	myBestFitnesses.push_back(aRecord.myBestFitness);
+	mySpeciesCounts.push_back(static_cast<double>(aRecord.mySpeciesCount));
+	myEvaluationsPerSec.push_back(aRecord.myEvaluationsPerSec);
+	myAverageLinksCounts.push_back(aRecord.myAverageLinksCount);
+	myMaxLinksCounts.push_back(static_cast<double>(aRecord.myMaxLinksCount));
+	for (size_t phase = 0; phase < static_cast<size_t>(Neat::Telemetry::Phase::Count); ++phase)
+		myPhaseDurationsMs[phase].push_back(1000.0 * aRecord.myPhaseDurationsSec[phase]);
+}
+
+void TrainingDashboard::Clear()
+{
+	myNextRecordIdx = 0;
+	myGenerations.clear();
+	myBestFitnesses.clear();
+	mySpeciesCounts.clear();
+	myEvaluationsPerSec.clear();
+	myAverageLinksCounts.clear();
+	myMaxLinksCounts.clear();
+	for (std::vector<double>& phaseDurationsMs : myPhaseDurationsMs)
+		phaseDurationsMs.clear();
+}
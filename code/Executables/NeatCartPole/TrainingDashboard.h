@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Telemetry.h"
+
+#include <cstdint>
+#include <vector>
+
+// Plots the generations of a Neat::BackgroundTraining, from the GUI callback of a demo. Each frame only reads the records
+// added to the telemetry since the previous one. Shared by the demos.
+class TrainingDashboard
+{
+public:
+	void Draw(const Neat::Telemetry& aTelemetry, bool anIsTraining);
+
+private:
+	void AddRecord(const Neat::Telemetry::GenerationRecord& aRecord);
+	void Clear();
+
+	std::uint64_t myNextRecordIdx = 0;
+	std::vector<Neat::Telemetry::GenerationRecord> myNewRecords;
+
+	// One value per generation, as plotted
+	std::vector<double> myGenerations;
+	std::vector<double> myBestFitnesses;
+	std::vector<double> mySpeciesCounts;
+	std::vector<double> myEvaluationsPerSec;
+	std::vector<double> myAverageLinksCounts;
+	std::vector<double> myMaxLinksCounts;
+	std::vector<double> myPhaseDurationsMs[static_cast<size_t>(Neat::Telemetry::Phase::Count)];
+};
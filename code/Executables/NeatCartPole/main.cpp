@@ -1,9 +1,14 @@
 #include "CartPole.h"
+#include "CartPoleBatch.h"
+#include "TrainingDashboard.h"
 
+#include "BackgroundTraining.h"
 #include "Genome.h"
+#include "Evaluator.h"
 #include "EvolutionParams.h"
 #include "Specie.h"
 #include "Population.h"
+#include "IslandModel.h"
 
 #include "Core_Facade.h"
 #include "Core_Module.h"
@@ -16,8 +21,19 @@
 #include "Render_EntityRenderComponent.h"
 #include "imgui_helpers.h"
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <thread>
+
+#define USE_PRUNING 0 // 1 to stop the evaluations that can't reach the median fitness of the generation anymore, faster but not deterministic
+#define USE_RACING 1 // 1 to evaluate only the best genomes on all the systems, the others are ranked on fewer systems
+#define USE_STEADY_STATE 0 // 1 to replace the genomes one by one instead of by generation, the workers never wait for each other
+#define ISLANDS_COUNT 4 // Populations of TrainNeatIslands, each trained on its own share of the workers
+#define BACKGROUND_TRAINING 0 // 1 to run TrainNeat while the window is open, with a dashboard of the generations and the best genome swapped into the view, not with USE_STEADY_STATE
+
+void TrainNeat(Neat::BackgroundTraining* aBackgroundTraining = nullptr);
 
 class NeatCartPoleModule : public Core::Module
 {
@@ -41,6 +57,9 @@ private:
 	CartPole* mySystem = nullptr;
 	bool myNeatControl = false;
 	Neat::Genome* myGenome = nullptr;
+
+	std::unique_ptr<Neat::BackgroundTraining> myTraining;
+	TrainingDashboard myDashboard;
 };
 
 void NeatCartPoleModule::OnInitialize()
@@ -54,12 +73,19 @@ void NeatCartPoleModule::OnInitialize()
 	myGui = myGuiEntity.AddComponent<Render::EntityGuiComponent>(myWindow, false);
 	myGui->myCallback = [this]() { OnGuiUpdate(); };
 
-	mySystem = new CartPole(0.0, 0.0, false);
+	Neat::Random random(Neat::EvolutionParams::GetRandomSeed(), 1);
+	mySystem = new CartPole(0.0, 0.0, false, random);
 	myGenome = new Neat::Genome("neat/cartPole");
+
+#if BACKGROUND_TRAINING
+	myTraining = std::make_unique<Neat::BackgroundTraining>();
+	myTraining->Start([this]() { TrainNeat(myTraining.get()); });
+#endif
 }
 
 void NeatCartPoleModule::OnFinalize()
 {
+	myTraining.reset();
 	SafeDelete(myGenome);
 	SafeDelete(mySystem);
 
@@ -84,20 +110,18 @@ void NeatCartPoleModule::OnUpdate(Core::Module::UpdateType aType)
 			enterPressed = false;
 		}
 
+		// The best genome of the background training takes control as soon as it improves, the system keeps its state
+		if (myTraining)
+			myTraining->GetBestGenome().ConsumeLatest(*myGenome);
+
 		if (myNeatControl)
 		{
-			std::vector<double> inputs;
-			inputs.push_back(mySystem->GetPoleAngle());
-			inputs.push_back(mySystem->myPoleVelocity);
-			inputs.push_back(mySystem->myCartPosition);
-			inputs.push_back(mySystem->myCartVelocity);
-			std::vector<double> outputs;
-			myGenome->Evaluate(inputs, outputs);
-
-			double force = 1.0;
-			if (outputs[0] < outputs[1])
-				force = -1.0;
-			mySystem->Update(force, Core::TimeModule::GetInstance()->GetDeltaTimeSec());
+			double observations[4];
+			double actions[2];
+			mySystem->Observe(observations);
+			myGenome->Evaluate(observations, actions);
+			mySystem->Act(actions);
+			mySystem->Update(mySystem->myActionForce, Core::TimeModule::GetInstance()->GetDeltaTimeSec());
 		}
 		else
 		{
@@ -129,95 +153,103 @@ void NeatCartPoleModule::OnGuiUpdate()
 	{
 		ImGui::Text("Manual control");
 	}
+
+	if (myTraining)
+		myDashboard.Draw(myTraining->GetTelemetry(), myTraining->IsRunning());
 }
 
-void EvaluatePopulationAsync(Thread::WorkerPool& aPool, CartPoles& someSystems, Neat::Population& aPopulation, size_t aStartIdx, size_t aEndIdx)
+double EvaluateGenome(Neat::Genome& aGenome, CartPoleBatch& aBatch, Neat::EpisodeRunner& aRunner, double aFitnessCutoff, bool& anOutIsPruned)
 {
-	aPool.RequestJob([&someSystems, &aPopulation, aStartIdx, aEndIdx]() {
-		for (size_t i = aStartIdx; i < aEndIdx; ++i)
-		{
-			if (Neat::Genome* genome = aPopulation.GetGenome(i))
-			{
-				double fitness = 0.0;
-				
-				double deltaTime = 0.02;
-				uint maxSteps = static_cast<uint>(30.0 / deltaTime);
-				double fitnessStep = 1.0 / static_cast<double>(maxSteps * someSystems.size());
-
-				for (CartPole system : someSystems)
-				{
-					system.Reset();
-
-					for (uint t = 0; t < maxSteps; ++t)
-					{
-						std::vector<double> inputs;
-						inputs.push_back(system.GetPoleAngle());
-						inputs.push_back(system.myPoleVelocity);
-						inputs.push_back(system.myCartPosition);
-						inputs.push_back(system.myCartVelocity);
-						std::vector<double> outputs;
-						genome->Evaluate(inputs, outputs);
-
-						double force = 1.0;
-						if (outputs[0] < outputs[1])
-							force = -1.0;
-						
-						system.Update(force, deltaTime);
-						
-						if (!system.IsPoleUp())
-							continue;
-						if (!system.IsSlowAndCentered())
-							continue;
-
-						fitness += fitnessStep;
-					}
-				}
-
-				genome->SetFitness(fitness);
-			}
-		}
-	});
+	// Average ratio of rewarded steps, all the systems are stepped in lockstep
+	double maxReward = static_cast<double>(aBatch.GetMaxSteps()) * aBatch.GetBatchSize();
+	double reward = aRunner.Run(aGenome, aBatch, aFitnessCutoff * maxReward);
+	anOutIsPruned = aRunner.IsPruned();
+	return reward / maxReward;
 }
 
-void TrainNeat()
+double EvaluateScenarios(Neat::Genome& aGenome, CartPoleBatch& aBatch, Neat::EpisodeRunner& aRunner)
+{
+	// Sum of the ratios of rewarded steps of the systems of the batch
+	return aRunner.Run(aGenome, aBatch) / aBatch.GetMaxSteps();
+}
+
+void TrainNeat(Neat::BackgroundTraining* aBackgroundTraining /*= nullptr*/)
 {
 	Thread::WorkerPool threadPool(Thread::WorkerPriority::High);
 #if DEBUG_BUILD
 	threadPool.SetWorkersCount(3); // Using several threads is slower in Debug...
 #else
-	threadPool.SetWorkersCount();
+	// The background training leaves a core to the rendering
+	threadPool.SetWorkersCount(aBackgroundTraining ? std::max(std::thread::hardware_concurrency(), 2u) - 1 : UINT_MAX);
 #endif
 
+	// Control tasks don't need double precision, and the float rational backend vectorizes well
+	Neat::EvolutionParams::ourPhenotypePrecision = Neat::Phenotype::Precision::Float;
+	Neat::EvolutionParams::ourPhenotypeActivation = Neat::Phenotype::Activation::Rational;
+
+	// The populations fork their streams from the stream 0
+	Neat::Random random(Neat::EvolutionParams::GetRandomSeed(), 1);
+
 	CartPoles systems;
 	uint systemsCount = 10;
 	systems.reserve(systemsCount);
 	for (uint i = 0; i < systemsCount; ++i)
-		systems.push_back(CartPole(0.0, 1.0, false));
+		systems.push_back(CartPole(0.0, 1.0, false, random));
 
-	CartPolePool systemsPool;
-	systemsPool.resize(threadPool.GetWorkersCount(), systems);
+	CartPoleBatchPool systemsPool;
+	systemsPool.resize(threadPool.GetWorkersCount(), CartPoleBatch(systems));
 
 	Neat::Population population = Neat::Population(200, 4, 2);
 	Neat::Population::TrainingCallbacks callbacks;
 
-	callbacks.myEvaluateGenomes = [&population, &threadPool, &systemsPool]() {
-		size_t runPerThread = population.GetSize() / threadPool.GetWorkersCount() + 1;
-		size_t startIdx = 0;
-		uint systemPoolIdx = 0;
-		while (startIdx < population.GetSize())
+	callbacks.myParallelFor = [&threadPool](size_t aCount, const std::function<void(size_t)>& aJob) {
+		threadPool.ParallelFor(aCount, aJob);
+	};
+
+	// Every worker resets its own systems and reuses its own buffers, nothing is allocated while evaluating
+	std::vector<Neat::EpisodeRunner> runners(threadPool.GetWorkersCount());
+	Neat::Evaluator evaluator(threadPool.GetWorkersCount(), [&systemsPool, &runners](Neat::Genome& aGenome, size_t aWorkerIdx, double aFitnessCutoff, bool& anOutIsPruned) {
+		return EvaluateGenome(aGenome, systemsPool[aWorkerIdx], runners[aWorkerIdx], aFitnessCutoff, anOutIsPruned);
+	});
+#if USE_PRUNING
+	evaluator.EnablePruning(0.5);
+#endif
+#if USE_RACING
+	// All the genomes on 2 systems, the best half on 4, the best quarter on 8 and the best eighth on all of them.
+	// Every worker has a batch of the systems of each rung.
+	std::vector<CartPoleBatchPool> rungsSystemsPool(threadPool.GetWorkersCount());
+	evaluator.EnableRacing([&evaluator, &rungsSystemsPool, &runners](Neat::Genome& aGenome, size_t aWorkerIdx, size_t aFirstSystemIdx, size_t /*aSystemsCount*/) {
+		const std::vector<size_t>& rungs = evaluator.GetRungs();
+		size_t rungIdx = std::upper_bound(rungs.begin(), rungs.end(), aFirstSystemIdx) - rungs.begin();
+		return EvaluateScenarios(aGenome, rungsSystemsPool[aWorkerIdx][rungIdx], runners[aWorkerIdx]);
+	}, systems.size(), 2, 0.5);
+	for (CartPoleBatchPool& rungsSystems : rungsSystemsPool)
+	{
+		size_t firstSystemIdx = 0;
+		for (size_t endSystemIdx : evaluator.GetRungs())
 		{
-			EvaluatePopulationAsync(threadPool, systemsPool[systemPoolIdx], population, startIdx, startIdx + runPerThread);
-			startIdx = std::min(population.GetSize(), startIdx + runPerThread);
-			systemPoolIdx++;
+			rungsSystems.push_back(CartPoleBatch(CartPoles(systems.begin() + firstSystemIdx, systems.begin() + endSystemIdx)));
+			firstSystemIdx = endSystemIdx;
 		}
-		threadPool.WaitIdle();
+	}
+#endif
+#if !USE_RACING
+	// The systems are the same at every generation, the fitness only depends on the phenotype
+	population.EnableFitnessCache(true);
+#endif
+	callbacks.myEvaluateGenomes = [&population, &evaluator, &callbacks]() {
+		evaluator.EvaluateGenomes(population, callbacks.myParallelFor);
 	};
 
 	int generationIdx = 0;
-	callbacks.myOnTrainGenerationEnd = [&population, &generationIdx]() {
+	callbacks.myOnTrainGenerationEnd = [&population, &evaluator, &generationIdx]() {
 		population.Check();
 		std::cout << "Population Size : " << population.GetSize() << std::endl;
 		std::cout << "Species Count : " << population.GetSpecies().size() << std::endl;
+		std::cout << "Evaluation Utilization : " << 100.0 * evaluator.GetStats().GetUtilization() << "%" << std::endl;
+		std::cout << "Pruned Evaluations : " << evaluator.GetStats().myPrunedCount << std::endl;
+		std::cout << "Fitness Cache Hits : " << 100.0 * population.GetFitnessCacheStats().GetHitRate() << "%" << std::endl;
+		std::cout << "Saved Evaluations : " << 100.0 * evaluator.GetStats().GetSavedEvaluationsRatio() << "%" << std::endl;
 		if (const Neat::Genome* bestGenome = population.GetBestGenome())
 		{
 			std::cout << "Generation " << generationIdx << ": Best Fitness : " << bestGenome->GetFitness() << std::endl;
@@ -234,11 +266,35 @@ void TrainNeat()
 
 	uint64 startTime = Core::TimeModule::GetInstance()->GetCurrentTimeMs();
 
-	population.TrainGenerations(callbacks, 500, 1.0);
+#if USE_STEADY_STATE
+	// As many evaluations as 500 generations
+	Neat::Population::SteadyStateCallbacks steadyStateCallbacks;
+	steadyStateCallbacks.myParallelFor = callbacks.myParallelFor;
+	steadyStateCallbacks.myEvaluateGenome = [&systemsPool, &runners](Neat::Genome& aGenome, size_t aWorkerIdx) {
+		bool isPruned = false;
+		return EvaluateGenome(aGenome, systemsPool[aWorkerIdx], runners[aWorkerIdx], -DBL_MAX, isPruned);
+	};
+	steadyStateCallbacks.myOnRespeciation = [&population]() {
+		std::cout << "Species Count : " << population.GetSpecies().size() << std::endl;
+		if (const Neat::Genome* bestGenome = population.GetBestGenome())
+			std::cout << "Generation " << population.GetGeneration() << ": Best Fitness : " << bestGenome->GetFitness() << std::endl;
+	};
+	population.TrainSteadyState(steadyStateCallbacks, threadPool.GetWorkersCount(), 500 * population.GetSize(), 1.0);
+	std::cout << "Evaluations per second : " << population.GetSteadyStateStats().GetEvaluationsPerSec() << std::endl;
+#else
+	if (aBackgroundTraining)
+		aBackgroundTraining->TrainGenerations(population, callbacks, 500, 1.0);
+	else
+		population.TrainGenerations(callbacks, 500, 1.0);
+#endif
 
 	uint64 duration = Core::TimeModule::GetInstance()->GetCurrentTimeMs() - startTime;
 	std::cout << "Training duration (ms) : " << duration << std::endl;
 
+	// A training interrupted by closing the window doesn't replace the saved genome
+	if (aBackgroundTraining && aBackgroundTraining->IsStopRequested())
+		return;
+
 	if (const Neat::Genome* bestGenome = population.GetBestGenome())
 	{
 		bestGenome->SaveToFile("neat/cartPole");
@@ -246,6 +302,83 @@ void TrainNeat()
 	}
 }
 
+// Workers, systems and evaluator of an island
+struct CartPoleIsland
+{
+	Thread::WorkerPool myThreadPool;
+	CartPoleBatchPool mySystemsPool;
+	std::vector<Neat::EpisodeRunner> myRunners;
+	std::unique_ptr<Neat::Evaluator> myEvaluator;
+};
+
+void TrainNeatIslands()
+{
+	// Control tasks don't need double precision, and the float rational backend vectorizes well
+	Neat::EvolutionParams::ourPhenotypePrecision = Neat::Phenotype::Precision::Float;
+	Neat::EvolutionParams::ourPhenotypeActivation = Neat::Phenotype::Activation::Rational;
+
+	// The populations fork their streams from the stream 0
+	Neat::Random random(Neat::EvolutionParams::GetRandomSeed(), 1);
+
+	CartPoles systems;
+	uint systemsCount = 10;
+	systems.reserve(systemsCount);
+	for (uint i = 0; i < systemsCount; ++i)
+		systems.push_back(CartPole(0.0, 1.0, false, random));
+
+	// The islands run on their own worker each, and evaluate their genomes on their share of the cores
+	Thread::WorkerPool islandsThreadPool(Thread::WorkerPriority::High);
+	islandsThreadPool.SetWorkersCount(ISLANDS_COUNT);
+	uint islandWorkersCount = std::max(std::thread::hardware_concurrency() / ISLANDS_COUNT, 1u);
+
+	// Every island has as many genomes as the single population of TrainNeat, and sends its 2 best genomes to the next one every 5 generations
+	Neat::IslandModel islands(ISLANDS_COUNT, 200, 4, 2);
+	islands.SetMigration(Neat::IslandModel::Topology::Ring, 5, 2);
+
+	std::vector<std::unique_ptr<CartPoleIsland>> islandsStates;
+	std::vector<Neat::Population::TrainingCallbacks> islandsCallbacks(islands.GetIslandsCount());
+	for (size_t i = 0; i < islands.GetIslandsCount(); ++i)
+	{
+		CartPoleIsland& island = *islandsStates.emplace_back(std::make_unique<CartPoleIsland>());
+		island.myThreadPool.SetWorkersCount(islandWorkersCount);
+		island.mySystemsPool.resize(islandWorkersCount, CartPoleBatch(systems));
+		island.myRunners.resize(islandWorkersCount);
+		island.myEvaluator = std::make_unique<Neat::Evaluator>(islandWorkersCount, [&island](Neat::Genome& aGenome, size_t aWorkerIdx, double aFitnessCutoff, bool& anOutIsPruned) {
+			return EvaluateGenome(aGenome, island.mySystemsPool[aWorkerIdx], island.myRunners[aWorkerIdx], aFitnessCutoff, anOutIsPruned);
+		});
+
+		// The systems are the same at every generation, the fitness only depends on the phenotype
+		Neat::Population& population = islands.GetIsland(i);
+		population.EnableFitnessCache(true);
+
+		Neat::Population::TrainingCallbacks& callbacks = islandsCallbacks[i];
+		callbacks.myParallelFor = [&island](size_t aCount, const std::function<void(size_t)>& aJob) {
+			island.myThreadPool.ParallelFor(aCount, aJob);
+		};
+		callbacks.myEvaluateGenomes = [&population, &island, &callbacks]() {
+			island.myEvaluator->EvaluateGenomes(population, callbacks.myParallelFor);
+		};
+	}
+
+	uint64 startTime = Core::TimeModule::GetInstance()->GetCurrentTimeMs();
+
+	islands.TrainGenerations(islandsCallbacks, [&islandsThreadPool](size_t aCount, const std::function<void(size_t)>& aJob) {
+		islandsThreadPool.ParallelFor(aCount, aJob);
+	}, 500, 1.0);
+
+	uint64 duration = Core::TimeModule::GetInstance()->GetCurrentTimeMs() - startTime;
+	const Neat::IslandModel::Stats& stats = islands.GetStats();
+	std::cout << "Training duration (ms) : " << duration << std::endl;
+	std::cout << "Generations : " << stats.myGenerationsCount << std::endl;
+	std::cout << "Migrations duration (ms) : " << 1000.0 * stats.myMigrationsDurationSec << std::endl;
+
+	if (const Neat::Genome* bestGenome = islands.GetBestGenome())
+	{
+		bestGenome->SaveToFile("neat/cartPole");
+		std::cout << "Best Fitness : " << bestGenome->GetFitness() << std::endl;
+	}
+}
+
 int main()
 {
 	InitMemoryLeaksDetection();
@@ -257,6 +390,7 @@ int main()
 	Neat::EvolutionParams::SetRandomSeed(seed);
 
 	//TrainNeat();
+	//TrainNeatIslands();
 
 	Render::RenderModule::Register();
 	NeatCartPoleModule::Register();
@@ -24,6 +24,30 @@ void DoubleCartPoleBase::Reset()
 	myState[3] = myInitState[3];
 	myState[4] = myInitState[4];
 	myState[5] = myInitState[5];
+	myActionForce = 0.0;
+	myStepIdx = 0;
+}
+
+void DoubleCartPoleBase::Observe(std::span<double> someOutObservations) const
+{
+	someOutObservations[0] = GetCartPosition();
+	someOutObservations[1] = GetPole1Angle();
+	someOutObservations[2] = GetPole2Angle();
+	someOutObservations[3] = GetCartVelocity();
+	someOutObservations[4] = GetPole1Velocity();
+	someOutObservations[5] = GetPole2Velocity();
+}
+
+void DoubleCartPoleBase::Act(std::span<const double> someActions)
+{
+	myActionForce = someActions[0] < someActions[1] ? -1.0 : 1.0;
+}
+
+double DoubleCartPoleBase::Step()
+{
+	Update(myActionForce, myDeltaTime);
+	myStepIdx++;
+	return ArePolesUp() ? 1.0 : 0.0;
 }
 
 void DoubleCartPoleBase::Update(double aForceAmplitude, double aDeltaTime)
@@ -45,19 +69,19 @@ void DoubleCartPoleBase::RK4(double aForce, double aDeltaTime)
 {
 	double k1[6], k2[6], k3[6], k4[6], tmp[6];
 
-	Step(k1, myState, aForce);
+	ComputeDerivatives(k1, myState, aForce);
 
 	for (uint i = 0; i < 6; ++i)
 		tmp[i] = myState[i] + (aDeltaTime / 2.0) * k1[i];
-	Step(k2, tmp, aForce);
+	ComputeDerivatives(k2, tmp, aForce);
 
 	for (uint i = 0; i < 6; ++i)
 		tmp[i] = myState[i] + (aDeltaTime / 2.0) * k2[i];
-	Step(k3, tmp, aForce);
+	ComputeDerivatives(k3, tmp, aForce);
 
 	for (uint i = 0; i < 6; ++i)
 		tmp[i] = myState[i] + aDeltaTime * k3[i];
-	Step(k4, tmp, aForce);
+	ComputeDerivatives(k4, tmp, aForce);
 
 	for (uint i = 0; i < 6; ++i)
 		myState[i] = myState[i] + (aDeltaTime / 6.0) * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
@@ -89,7 +113,7 @@ void DoubleCartPole::Draw()
 	draw_list->AddLine(cartPos, pole2EndPos, 0xFF0000FF, 5.f);
 }
 
-void DoubleCartPole::Step(double* dydt, double* y, double aForce)
+void DoubleCartPole::ComputeDerivatives(double* dydt, double* y, double aForce)
 {
 	dydt[0] = y[3];
 	dydt[1] = y[4];
@@ -143,7 +167,7 @@ void DoubleCartPole2::Draw()
 	draw_list->AddLine(pole1EndPos, pole2EndPos, 0xFF0000FF, 5.f);
 }
 
-void DoubleCartPole2::Step(double* dydt, double* y, double aForce)
+void DoubleCartPole2::ComputeDerivatives(double* dydt, double* y, double aForce)
 {
 	dydt[0] = y[3];
 	dydt[1] = y[4];
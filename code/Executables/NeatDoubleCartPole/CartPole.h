@@ -1,14 +1,29 @@
 #pragma once
 
-class DoubleCartPoleBase
+#include "Environment.h"
+
+class DoubleCartPoleBase : public Neat::Environment
 {
 public:
 	DoubleCartPoleBase();
 	virtual ~DoubleCartPoleBase() {}
-	void Reset();
+	void Reset() override;
 	void Update(double aForceAmplitude, double aDeltaTime);
 	virtual void Draw() = 0;
 
+	// Neat::Environment, rewarded while both poles are up
+	size_t GetObservationsCount() const override { return 6; }
+	size_t GetActionsCount() const override { return 2; }
+	void Observe(std::span<double> someOutObservations) const override;
+	void Act(std::span<const double> someActions) override;
+	double Step() override;
+	bool IsDone() const override { return myStepIdx >= myMaxSteps; }
+	double GetRewardBound() const override { return static_cast<double>(myMaxSteps - myStepIdx); } // At most 1 per step
+
+	inline bool ArePolesUp() const { return std::abs(GetPole1Angle()) < myPoleFailureAngle && std::abs(GetPole2Angle()) < myPoleFailureAngle; }
+	inline double GetActionForce() const { return myActionForce; }
+	inline uint GetMaxSteps() const { return myMaxSteps; }
+
 	inline double GetCartPosition() const { return myState[0]; }
 	inline double GetPole1Angle() const { return std::atan2(std::sin(myState[1]), std::cos(myState[1])); }
 	inline double GetPole2Angle() const { return std::atan2(std::sin(myState[2]), std::cos(myState[2])); }
@@ -17,7 +32,9 @@ public:
 	inline double GetPole2Velocity() const { return myState[5]; }
 
 protected:
-	virtual void Step(double* dydt, double* y, double aForce) = 0;
+	friend class DoubleCartPoleBatchBase;
+
+	virtual void ComputeDerivatives(double* dydt, double* y, double aForce) = 0;
 
 	// Runge - Kutta 4th order integration method
 	void RK4(double aForce, double aDeltaTime);
@@ -42,6 +59,11 @@ protected:
 	double myState[6];
 	double myInitState[6];
 
+	double myActionForce = 0.0; // Chosen by the last Act
+	double myDeltaTime = 0.02;
+	uint myMaxSteps = 1500; // 30 seconds
+	uint myStepIdx = 0;
+
 };
 
 class DoubleCartPole : public DoubleCartPoleBase
@@ -50,7 +72,7 @@ public:
 	void Draw() override;
 
 private:
-	void Step(double* dydt, double* y, double aForce) override;
+	void ComputeDerivatives(double* dydt, double* y, double aForce) override;
 };
 
 class DoubleCartPole2 : public DoubleCartPoleBase
@@ -59,5 +81,5 @@ public:
 	void Draw() override;
 
 private:
-	void Step(double* dydt, double* y, double aForce) override;
+	void ComputeDerivatives(double* dydt, double* y, double aForce) override;
 };
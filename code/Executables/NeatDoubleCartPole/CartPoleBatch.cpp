@@ -0,0 +1,246 @@
+#include "CartPoleBatch.h"
+
+DoubleCartPoleBatchBase::DoubleCartPoleBatchBase(const DoubleCartPoleBase& aSystem, size_t aBatchSize)
+{
+	myCartTrackSize = aSystem.myCartTrackSize;
+	myPole1Length = aSystem.myPole1Length;
+	myPole2Length = aSystem.myPole2Length;
+	myCartMass = aSystem.myCartMass;
+	myPole1Mass = aSystem.myPole1Mass;
+	myPole2Mass = aSystem.myPole2Mass;
+	myGravity = aSystem.myGravity;
+	myInputForce = aSystem.myInputForce;
+	myPoleFailureAngle = aSystem.myPoleFailureAngle;
+	myPoleFriction = aSystem.myPoleFriction;
+	myDeltaTime = aSystem.myDeltaTime;
+	myMaxSteps = aSystem.myMaxSteps;
+
+	myInitStates.resize(ourStateSize * aBatchSize);
+	for (size_t i = 0; i < ourStateSize; ++i)
+		std::fill_n(myInitStates.begin() + i * aBatchSize, aBatchSize, aSystem.myInitState[i]);
+
+	myStates.resize(ourStateSize * aBatchSize);
+	myWrappedPoleAngles.resize(2 * aBatchSize);
+	myActionForces.resize(aBatchSize);
+	myForces.resize(aBatchSize);
+	myK1.resize(ourStateSize * aBatchSize);
+	myK2.resize(ourStateSize * aBatchSize);
+	myK3.resize(ourStateSize * aBatchSize);
+	myK4.resize(ourStateSize * aBatchSize);
+	myTmp.resize(ourStateSize * aBatchSize);
+	Reset();
+}
+
+void DoubleCartPoleBatchBase::Reset()
+{
+	myStates = myInitStates;
+	std::fill(myActionForces.begin(), myActionForces.end(), 0.0);
+	WrapPoleAngles();
+	myStepIdx = 0;
+}
+
+void DoubleCartPoleBatchBase::Observe(std::span<double> someOutObservations) const
+{
+	const size_t count = GetBatchSize();
+	const double* y = myStates.data();
+	double* observations = someOutObservations.data();
+
+	// Same as DoubleCartPoleBase::Observe
+	for (size_t s = 0; s < count; ++s)
+	{
+		observations[s] = y[s];
+		observations[count + s] = myWrappedPoleAngles[s];
+		observations[2 * count + s] = myWrappedPoleAngles[count + s];
+		observations[3 * count + s] = y[3 * count + s];
+		observations[4 * count + s] = y[4 * count + s];
+		observations[5 * count + s] = y[5 * count + s];
+	}
+}
+
+void DoubleCartPoleBatchBase::Act(std::span<const double> someActions)
+{
+	const size_t count = GetBatchSize();
+	const double* actions0 = someActions.data();
+	const double* actions1 = actions0 + count;
+
+	for (size_t s = 0; s < count; ++s)
+		myActionForces[s] = actions0[s] < actions1[s] ? -1.0 : 1.0;
+}
+
+double DoubleCartPoleBatchBase::Step()
+{
+	const size_t count = GetBatchSize();
+	double* y = myStates.data();
+
+	// Same as DoubleCartPoleBase::Update, the carts can't be pushed or move past the end of the track
+	for (size_t s = 0; s < count; ++s)
+	{
+		double amplitude = myActionForces[s];
+		bool isBlocked = (amplitude > 0.0 && y[s] >= myCartTrackSize) || (amplitude < 0.0 && y[s] <= -myCartTrackSize);
+		myForces[s] = (isBlocked ? 0.0 : amplitude) * myInputForce;
+	}
+
+	RK4(myDeltaTime);
+
+	for (size_t s = 0; s < count; ++s)
+	{
+		double cartVelocity = y[3 * count + s];
+		bool isStopped = (cartVelocity > 0.0 && y[s] >= myCartTrackSize) || (cartVelocity < 0.0 && y[s] <= -myCartTrackSize);
+		y[3 * count + s] = isStopped ? 0.0 : cartVelocity;
+	}
+
+	WrapPoleAngles();
+	myStepIdx++;
+
+	// Same as DoubleCartPoleBase::ArePolesUp
+	double reward = 0.0;
+	for (size_t s = 0; s < count; ++s)
+	{
+		bool isPole1Up = std::abs(myWrappedPoleAngles[s]) < myPoleFailureAngle;
+		bool isPole2Up = std::abs(myWrappedPoleAngles[count + s]) < myPoleFailureAngle;
+		reward += isPole1Up && isPole2Up ? 1.0 : 0.0;
+	}
+	return reward;
+}
+
+void DoubleCartPoleBatchBase::WrapPoleAngles()
+{
+	const size_t count = GetBatchSize();
+	const double* y = myStates.data();
+
+	// Same as DoubleCartPoleBase::GetPole1Angle and DoubleCartPoleBase::GetPole2Angle
+	for (size_t s = 0; s < count; ++s)
+	{
+		myWrappedPoleAngles[s] = std::atan2(std::sin(y[count + s]), std::cos(y[count + s]));
+		myWrappedPoleAngles[count + s] = std::atan2(std::sin(y[2 * count + s]), std::cos(y[2 * count + s]));
+	}
+}
+
+void DoubleCartPoleBatchBase::RK4(double aDeltaTime)
+{
+	const size_t size = myStates.size();
+	double* y = myStates.data();
+	double* k1 = myK1.data();
+	double* k2 = myK2.data();
+	double* k3 = myK3.data();
+	double* k4 = myK4.data();
+	double* tmp = myTmp.data();
+
+	ComputeDerivatives(k1, y);
+
+	for (size_t i = 0; i < size; ++i)
+		tmp[i] = y[i] + (aDeltaTime / 2.0) * k1[i];
+	ComputeDerivatives(k2, tmp);
+
+	for (size_t i = 0; i < size; ++i)
+		tmp[i] = y[i] + (aDeltaTime / 2.0) * k2[i];
+	ComputeDerivatives(k3, tmp);
+
+	for (size_t i = 0; i < size; ++i)
+		tmp[i] = y[i] + aDeltaTime * k3[i];
+	ComputeDerivatives(k4, tmp);
+
+	for (size_t i = 0; i < size; ++i)
+		y[i] = y[i] + (aDeltaTime / 6.0) * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
+}
+
+void DoubleCartPoleBatch::ComputeDerivatives(double* dydt, const double* y) const
+{
+	const size_t count = GetBatchSize();
+
+	static const double MUP = 0.000002;
+
+	for (size_t s = 0; s < count; ++s)
+	{
+		double angle1 = y[count + s];
+		double angle2 = y[2 * count + s];
+		double velocity1 = y[4 * count + s];
+		double velocity2 = y[5 * count + s];
+
+		double sin1 = std::sin(angle1);
+		double cos1 = std::cos(angle1);
+		double sin2 = std::sin(angle2);
+		double cos2 = std::cos(angle2);
+
+		double tmp1 = MUP * velocity1 / (myPole1Length * myPole1Mass);
+		double tmp2 = MUP * velocity2 / (myPole2Length * myPole2Mass);
+
+		double f1 = (myPole1Length * myPole1Mass * velocity1 * velocity1 * sin1) +
+			(0.75 * myPole1Mass * cos1 * (tmp1 - myGravity * sin1));
+		double f2 = (myPole2Length * myPole2Mass * velocity2 * velocity2 * sin2) +
+			(0.75 * myPole2Mass * cos2 * (tmp2 - myGravity * sin2));
+
+		double m1 = myPole1Mass * (1.0 - (0.75 * cos1 * cos1));
+		double m2 = myPole2Mass * (1.0 - (0.75 * cos2 * cos2));
+
+		double cartAcceleration = (myForces[s] + f1 + f2) / (m1 + m2 + myCartMass);
+
+		dydt[s] = y[3 * count + s];
+		dydt[count + s] = velocity1;
+		dydt[2 * count + s] = velocity2;
+		dydt[3 * count + s] = cartAcceleration;
+		dydt[4 * count + s] = -0.75 * (cartAcceleration * cos1 - myGravity * sin1 + tmp1) / myPole1Length - myPoleFriction * velocity1;
+		dydt[5 * count + s] = -0.75 * (cartAcceleration * cos2 - myGravity * sin2 + tmp2) / myPole2Length - myPoleFriction * velocity2;
+	}
+}
+
+void DoubleCartPole2Batch::ComputeDerivatives(double* dydt, const double* y) const
+{
+	const size_t count = GetBatchSize();
+
+	const double z1 = myCartMass + myPole1Mass + myPole2Mass;
+	const double z2 = myPole1Mass * myPole1Length + myPole2Mass * 2.0 * myPole1Length;
+	const double z3 = myPole2Mass * myPole2Length;
+	const double z4 = ((myPole1Mass / 3.0) + myPole2Mass) * (2.0 * myPole1Length) * (2.0 * myPole1Length);
+	const double z5 = myPole2Mass * 2.0 * myPole1Length * myPole2Length;
+	const double z6 = myPole2Mass * (2.0 * myPole2Length) * (2.0 * myPole2Length) / 3.0;
+	const double f1 = z2 * myGravity;
+	const double f2 = z3 * myGravity;
+
+	for (size_t s = 0; s < count; ++s)
+	{
+		double angle1 = y[count + s];
+		double angle2 = y[2 * count + s];
+		double cartVelocity = y[3 * count + s];
+		double velocity1 = y[4 * count + s];
+		double velocity2 = y[5 * count + s];
+
+		double sin1 = std::sin(angle1);
+		double cos1 = std::cos(angle1);
+		double sin2 = std::sin(angle2);
+		double cos2 = std::cos(angle2);
+		double sin1m2 = std::sin(angle1 - angle2);
+		double cos1m2 = std::cos(angle1 - angle2);
+
+		// Symmetric mass matrix M = | a b c |
+		//                           | b d e |
+		//                           | c e f |
+		double a = z1;
+		double b = z2 * cos1;
+		double c = z3 * cos2;
+		double d = z4;
+		double e = z5 * cos1m2;
+		double f = z6;
+
+		// M * ddy = H - G - C * dy, with C * dy computed as the column major C of DoubleCartPole2::ComputeDerivatives
+		double r0 = myForces[s];
+		double r1 = f1 * sin1 + (z2 * sin1 * velocity1 * cartVelocity + z5 * sin1m2 * velocity1 * velocity2);
+		double r2 = f2 * sin2 + (z3 * sin2 * velocity2 * cartVelocity - z5 * sin1m2 * velocity2 * velocity1);
+
+		// Closed-form solve with the cofactors of M instead of inverting it
+		double A00 = d * f - e * e;
+		double A01 = c * e - b * f;
+		double A02 = b * e - c * d;
+		double A11 = a * f - c * c;
+		double A12 = b * c - a * e;
+		double A22 = a * d - b * b;
+		double invDeterminant = 1.0 / (a * A00 + b * A01 + c * A02);
+
+		dydt[s] = cartVelocity;
+		dydt[count + s] = velocity1;
+		dydt[2 * count + s] = velocity2;
+		dydt[3 * count + s] = (A00 * r0 + A01 * r1 + A02 * r2) * invDeterminant;
+		dydt[4 * count + s] = (A01 * r0 + A11 * r1 + A12 * r2) * invDeterminant - myPoleFriction * velocity1;
+		dydt[5 * count + s] = (A02 * r0 + A12 * r1 + A22 * r2) * invDeterminant - myPoleFriction * velocity2;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "CartPole.h"
+
+// Double cart poles stepped in lockstep, with one array per state variable so the RK4 steps vectorize over the instances.
+// Steps like DoubleCartPoleBase::Step, all the instances start from the state and use the parameters of aSystem.
+class DoubleCartPoleBatchBase : public Neat::BatchEnvironment
+{
+public:
+	DoubleCartPoleBatchBase(const DoubleCartPoleBase& aSystem, size_t aBatchSize);
+	virtual ~DoubleCartPoleBatchBase() {}
+
+	size_t GetBatchSize() const override { return myForces.size(); }
+	size_t GetObservationsCount() const override { return 6; }
+	size_t GetActionsCount() const override { return 2; }
+
+	void Reset() override;
+	void Observe(std::span<double> someOutObservations) const override;
+	void Act(std::span<const double> someActions) override;
+	double Step() override;
+	bool IsDone() const override { return myStepIdx >= myMaxSteps; }
+	double GetRewardBound() const override { return static_cast<double>(myMaxSteps - myStepIdx) * GetBatchSize(); }
+
+	uint GetMaxSteps() const { return myMaxSteps; }
+
+protected:
+	static constexpr size_t ourStateSize = 6;
+
+	// The states are SoA: the variable i of the instance s is at [i * GetBatchSize() + s], see DoubleCartPoleBase::myState
+	virtual void ComputeDerivatives(double* dydt, const double* y) const = 0;
+
+	// Runge - Kutta 4th order integration method
+	void RK4(double aDeltaTime);
+	void WrapPoleAngles();
+
+	double myCartTrackSize = 2.5;
+	double myPole1Length = 0.5; // Half
+	double myPole2Length = 0.25; // Half
+	double myCartMass = 1.0;
+	double myPole1Mass = 0.1;
+	double myPole2Mass = 0.05;
+	double myGravity = 9.81;
+	double myInputForce = 10.0;
+	double myPoleFailureAngle = 0.628329;
+	double myPoleFriction = 0.05;
+
+	std::vector<double> myInitStates;
+	std::vector<double> myStates;
+	std::vector<double> myWrappedPoleAngles; // Pole1 then Pole2, in [-PI, PI], computed once per step for the reward and the observations
+	std::vector<double> myActionForces;
+	std::vector<double> myForces; // Applied to the carts, 0 when pushing against the end of the track
+
+	// RK4 scratch states
+	std::vector<double> myK1, myK2, myK3, myK4, myTmp;
+
+	double myDeltaTime = 0.02;
+	uint myMaxSteps = 1500;
+	uint myStepIdx = 0;
+};
+
+class DoubleCartPoleBatch : public DoubleCartPoleBatchBase
+{
+public:
+	using DoubleCartPoleBatchBase::DoubleCartPoleBatchBase;
+
+private:
+	void ComputeDerivatives(double* dydt, const double* y) const override;
+};
+
+class DoubleCartPole2Batch : public DoubleCartPoleBatchBase
+{
+public:
+	using DoubleCartPoleBatchBase::DoubleCartPoleBatchBase;
+
+private:
+	void ComputeDerivatives(double* dydt, const double* y) const override;
+};
@@ -0,0 +1,67 @@
+#include "CharactersSystem.h"
+
+#include "Genome.h"
+#include "Random.h"
+
+#include <numbers>
+#include <random>
+
+double EvaluateGenome(Neat::Genome& aGenome, CharactersSystems& someSystems, Neat::EpisodeRunner& aRunner, double aFitnessCutoff, bool& anOutIsPruned)
+{
+	// Average position fitness over the steps
+	double maxReward = 0.0;
+	for (const CharactersSystem& system : someSystems)
+		maxReward += system.myMaxSteps;
+
+	// A system is pruned when its reward can't reach the cutoff anymore, even if all the next systems get their max reward
+	double rewardCutoff = aFitnessCutoff * maxReward;
+	double reward = 0.0;
+	double nextSystemsMaxReward = maxReward;
+	for (CharactersSystem& system : someSystems)
+	{
+		nextSystemsMaxReward -= system.myMaxSteps;
+		reward += aRunner.Run(aGenome, system, rewardCutoff - reward - nextSystemsMaxReward);
+		if (aRunner.IsPruned())
+		{
+			anOutIsPruned = true;
+			return (reward + nextSystemsMaxReward) / maxReward;
+		}
+	}
+	return reward / maxReward;
+}
+
+double EvaluateScenarios(Neat::Genome& aGenome, CharactersSystems& someSystems, Neat::EpisodeRunner& aRunner, size_t aFirstSystemIdx, size_t aSystemsCount)
+{
+	// Sum of the average position fitness over the steps of each system
+	double score = 0.0;
+	for (size_t systemIdx = aFirstSystemIdx; systemIdx < aFirstSystemIdx + aSystemsCount; ++systemIdx)
+	{
+		CharactersSystem& system = someSystems[systemIdx];
+		score += aRunner.Run(aGenome, system) / system.myMaxSteps;
+	}
+	return score;
+}
+
+CharactersSystems CreateSystems(std::uint64_t aSeed)
+{
+	// The populations fork their streams from the stream 0
+	Neat::Random random(aSeed, 1);
+
+	CharactersSystems systems;
+	uint systemsCount = 100;
+	systems.reserve(systemsCount);
+	for (uint i = 0; i < systemsCount; ++i)
+	{
+		std::uniform_real_distribution<> randPos(-200.f, 200.f);
+		std::uniform_real_distribution<> randAngle(-std::numbers::pi, std::numbers::pi);
+	
+		glm::vec2 playerPos = glm::vec2((float)randPos(random), (float)randPos(random));
+		float playerDir = (float)randAngle(random);
+		glm::vec2 npcPos = glm::vec2((float)randPos(random), (float)randPos(random));
+		float npcDir = (float)randAngle(random);
+	
+		systems.push_back(CharactersSystem(playerPos, playerDir, npcPos, npcDir));
+	}
+	//systems.push_back(CharactersSystem(glm::vec2(-150.f, 0.f), (float)std::numbers::pi / 2.f, glm::vec2(150.f, 0.f), -(float)std::numbers::pi / 2.f));
+	return systems;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Character.h"
+
+#include "Environment.h"
+
+#include <cstdint>
+#include <vector>
+
+struct CharactersSystem : public Neat::Environment
+{
+	CharactersSystem(const glm::vec2& aPlayerPosition, float aPlayerDirection, const glm::vec2& aNPCPosition, float aNPCDirection)
+		: myPlayerInitPos(aPlayerPosition)
+		, myNPCInitPos(aNPCPosition)
+		, myPlayerInitDir(aPlayerDirection)
+		, myNPCInitDir(aNPCDirection)
+		, myPlayer(aPlayerPosition, aPlayerDirection, 20.f, glm::vec4(0.f, 0.f, 1.f, 1.f))
+		, myNPC(aNPCPosition, aNPCDirection, 20.f, glm::vec4(1.f, 0.f, 0.f, 1.f))
+	{}
+
+	void Reset() override
+	{
+		myPlayer.Reset(myPlayerInitPos, myPlayerInitDir);
+		myNPC.Reset(myNPCInitPos, myNPCInitDir);
+		myNPCForwardForce = 0.f;
+		myNPCRightForce = 0.f;
+		myNPCRotationForce = 0.f;
+		myStepIdx = 0;
+	}
+
+	// Neat::Environment, the NPC is rewarded for staying at a nice position relatively to the player
+	size_t GetObservationsCount() const override { return 3; }
+	size_t GetActionsCount() const override { return 6; }
+
+	void Observe(std::span<double> someOutObservations) const override
+	{
+		float distanceInfo;
+		float alignementInfo;
+		float aimInfo;
+		myNPC.GetBrainInputs(myPlayer, distanceInfo, alignementInfo, aimInfo);
+		someOutObservations[0] = distanceInfo;
+		someOutObservations[1] = alignementInfo;
+		someOutObservations[2] = aimInfo;
+	}
+
+	void Act(std::span<const double> someActions) override
+	{
+		myNPCForwardForce = someActions[0] > someActions[1] ? 1.f : -1.f;
+		myNPCRightForce = someActions[2] > someActions[3] ? 1.f : -1.f;
+		myNPCRotationForce = someActions[4] > someActions[5] ? 1.f : -1.f;
+	}
+
+	double Step() override
+	{
+		myNPC.Update(myDeltaTime, myNPCForwardForce, myNPCRightForce, myNPCRotationForce);
+		myStepIdx++;
+		return myNPC.ComputePositionFitness(myPlayer);
+	}
+
+	bool IsDone() const override { return myStepIdx >= myMaxSteps; }
+	double GetRewardBound() const override { return static_cast<double>(myMaxSteps - myStepIdx); } // The position fitness is at most 1
+
+	glm::vec2 myPlayerInitPos;
+	glm::vec2 myNPCInitPos;
+	float myPlayerInitDir;
+	float myNPCInitDir;
+	Character myPlayer;
+	Character myNPC;
+
+	// Forces chosen by the last Act
+	float myNPCForwardForce = 0.f;
+	float myNPCRightForce = 0.f;
+	float myNPCRotationForce = 0.f;
+
+	float myDeltaTime = 0.02f;
+	uint myMaxSteps = 500; // 10 seconds
+	uint myStepIdx = 0;
+};
+typedef std::vector<CharactersSystem> CharactersSystems;
+typedef std::vector<CharactersSystems> CharactersSystemPool;
+
+// The systems only depend on aSeed, so every process training or evaluating on them builds the same ones
+CharactersSystems CreateSystems(std::uint64_t aSeed);
+
+// Average position fitness over the steps of all the systems, see Neat::Evaluator::EvaluateGenome
+double EvaluateGenome(Neat::Genome& aGenome, CharactersSystems& someSystems, Neat::EpisodeRunner& aRunner, double aFitnessCutoff, bool& anOutIsPruned);
+// Sum of the average position fitness over the steps of each system, see Neat::Evaluator::EvaluateScenarios
+double EvaluateScenarios(Neat::Genome& aGenome, CharactersSystems& someSystems, Neat::EpisodeRunner& aRunner, size_t aFirstSystemIdx, size_t aSystemsCount);
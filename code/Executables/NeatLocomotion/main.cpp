@@ -1,9 +1,16 @@
-#include "Character.h"
+#include "CharactersSystem.h"
 
+#include "NeatCartPole/TrainingDashboard.h"
+
+#include "BackgroundTraining.h"
+#include "DistributedEvaluator.h"
+#include "Environment.h"
 #include "Genome.h"
+#include "Evaluator.h"
 #include "EvolutionParams.h"
 #include "Specie.h"
 #include "Population.h"
+#include "IslandModel.h"
 
 #include "Core_Facade.h"
 #include "Core_Module.h"
@@ -16,35 +23,19 @@
 #include "Render_EntityRenderComponent.h"
 #include "imgui_helpers.h"
 
+#include <filesystem>
 #include <iostream>
-#include <random>
+#include <memory>
+#include <thread>
 
-struct CharactersSystem
-{
-	CharactersSystem(const glm::vec2& aPlayerPosition, float aPlayerDirection, const glm::vec2& aNPCPosition, float aNPCDirection)
-		: myPlayer(aPlayerPosition, aPlayerDirection, 20.f, glm::vec4(0.f, 0.f, 1.f, 1.f))
-		, myNPC(aNPCPosition, aNPCDirection, 20.f, glm::vec4(1.f, 0.f, 0.f, 1.f))
-		, myPlayerInitPos(aPlayerPosition)
-		, myPlayerInitDir(aPlayerDirection)
-		, myNPCInitPos(aNPCPosition)
-		, myNPCInitDir(aNPCDirection)
-	{}
-
-	void Reset()
-	{
-		myPlayer.Reset(myPlayerInitPos, myPlayerInitDir);
-		myNPC.Reset(myNPCInitPos, myNPCInitDir);
-	}
+#define USE_PRUNING 0 // 1 to stop the evaluations that can't reach the median fitness of the generation anymore, faster but not deterministic
+#define USE_RACING 1 // 1 to evaluate only the best genomes on all the systems, the others are ranked on fewer systems
+#define ISLANDS_COUNT 4 // Populations of TrainNeatIslands, each trained on its own share of the workers
+#define DISTRIBUTED_WORKERS_COUNT 8 // Processes of TrainNeatDistributed, each evaluating on a single thread
+#define BACKGROUND_TRAINING 0 // 1 to run TrainNeat while the window is open, with a dashboard of the generations and the best genome swapped into the view
 
-	glm::vec2 myPlayerInitPos;
-	glm::vec2 myNPCInitPos;
-	float myPlayerInitDir;
-	float myNPCInitDir;
-	Character myPlayer;
-	Character myNPC;
-};
-typedef std::vector<CharactersSystem> CharactersSystems;
-typedef std::vector<CharactersSystems> CharactersSystemPool;
+void TrainNeat(Neat::BackgroundTraining* aBackgroundTraining = nullptr);
+#include <random>
 
 class NeatLocomotionModule : public Core::Module
 {
@@ -68,6 +59,9 @@ private:
 	CharactersSystem* mySystem = nullptr;
 	bool myNeatControl = false;
 	Neat::Genome* myGenome = nullptr;
+
+	std::unique_ptr<Neat::BackgroundTraining> myTraining;
+	TrainingDashboard myDashboard;
 };
 
 void NeatLocomotionModule::OnInitialize()
@@ -83,10 +77,16 @@ void NeatLocomotionModule::OnInitialize()
 
 	mySystem = new CharactersSystem(glm::vec2(-150.f, 0.f), (float)std::numbers::pi / 2.f, glm::vec2(150.f, 0.f), -(float)std::numbers::pi / 2.f);
 	myGenome = new Neat::Genome("neat/locomotion");
+
+#if BACKGROUND_TRAINING
+	myTraining = std::make_unique<Neat::BackgroundTraining>();
+	myTraining->Start([this]() { TrainNeat(myTraining.get()); });
+#endif
 }
 
 void NeatLocomotionModule::OnFinalize()
 {
+	myTraining.reset();
 	SafeDelete(myGenome);
 	SafeDelete(mySystem);
 
@@ -139,36 +139,18 @@ void NeatLocomotionModule::OnUpdate(Core::Module::UpdateType aType)
 			enterPressed = false;
 		}
 
+		// The best genome of the background training takes control of the NPC as soon as it improves
+		if (myTraining)
+			myTraining->GetBestGenome().ConsumeLatest(*myGenome);
+
 		if (myNeatControl)
 		{
-			float distanceInfo;
-			float alignementInfo;
-			float aimInfo;
-			mySystem->myNPC.GetBrainInputs(mySystem->myPlayer, distanceInfo, alignementInfo, aimInfo);
-
-			std::vector<double> inputs;
-			inputs.push_back(distanceInfo);
-			inputs.push_back(alignementInfo);
-			inputs.push_back(aimInfo);
-			std::vector<double> outputs;
-			myGenome->Evaluate(inputs, outputs);
-
-			float forwardForce = 0.f;
-			float rightForce = 0.f;
-			float rotationForce = 0.f;
-			if (outputs[0] > outputs[1])
-				forwardForce += 1.f;
-			else
-				forwardForce -= 1.f;
-			if (outputs[2] > outputs[3])
-				rightForce += 1.f;
-			else
-				rightForce -= 1.f;
-			if (outputs[4] > outputs[5])
-				rotationForce += 1.f;
-			else
-				rotationForce -= 1.f;
-			mySystem->myNPC.Update(Core::TimeModule::GetInstance()->GetDeltaTimeSec(), forwardForce, rightForce, rotationForce);
+			double observations[3];
+			double actions[6];
+			mySystem->Observe(observations);
+			myGenome->Evaluate(observations, actions);
+			mySystem->Act(actions);
+			mySystem->myNPC.Update(Core::TimeModule::GetInstance()->GetDeltaTimeSec(), mySystem->myNPCForwardForce, mySystem->myNPCRightForce, mySystem->myNPCRotationForce);
 		}
 		else
 		{
@@ -196,114 +178,70 @@ void NeatLocomotionModule::OnGuiUpdate()
 	float aimInfo;
 	mySystem->myNPC.GetBrainInputs(mySystem->myPlayer, distanceInfo, alignementInfo, aimInfo);
 	ImGui::Text("%f, %f, %f", distanceInfo, alignementInfo, aimInfo);
-}
 
-void EvaluatePopulationAsync(Thread::WorkerPool& aPool, CharactersSystems& someSystems, Neat::Population& aPopulation, size_t aStartIdx, size_t aEndIdx)
-{
-	aPool.RequestJob([&someSystems, &aPopulation, aStartIdx, aEndIdx]() {
-		for (size_t i = aStartIdx; i < aEndIdx; ++i)
-		{
-			if (Neat::Genome* genome = aPopulation.GetGenome(i))
-			{
-				double fitness = 0.0;
-
-				float deltaTime = 0.02f;
-				uint maxSteps = static_cast<uint>(10.f / deltaTime);
-				double fitnessStep = 1.0 / static_cast<double>(maxSteps * someSystems.size());
-
-				for (CharactersSystem system : someSystems)
-				{
-					system.Reset();
-
-					for (uint t = 0; t < maxSteps; ++t)
-					{
-						float distanceInfo;
-						float alignementInfo;
-						float aimInfo;
-						system.myNPC.GetBrainInputs(system.myPlayer, distanceInfo, alignementInfo, aimInfo);
-
-						std::vector<double> inputs;
-						inputs.push_back(distanceInfo);
-						inputs.push_back(alignementInfo);
-						inputs.push_back(aimInfo);
-						std::vector<double> outputs;
-						genome->Evaluate(inputs, outputs);
-
-						float forwardForce = 0.f;
-						float rightForce = 0.f;
-						float rotationForce = 0.f;
-						if (outputs[0] > outputs[1])
-							forwardForce += 1.f;
-						else
-							forwardForce -= 1.f;
-						if (outputs[2] > outputs[3])
-							rightForce += 1.f;
-						else
-							rightForce -= 1.f;
-						if (outputs[4] > outputs[5])
-							rotationForce += 1.f;
-						else
-							rotationForce -= 1.f;
-						system.myNPC.Update(deltaTime, forwardForce, rightForce, rotationForce);
-
-						fitness += fitnessStep * system.myNPC.ComputePositionFitness(system.myPlayer);
-					}
-				}
-
-				genome->SetFitness(fitness);
-			}
-		}
-	});
+	if (myTraining)
+		myDashboard.Draw(myTraining->GetTelemetry(), myTraining->IsRunning());
 }
 
-void TrainNeat()
+void TrainNeat(Neat::BackgroundTraining* aBackgroundTraining /*= nullptr*/)
 {
+	// The background training leaves a core to the rendering
 	Thread::WorkerPool threadPool(Thread::WorkerPriority::High);
-	threadPool.SetWorkersCount();
-
-	Neat::Population population = Neat::Population(300, 3, 6);
-	Neat::Population::TrainingCallbacks callbacks;
+	threadPool.SetWorkersCount(aBackgroundTraining ? std::max(std::thread::hardware_concurrency(), 2u) - 1 : UINT_MAX);
 
-	CharactersSystems systems;
-	uint systemsCount = 100;
-	systems.reserve(systemsCount);
-	for (uint i = 0; i < systemsCount; ++i)
+	// Resume the last run if it was interrupted, this also restores the seed
+	const char* checkpointPath = "neat/locomotion_checkpoint";
+	Neat::Population population = std::filesystem::exists(checkpointPath) ? Neat::Population(checkpointPath) : Neat::Population(300, 3, 6);
+	if (population.GetSize() == 0)
 	{
-		std::uniform_real_distribution<> randPos(-200.f, 200.f);
-		std::uniform_real_distribution<> randAngle(-std::numbers::pi, std::numbers::pi);
-	
-		glm::vec2 playerPos = glm::vec2((float)randPos(Neat::EvolutionParams::GetRandomGenerator()), (float)randPos(Neat::EvolutionParams::GetRandomGenerator()));
-		float playerDir = (float)randAngle(Neat::EvolutionParams::GetRandomGenerator());
-		glm::vec2 npcPos = glm::vec2((float)randPos(Neat::EvolutionParams::GetRandomGenerator()), (float)randPos(Neat::EvolutionParams::GetRandomGenerator()));
-		float npcDir = (float)randAngle(Neat::EvolutionParams::GetRandomGenerator());
-	
-		systems.push_back(CharactersSystem(playerPos, playerDir, npcPos, npcDir));
+		std::cout << "Could not resume from " << checkpointPath << std::endl;
+		return;
 	}
-	//systems.push_back(CharactersSystem(glm::vec2(-150.f, 0.f), (float)std::numbers::pi / 2.f, glm::vec2(150.f, 0.f), -(float)std::numbers::pi / 2.f));
+	Neat::Population::TrainingCallbacks callbacks;
+
+	CharactersSystems systems = CreateSystems(population.GetParams().myRandomSeed);
 
 	CharactersSystemPool systemsPool;
 	systemsPool.resize(threadPool.GetWorkersCount(), systems);
 
-	callbacks.myEvaluateGenomes = [&population, &threadPool, &systemsPool]() {
-		size_t runPerThread = population.GetSize() / threadPool.GetWorkersCount() + 1;
-		size_t startIdx = 0;
-		uint systemPoolIdx = 0;
-		while (startIdx < population.GetSize())
-		{
-			EvaluatePopulationAsync(threadPool, systemsPool[systemPoolIdx], population, startIdx, startIdx + runPerThread);
-			startIdx = std::min(population.GetSize(), startIdx + runPerThread);
-			systemPoolIdx++;
-		}
-		threadPool.WaitIdle();
+	callbacks.myParallelFor = [&threadPool](size_t aCount, const std::function<void(size_t)>& aJob) {
+		threadPool.ParallelFor(aCount, aJob);
 	};
 
-	int generationIdx = 0;
-	callbacks.myOnTrainGenerationEnd = [&population, &generationIdx]() {
+	// Every worker resets its own systems and reuses its own buffers, nothing is allocated while evaluating
+	std::vector<Neat::EpisodeRunner> runners(threadPool.GetWorkersCount());
+	Neat::Evaluator evaluator(threadPool.GetWorkersCount(), [&systemsPool, &runners](Neat::Genome& aGenome, size_t aWorkerIdx, double aFitnessCutoff, bool& anOutIsPruned) {
+		return EvaluateGenome(aGenome, systemsPool[aWorkerIdx], runners[aWorkerIdx], aFitnessCutoff, anOutIsPruned);
+	});
+#if USE_PRUNING
+	evaluator.EnablePruning(0.5);
+#endif
+#if USE_RACING
+	// All the genomes on 10 systems, the best third on 30, the best ninth on 90 and the best 27th on all of them
+	evaluator.EnableRacing([&systemsPool, &runners](Neat::Genome& aGenome, size_t aWorkerIdx, size_t aFirstSystemIdx, size_t aSystemsCount) {
+		return EvaluateScenarios(aGenome, systemsPool[aWorkerIdx], runners[aWorkerIdx], aFirstSystemIdx, aSystemsCount);
+	}, systems.size(), 10, 1.0 / 3.0);
+#endif
+#if !USE_RACING
+	// The systems are the same at every generation, the fitness only depends on the phenotype
+	population.EnableFitnessCache(true);
+#endif
+	callbacks.myEvaluateGenomes = [&population, &evaluator, &callbacks]() {
+		evaluator.EvaluateGenomes(population, callbacks.myParallelFor);
+	};
+
+	int generationIdx = population.GetGeneration() + 1;
+	callbacks.myOnTrainGenerationEnd = [&population, &evaluator, &generationIdx, checkpointPath]() {
 		if (generationIdx % 10 == 0)
 		{
 			population.Check();
+			population.SaveCheckpoint(checkpointPath);
 			std::cout << "Population Size : " << population.GetSize() << std::endl;
 			std::cout << "Species Count : " << population.GetSpecies().size() << std::endl;
+			std::cout << "Evaluation Utilization : " << 100.0 * evaluator.GetStats().GetUtilization() << "%" << std::endl;
+			std::cout << "Pruned Evaluations : " << evaluator.GetStats().myPrunedCount << std::endl;
+			std::cout << "Fitness Cache Hits : " << 100.0 * population.GetFitnessCacheStats().GetHitRate() << "%" << std::endl;
+			std::cout << "Saved Evaluations : " << 100.0 * evaluator.GetStats().GetSavedEvaluationsRatio() << "%" << std::endl;
 			if (const Neat::Genome* bestGenome = population.GetBestGenome())
 			{
 				std::cout << "Generation " << generationIdx << ": Best Fitness : " << bestGenome->GetFitness() << std::endl;
@@ -318,6 +256,158 @@ void TrainNeat()
 
 	uint64 startTime = Core::TimeModule::GetInstance()->GetCurrentTimeMs();
 
+	if (aBackgroundTraining)
+		aBackgroundTraining->TrainGenerations(population, callbacks, 1000 - generationIdx, DBL_MAX);
+	else
+		population.TrainGenerations(callbacks, 1000 - generationIdx, DBL_MAX);
+
+	uint64 duration = Core::TimeModule::GetInstance()->GetCurrentTimeMs() - startTime;
+	std::cout << "Training duration (ms) : " << duration << std::endl;
+
+	// A training interrupted by closing the window doesn't replace the saved genome, it resumes from its last checkpoint
+	if (aBackgroundTraining && aBackgroundTraining->IsStopRequested())
+		return;
+
+	if (const Neat::Genome* bestGenome = population.GetBestGenome())
+	{
+		bestGenome->SaveToFile("neat/locomotion");
+		std::cout << "Best Fitness : " << bestGenome->GetFitness() << std::endl;
+	}
+}
+
+// Workers, systems and evaluator of an island
+struct LocomotionIsland
+{
+	Thread::WorkerPool myThreadPool;
+	CharactersSystemPool mySystemsPool;
+	std::vector<Neat::EpisodeRunner> myRunners;
+	std::unique_ptr<Neat::Evaluator> myEvaluator;
+};
+
+void TrainNeatIslands()
+{
+	CharactersSystems systems = CreateSystems(Neat::EvolutionParams::GetRandomSeed());
+
+	// The islands run on their own worker each, and evaluate their genomes on their share of the cores
+	Thread::WorkerPool islandsThreadPool(Thread::WorkerPriority::High);
+	islandsThreadPool.SetWorkersCount(ISLANDS_COUNT);
+	uint islandWorkersCount = std::max(std::thread::hardware_concurrency() / ISLANDS_COUNT, 1u);
+
+	// Every island has as many genomes as the single population of TrainNeat, and sends its 2 best genomes to the next one every 10 generations.
+	// There is no checkpoint, the islands always start from scratch.
+	Neat::IslandModel islands(ISLANDS_COUNT, 300, 3, 6);
+	islands.SetMigration(Neat::IslandModel::Topology::Ring, 10, 2);
+
+	std::vector<std::unique_ptr<LocomotionIsland>> islandsStates;
+	std::vector<Neat::Population::TrainingCallbacks> islandsCallbacks(islands.GetIslandsCount());
+	for (size_t i = 0; i < islands.GetIslandsCount(); ++i)
+	{
+		LocomotionIsland& island = *islandsStates.emplace_back(std::make_unique<LocomotionIsland>());
+		island.myThreadPool.SetWorkersCount(islandWorkersCount);
+		island.mySystemsPool.resize(islandWorkersCount, systems);
+		island.myRunners.resize(islandWorkersCount);
+		island.myEvaluator = std::make_unique<Neat::Evaluator>(islandWorkersCount, [&island](Neat::Genome& aGenome, size_t aWorkerIdx, double aFitnessCutoff, bool& anOutIsPruned) {
+			return EvaluateGenome(aGenome, island.mySystemsPool[aWorkerIdx], island.myRunners[aWorkerIdx], aFitnessCutoff, anOutIsPruned);
+		});
+
+		Neat::Population& population = islands.GetIsland(i);
+#if USE_RACING
+		island.myEvaluator->EnableRacing([&island](Neat::Genome& aGenome, size_t aWorkerIdx, size_t aFirstSystemIdx, size_t aSystemsCount) {
+			return EvaluateScenarios(aGenome, island.mySystemsPool[aWorkerIdx], island.myRunners[aWorkerIdx], aFirstSystemIdx, aSystemsCount);
+		}, systems.size(), 10, 1.0 / 3.0);
+#else
+		population.EnableFitnessCache(true);
+#endif
+
+		Neat::Population::TrainingCallbacks& callbacks = islandsCallbacks[i];
+		callbacks.myParallelFor = [&island](size_t aCount, const std::function<void(size_t)>& aJob) {
+			island.myThreadPool.ParallelFor(aCount, aJob);
+		};
+		callbacks.myEvaluateGenomes = [&population, &island, &callbacks]() {
+			island.myEvaluator->EvaluateGenomes(population, callbacks.myParallelFor);
+		};
+	}
+
+	uint64 startTime = Core::TimeModule::GetInstance()->GetCurrentTimeMs();
+
+	islands.TrainGenerations(islandsCallbacks, [&islandsThreadPool](size_t aCount, const std::function<void(size_t)>& aJob) {
+		islandsThreadPool.ParallelFor(aCount, aJob);
+	}, 1000, DBL_MAX);
+
+	uint64 duration = Core::TimeModule::GetInstance()->GetCurrentTimeMs() - startTime;
+	const Neat::IslandModel::Stats& stats = islands.GetStats();
+	std::cout << "Training duration (ms) : " << duration << std::endl;
+	std::cout << "Generations : " << stats.myGenerationsCount << std::endl;
+	std::cout << "Migrations duration (ms) : " << 1000.0 * stats.myMigrationsDurationSec << std::endl;
+
+	if (const Neat::Genome* bestGenome = islands.GetBestGenome())
+	{
+		bestGenome->SaveToFile("neat/locomotion");
+		std::cout << "Best Fitness : " << bestGenome->GetFitness() << std::endl;
+	}
+}
+
+// Evaluates the genomes sent by TrainNeatDistributed until it disconnects
+void RunNeatWorker(std::uint16_t aPort, std::uint64_t aSeed)
+{
+	CharactersSystems systems = CreateSystems(aSeed);
+	Neat::EpisodeRunner runner;
+	Neat::DistributedWorker worker([&systems, &runner](Neat::Genome& aGenome) {
+		bool isPruned = false;
+		return EvaluateGenome(aGenome, systems, runner, -DBL_MAX, isPruned);
+	});
+	if (!worker.Connect(aPort))
+	{
+		std::cout << "Could not connect to port " << aPort << std::endl;
+		return;
+	}
+	worker.Run();
+}
+
+void TrainNeatDistributed()
+{
+	// The workers are processes of this executable, which build the systems from the same seed
+	std::uint64_t seed = Neat::EvolutionParams::GetRandomSeed();
+	Neat::DistributedEvaluator evaluator;
+	if (!evaluator.IsListening()
+		|| !evaluator.LaunchWorkers(DISTRIBUTED_WORKERS_COUNT, __argv[0], { "-neatworker", std::to_string(evaluator.GetPort()), "-neatseed", std::to_string(seed) })
+		|| !evaluator.WaitForWorkers(DISTRIBUTED_WORKERS_COUNT, 30.0))
+	{
+		std::cout << "Could not start the workers" << std::endl;
+		return;
+	}
+
+	// The workers evaluate the genomes on all the systems, there is no racing
+	Neat::Population population(300, 3, 6);
+	population.EnableFitnessCache(true);
+
+	Thread::WorkerPool threadPool(Thread::WorkerPriority::High);
+	threadPool.SetWorkersCount();
+
+	Neat::Population::TrainingCallbacks callbacks;
+	callbacks.myParallelFor = [&threadPool](size_t aCount, const std::function<void(size_t)>& aJob) {
+		threadPool.ParallelFor(aCount, aJob);
+	};
+	callbacks.myEvaluateGenomes = [&population, &evaluator]() {
+		if (!evaluator.EvaluateGenomes(population))
+			std::cout << "All the workers were lost" << std::endl;
+	};
+
+	int generationIdx = 0;
+	callbacks.myOnTrainGenerationEnd = [&population, &evaluator, &generationIdx]() {
+		if (generationIdx % 10 == 0)
+		{
+			const Neat::DistributedEvaluator::Stats& stats = evaluator.GetStats();
+			std::cout << "Workers : " << evaluator.GetWorkersCount() << ", Lost : " << stats.myLostWorkersCount << std::endl;
+			std::cout << "Evaluation duration (ms) : " << 1000.0 * stats.myDurationSec << " for " << stats.myGenomesCount << " genomes" << std::endl;
+			if (const Neat::Genome* bestGenome = population.GetBestGenome())
+				std::cout << "Generation " << generationIdx << ": Best Fitness : " << bestGenome->GetFitness() << std::endl;
+		}
+		generationIdx++;
+	};
+
+	uint64 startTime = Core::TimeModule::GetInstance()->GetCurrentTimeMs();
+
 	population.TrainGenerations(callbacks, 1000, DBL_MAX);
 
 	uint64 duration = Core::TimeModule::GetInstance()->GetCurrentTimeMs() - startTime;
@@ -336,11 +426,22 @@ int main()
 
 	Core::Facade::Create(__argc, __argv);
 
+	// Worker process of TrainNeatDistributed
+	const Core::CommandLine* commandLine = Core::Facade::GetCommandLine();
+	if (commandLine->IsSet("neatworker"))
+	{
+		RunNeatWorker(static_cast<std::uint16_t>(commandLine->GetValueAsInt("neatworker")), std::stoull(commandLine->GetValue("neatseed")));
+		Core::Facade::Destroy();
+		return EXIT_SUCCESS;
+	}
+
 	std::random_device rd;
 	unsigned int seed = rd();
 	Neat::EvolutionParams::SetRandomSeed(seed);
 
 	//TrainNeat();
+	//TrainNeatIslands();
+	//TrainNeatDistributed();
 
 	Render::RenderModule::Register();
 	NeatLocomotionModule::Register();
@@ -0,0 +1,213 @@
+#include "CartPole.h"
+#include "CartPoleBatch.h"
+
+#include "Environment.h"
+#include "EvolutionParams.h"
+#include "Genome.h"
+#include "Population.h"
+#include "Random.h"
+
+#include "Core_Thread.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Hyperparameter sweep: every configuration of the grid is trained with the same seeds, all the runs of all the
+// configurations share one worker pool. A run is a small population trained serially by a single worker, so the
+// workers never wait for each other and a many cores machine stays busy until the last runs.
+namespace
+{
+	const double ourNewNodeProbas[] = { 0.01, 0.03, 0.1 };
+	const double ourNewLinkProbas[] = { 0.05, 0.2 };
+	const double ourSpecieThresholds[] = { 2.0, 3.0, 4.0 };
+	const uint ourSeedsCount = 16;
+
+	struct SweepTask
+	{
+		const char* myName;
+		size_t myPopulationSize;
+		size_t myInputCount;
+		size_t myOutputCount;
+		int myMaxGenerationsCount;
+		double mySatisfactionThreshold;
+	};
+
+	const SweepTask ourXorTask = { "xor", 150, 2, 1, 200, 0.9 };
+	const SweepTask ourCartPoleTask = { "cartPole", 100, 4, 2, 100, 0.95 };
+
+	struct SweepConfig
+	{
+		std::string myName;
+		Neat::EvolutionParams myParams;
+	};
+
+	std::vector<SweepConfig> BuildConfigs()
+	{
+		std::vector<SweepConfig> configs;
+		for (double newNodeProba : ourNewNodeProbas)
+		{
+			for (double newLinkProba : ourNewLinkProbas)
+			{
+				for (double specieThreshold : ourSpecieThresholds)
+				{
+					SweepConfig& config = configs.emplace_back();
+					config.myName = FormatString("node %.2f, link %.2f, specie %.1f", newNodeProba, newLinkProba, specieThreshold);
+					config.myParams.myNewNodeProba = newNodeProba;
+					config.myParams.myNewLinkProba = newLinkProba;
+					config.myParams.mySpecieThreshold = specieThreshold;
+				}
+			}
+		}
+		return configs;
+	}
+
+	double EvaluateXor(Neat::Genome& aGenome)
+	{
+		const double xorInputs[4][2] = {
+			{0.0, 0.0},
+			{0.0, 1.0},
+			{1.0, 0.0},
+			{1.0, 1.0}
+		};
+		const double xorOutputs[4] = { 0.0, 1.0, 1.0, 0.0 };
+
+		double error = 0.0;
+		double outputs[1];
+		for (uint j = 0; j < 4; ++j)
+		{
+			aGenome.Evaluate(std::span<const double>(xorInputs[j], 2), std::span<double>(outputs, 1));
+			error += std::abs(xorOutputs[j] - outputs[0]);
+		}
+		return 1.0 - error / 4.0;
+	}
+
+	// Trains one population until aTask is solved, returns the generations count or -1 if it wasn't solved
+	template<typename Evaluate>
+	int TrainUntilSolved(const SweepTask& aTask, const Neat::EvolutionParams& someParams, Evaluate anEvaluate)
+	{
+		Neat::Population population(aTask.myPopulationSize, aTask.myInputCount, aTask.myOutputCount, someParams);
+		population.EnableFitnessCache(true);
+
+		Neat::Population::TrainingCallbacks callbacks;
+		callbacks.myEvaluateGenomes = [&population, &anEvaluate]() {
+			for (size_t i = 0; i < population.GetSize(); ++i)
+			{
+				if (!population.IsFitnessCached(i))
+					population.GetGenome(i)->SetFitness(anEvaluate(*population.GetGenome(i)));
+			}
+		};
+		population.TrainGenerations(callbacks, aTask.myMaxGenerationsCount, aTask.mySatisfactionThreshold);
+
+		const Neat::Genome* bestGenome = population.GetBestGenome();
+		if (!bestGenome || bestGenome->GetFitness() < aTask.mySatisfactionThreshold)
+			return -1;
+		return population.GetGeneration() + 1;
+	}
+
+	struct ConfigResult
+	{
+		size_t myConfigIdx = 0;
+		size_t mySolvedCount = 0;
+		double myMeanGenerationsCount = 0.0;
+		int myMedianGenerationsCount = 0;
+		int myMaxGenerationsCount = 0;
+	};
+
+	// Runs every configuration with every seed, aTrain(config, seed) returns the generations to solve or -1
+	template<typename Train>
+	void Sweep(Thread::WorkerPool& aThreadPool, const SweepTask& aTask, const std::vector<SweepConfig>& someConfigs, Train aTrain)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		std::vector<int> generationsCounts(someConfigs.size() * ourSeedsCount);
+		Clock::time_point start = Clock::now();
+		aThreadPool.ParallelFor(generationsCounts.size(), [&someConfigs, &generationsCounts, &aTrain](size_t aRunIdx) {
+			Neat::EvolutionParams params = someConfigs[aRunIdx / ourSeedsCount].myParams;
+			params.myRandomSeed = aRunIdx % ourSeedsCount;
+			generationsCounts[aRunIdx] = aTrain(params);
+		});
+		double durationSec = std::chrono::duration<double>(Clock::now() - start).count();
+
+		std::vector<ConfigResult> results(someConfigs.size());
+		for (size_t c = 0; c < someConfigs.size(); ++c)
+		{
+			ConfigResult& result = results[c];
+			result.myConfigIdx = c;
+
+			std::vector<int> solvedCounts;
+			for (uint s = 0; s < ourSeedsCount; ++s)
+			{
+				int generationsCount = generationsCounts[c * ourSeedsCount + s];
+				if (generationsCount >= 0)
+					solvedCounts.push_back(generationsCount);
+			}
+			result.mySolvedCount = solvedCounts.size();
+			if (solvedCounts.empty())
+				continue;
+
+			std::sort(solvedCounts.begin(), solvedCounts.end());
+			for (int generationsCount : solvedCounts)
+				result.myMeanGenerationsCount += generationsCount;
+			result.myMeanGenerationsCount /= solvedCounts.size();
+			result.myMedianGenerationsCount = solvedCounts[solvedCounts.size() / 2];
+			result.myMaxGenerationsCount = solvedCounts.back();
+		}
+
+		// Most reliable first, then fastest
+		std::sort(results.begin(), results.end(), [](const ConfigResult& aResult1, const ConfigResult& aResult2) {
+			if (aResult1.mySolvedCount != aResult2.mySolvedCount)
+				return aResult1.mySolvedCount > aResult2.mySolvedCount;
+			return aResult1.myMeanGenerationsCount < aResult2.myMeanGenerationsCount;
+		});
+
+		std::cout << FormatString("%s (%zu configurations x %u seeds, %zu genomes, up to %d generations) : %.1f s, %.1f runs/s",
+			aTask.myName, someConfigs.size(), ourSeedsCount, aTask.myPopulationSize, aTask.myMaxGenerationsCount,
+			durationSec, generationsCounts.size() / durationSec) << std::endl;
+		for (const ConfigResult& result : results)
+		{
+			std::cout << FormatString("  %-36s : solved %2zu/%u, generations mean %6.1f, median %4d, max %4d",
+				someConfigs[result.myConfigIdx].myName.c_str(), result.mySolvedCount, ourSeedsCount,
+				result.myMeanGenerationsCount, result.myMedianGenerationsCount, result.myMaxGenerationsCount) << std::endl;
+		}
+	}
+}
+
+int main()
+{
+	Thread::WorkerPool threadPool(Thread::WorkerPriority::High);
+	threadPool.SetWorkersCount();
+
+	// Shared by all the runs, like the precision of the evaluations
+	Neat::EvolutionParams::ourPhenotypePrecision = Neat::Phenotype::Precision::Float;
+	Neat::EvolutionParams::ourPhenotypeActivation = Neat::Phenotype::Activation::Rational;
+
+	std::vector<SweepConfig> configs = BuildConfigs();
+
+	Sweep(threadPool, ourXorTask, configs, [](const Neat::EvolutionParams& someParams) {
+		return TrainUntilSolved(ourXorTask, someParams, EvaluateXor);
+	});
+
+	// Balancing from a nearly upright pole, the episode ends when it falls
+	Neat::Random random(0, 1);
+	CartPoles systems;
+	for (uint i = 0; i < 5; ++i)
+	{
+		CartPole& system = systems.emplace_back(0.0, 0.02, false, random);
+		system.myMaxSteps = 500;
+		system.myTerminateOnFailure = true;
+	}
+
+	Sweep(threadPool, ourCartPoleTask, configs, [&systems](const Neat::EvolutionParams& someParams) {
+		// Every run steps its own batch
+		CartPoleBatch batch(systems);
+		Neat::EpisodeRunner runner;
+		double maxReward = static_cast<double>(batch.GetMaxSteps()) * batch.GetBatchSize();
+		return TrainUntilSolved(ourCartPoleTask, someParams, [&batch, &runner, maxReward](Neat::Genome& aGenome) {
+			return runner.Run(aGenome, batch) / maxReward;
+		});
+	});
+
+	return EXIT_SUCCESS;
+}
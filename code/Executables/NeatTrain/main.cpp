@@ -0,0 +1,552 @@
+#include "NeatAcrobot/AcrobotBatch.h"
+#include "NeatCartPole/CartPoleBatch.h"
+#include "NeatDoubleCartPole/CartPoleBatch.h"
+#include "NeatLocomotion/CharactersSystem.h"
+
+#include "DistributedEvaluator.h"
+#include "Environment.h"
+#include "Evaluator.h"
+#include "EvolutionParams.h"
+#include "Genome.h"
+#include "Population.h"
+#include "Random.h"
+#include "Telemetry.h"
+
+#include "Core_CommandLine.h"
+#include "Core_Thread.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+
+// Headless training of the tasks of the NEAT executables, without their window, e.g. on a build server:
+//   NeatTrain -task cartPole [-population 200] [-threads 8] [-generations 500] [-seed 42] [-checkpoint 10] [-resume] [-check 0.1]
+// The best genome is saved to neat/<task> like the executables do, and the checkpoint to neat/<task>_checkpoint.
+// With -workers, the genomes are evaluated by worker processes of this executable, see Neat::DistributedEvaluator, and
+// -checkworkers checks them against the evaluation in this process.
+namespace
+{
+	struct TrainingTask
+	{
+		const char* myName;
+		size_t myInputCount;
+		size_t myOutputCount;
+		// Defaults of the training of the task executable
+		size_t myPopulationSize;
+		int myGenerationsCount;
+		double mySatisfactionThreshold;
+		Neat::Phenotype::Precision myPrecision;
+		Neat::Phenotype::Activation myActivation;
+		// Builds the systems of aWorkersCount workers from aSeed, the evaluation must not depend on anything else
+		std::function<Neat::Evaluator::EvaluateGenome(size_t aWorkersCount, std::uint64_t aSeed)> myCreateEvaluation;
+	};
+
+	double EvaluateXor(Neat::Genome& aGenome, double aFitnessCutoff, bool& anOutIsPruned)
+	{
+		const double xorInputs[4][2] = {
+			{0.0, 0.0},
+			{0.0, 1.0},
+			{1.0, 0.0},
+			{1.0, 1.0}
+		};
+		const double xorOutputs[4] = { 0.0, 1.0, 1.0, 0.0 };
+
+		double error = 0.0;
+		double outputs[1];
+		for (uint j = 0; j < 4; ++j)
+		{
+			aGenome.Evaluate(std::span<const double>(xorInputs[j], 2), std::span<double>(outputs, 1));
+			error += std::abs(xorOutputs[j] - outputs[0]);
+
+			// The next cases can't decrease the error
+			if (1.0 - error / 4.0 < aFitnessCutoff)
+			{
+				anOutIsPruned = true;
+				break;
+			}
+		}
+		return 1.0 - error / 4.0;
+	}
+
+	// Every worker resets its own batch and reuses its own buffers, nothing is allocated while evaluating
+	template<typename Batch>
+	struct BatchWorkers
+	{
+		std::vector<Batch> myBatches;
+		std::vector<Neat::EpisodeRunner> myRunners;
+	};
+
+	// Average ratio of rewarded steps, all the systems of a batch are stepped in lockstep
+	template<typename Batch>
+	Neat::Evaluator::EvaluateGenome CreateBatchEvaluation(size_t aWorkersCount, const Batch& aBatch)
+	{
+		std::shared_ptr<BatchWorkers<Batch>> workers = std::make_shared<BatchWorkers<Batch>>();
+		workers->myBatches.resize(aWorkersCount, aBatch);
+		workers->myRunners.resize(aWorkersCount);
+		return [workers](Neat::Genome& aGenome, size_t aWorkerIdx, double aFitnessCutoff, bool& anOutIsPruned) {
+			Batch& batch = workers->myBatches[aWorkerIdx];
+			Neat::EpisodeRunner& runner = workers->myRunners[aWorkerIdx];
+			double maxReward = static_cast<double>(batch.GetMaxSteps()) * batch.GetBatchSize();
+			double reward = runner.Run(aGenome, batch, aFitnessCutoff * maxReward);
+			anOutIsPruned = runner.IsPruned();
+			return reward / maxReward;
+		};
+	}
+
+	struct LocomotionWorkers
+	{
+		CharactersSystemPool mySystemsPool;
+		std::vector<Neat::EpisodeRunner> myRunners;
+	};
+
+	// Same systems and episodes as the training functions of the task executables
+	const TrainingTask ourTasks[] = {
+		{ "xor", 2, 1, 100, 1000, 0.9, Neat::Phenotype::Precision::Double, Neat::Phenotype::Activation::Exact,
+			[](size_t /*aWorkersCount*/, std::uint64_t /*aSeed*/) -> Neat::Evaluator::EvaluateGenome {
+				return [](Neat::Genome& aGenome, size_t /*aWorkerIdx*/, double aFitnessCutoff, bool& anOutIsPruned) {
+					return EvaluateXor(aGenome, aFitnessCutoff, anOutIsPruned);
+				};
+			}
+		},
+		{ "cartPole", 4, 2, 200, 500, 1.0, Neat::Phenotype::Precision::Float, Neat::Phenotype::Activation::Rational,
+			[](size_t aWorkersCount, std::uint64_t aSeed) {
+				Neat::Random random(aSeed, 1);
+				CartPoles systems;
+				for (uint i = 0; i < 10; ++i)
+					systems.push_back(CartPole(0.0, 1.0, false, random));
+				return CreateBatchEvaluation(aWorkersCount, CartPoleBatch(systems));
+			}
+		},
+		{ "acrobot", 4, 3, 500, 1000, DBL_MAX, Neat::Phenotype::Precision::Float, Neat::Phenotype::Activation::Rational,
+			[](size_t aWorkersCount, std::uint64_t aSeed) {
+				Neat::Random random(aSeed, 1);
+				Acrobots systems;
+				systems.push_back(Acrobot(false, 0.0, random));
+				return CreateBatchEvaluation(aWorkersCount, AcrobotBatch(systems));
+			}
+		},
+		// Swing up of a pole attached to the other pole, from the initial state of DoubleCartPole2
+		{ "doubleCartPole", 6, 2, 300, 1000, 1.0, Neat::Phenotype::Precision::Float, Neat::Phenotype::Activation::Rational,
+			[](size_t aWorkersCount, std::uint64_t /*aSeed*/) {
+				return CreateBatchEvaluation(aWorkersCount, DoubleCartPole2Batch(DoubleCartPole2(), 1));
+			}
+		},
+		{ "locomotion", 3, 6, 300, 1000, DBL_MAX, Neat::Phenotype::Precision::Double, Neat::Phenotype::Activation::Exact,
+			[](size_t aWorkersCount, std::uint64_t aSeed) -> Neat::Evaluator::EvaluateGenome {
+				std::shared_ptr<LocomotionWorkers> workers = std::make_shared<LocomotionWorkers>();
+				workers->mySystemsPool.resize(aWorkersCount, CreateSystems(aSeed));
+				workers->myRunners.resize(aWorkersCount);
+				return [workers](Neat::Genome& aGenome, size_t aWorkerIdx, double aFitnessCutoff, bool& anOutIsPruned) {
+					return EvaluateGenome(aGenome, workers->mySystemsPool[aWorkerIdx], workers->myRunners[aWorkerIdx], aFitnessCutoff, anOutIsPruned);
+				};
+			}
+		},
+	};
+
+	const TrainingTask* FindTask(const std::string& aName)
+	{
+		for (const TrainingTask& task : ourTasks)
+		{
+			if (aName == task.myName)
+				return &task;
+		}
+		return nullptr;
+	}
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: NeatTrain -task <name> [-population <size>] [-threads <count>] [-generations <count>] [-seed <seed>] [-checkpoint <interval>] [-resume] [-telemetry <path>] [-check <fraction>] [-workers <count>] [-batchtimeout <seconds>] [-checkworkers]" << std::endl;
+		std::cout << "  -population, -generations : defaults of the task" << std::endl;
+		std::cout << "  -threads : all the cores by default" << std::endl;
+		std::cout << "  -seed : random by default, restored from the checkpoint with -resume" << std::endl;
+		std::cout << "  -checkpoint : generations between two checkpoints, none by default" << std::endl;
+		std::cout << "  -telemetry : file of the per generation measures, JSON for a .json extension, CSV otherwise" << std::endl;
+		std::cout << "  -check : fraction of the genomes checked every generation, none by default" << std::endl;
+		std::cout << "  -workers : worker processes evaluating the genomes, each on a single thread, none by default" << std::endl;
+		std::cout << "  -batchtimeout : seconds after which a worker which didn't return its batch is lost, 60 by default" << std::endl;
+		std::cout << "  -checkworkers : instead of training, checks the workers against the evaluation in this process, 4 workers by default" << std::endl;
+		std::cout << "Tasks :";
+		for (const TrainingTask& task : ourTasks)
+			std::cout << " " << task.myName;
+		std::cout << std::endl;
+	}
+
+	// anInOutValue keeps its default when the option is not given, false when it is given without a valid value
+	template<typename T>
+	bool ReadOption(const Core::CommandLine& aCommandLine, const char* aName, T aMinValue, T aMaxValue, T& anInOutValue)
+	{
+		if (!aCommandLine.IsSet(aName))
+			return true;
+
+		std::string value = aCommandLine.GetValue(aName);
+		T parsedValue{};
+		auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), parsedValue);
+		if (value.empty() || error != std::errc() || end != value.data() + value.size() || parsedValue < aMinValue || parsedValue > aMaxValue)
+		{
+			std::cout << "Invalid value for -" << aName << " : '" << value << "'" << std::endl;
+			return false;
+		}
+
+		anInOutValue = parsedValue;
+		return true;
+	}
+
+	const double ourWorkersStartTimeoutSec = 30.0;
+
+	// The fitnesses of -checkworkers must be identical, the faulty workers crash or hang in the middle of their first batch
+	const int ourCheckGenerationsCount = 5;
+	const size_t ourCheckFaultyGenomesCount = 3; // Evaluated by a faulty worker before it fails
+	const double ourCheckBatchTimeoutSec = 2.0;
+
+	// The workers are processes of this executable, posix_spawn doesn't search the PATH for argv[0]
+	std::string GetExecutablePath(const char* anArgv0)
+	{
+#if defined(__linux__)
+		std::error_code error;
+		std::filesystem::path path = std::filesystem::read_symlink("/proc/self/exe", error);
+		if (!error)
+			return path.string();
+#endif
+		return anArgv0;
+	}
+
+	// Worker process of -workers, evaluates the genomes it receives on a single thread with the systems built from -neatseed.
+	// -neatcrashafter and -neathangafter make it crash or hang after evaluating that many genomes, for -checkworkers.
+	int RunWorker(const TrainingTask& aTask, const Core::CommandLine& aCommandLine)
+	{
+		std::uint16_t port = 0;
+		std::uint64_t seed = 0;
+		size_t crashAfterCount = SIZE_MAX;
+		size_t hangAfterCount = SIZE_MAX;
+		if (!ReadOption<std::uint16_t>(aCommandLine, "neatworker", 1, UINT16_MAX, port)
+			|| !ReadOption<std::uint64_t>(aCommandLine, "neatseed", 0, UINT64_MAX, seed)
+			|| !ReadOption<size_t>(aCommandLine, "neatcrashafter", 0, SIZE_MAX, crashAfterCount)
+			|| !ReadOption<size_t>(aCommandLine, "neathangafter", 0, SIZE_MAX, hangAfterCount))
+		{
+			return EXIT_FAILURE;
+		}
+
+		Neat::Evaluator::EvaluateGenome evaluateGenome = aTask.myCreateEvaluation(1, seed);
+		size_t evaluatedCount = 0;
+		Neat::DistributedWorker worker([&evaluateGenome, &evaluatedCount, crashAfterCount, hangAfterCount](Neat::Genome& aGenome) {
+			if (evaluatedCount == crashAfterCount)
+				std::_Exit(EXIT_FAILURE);
+			// The coordinator kills the process when it stops
+			while (evaluatedCount == hangAfterCount)
+				std::this_thread::sleep_for(std::chrono::seconds(1));
+
+			evaluatedCount++;
+			bool isPruned = false;
+			return evaluateGenome(aGenome, 0, -DBL_MAX, isPruned);
+		});
+		if (!worker.Connect(port))
+		{
+			std::cout << "Could not connect to port " << port << std::endl;
+			return EXIT_FAILURE;
+		}
+		return worker.Run() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	// Launches aCount workers of aTask and waits for them, someExtraArguments[i] are added to the arguments of the worker i
+	std::unique_ptr<Neat::DistributedEvaluator> StartWorkers(const TrainingTask& aTask, const std::string& anExecutablePath, size_t aCount, std::uint64_t aSeed,
+		const std::vector<std::vector<std::string>>& someExtraArguments = {})
+	{
+		std::unique_ptr<Neat::DistributedEvaluator> evaluator = std::make_unique<Neat::DistributedEvaluator>();
+		bool isLaunched = evaluator->IsListening();
+		for (size_t i = 0; i < aCount && isLaunched; ++i)
+		{
+			std::vector<std::string> arguments = { "-task", aTask.myName, "-neatworker", std::to_string(evaluator->GetPort()), "-neatseed", std::to_string(aSeed) };
+			if (i < someExtraArguments.size())
+				arguments.insert(arguments.end(), someExtraArguments[i].begin(), someExtraArguments[i].end());
+			isLaunched = evaluator->LaunchWorkers(1, anExecutablePath.c_str(), arguments);
+		}
+
+		if (!isLaunched || !evaluator->WaitForWorkers(aCount, ourWorkersStartTimeoutSec))
+		{
+			std::cout << "Could not start the workers" << std::endl;
+			return nullptr;
+		}
+		return evaluator;
+	}
+
+	std::uint64_t HashFitness(std::uint64_t aHash, double aFitness)
+	{
+		// FNV-1a over the bits of the fitness
+		std::uint64_t bits = 0;
+		std::memcpy(&bits, &aFitness, sizeof(bits));
+		return (aHash ^ bits) * 0x100000001B3ull;
+	}
+
+	// Trains a few generations evaluated both in this process and by aWorkersCount workers, two of which are faulty: one
+	// crashes and the other hangs in the middle of their first batch. The workers must return the same fitnesses, the
+	// batches of the faulty ones being evaluated again by the others.
+	bool CheckWorkers(const TrainingTask& aTask, const std::string& anExecutablePath, size_t aWorkersCount, double aBatchTimeoutSec,
+		size_t aPopulationSize, std::uint64_t aSeed, Thread::WorkerPool& aThreadPool)
+	{
+		std::cout << FormatString("Checking %zu workers on %s : %zu genomes, seed %llu, %d generations",
+			aWorkersCount, aTask.myName, aPopulationSize, static_cast<unsigned long long>(aSeed), ourCheckGenerationsCount) << std::endl;
+
+		std::string faultyGenomesCount = std::to_string(ourCheckFaultyGenomesCount);
+		std::unique_ptr<Neat::DistributedEvaluator> distributedEvaluator = StartWorkers(aTask, anExecutablePath, aWorkersCount, aSeed,
+			{ { "-neatcrashafter", faultyGenomesCount }, { "-neathangafter", faultyGenomesCount } });
+		if (!distributedEvaluator)
+			return false;
+		distributedEvaluator->SetBatchTimeout(aBatchTimeoutSec);
+
+		Neat::EvolutionParams params;
+		params.myRandomSeed = aSeed;
+		Neat::Population population(aPopulationSize, aTask.myInputCount, aTask.myOutputCount, params);
+		population.EnableFitnessCache(true);
+		Neat::Evaluator evaluator(aThreadPool.GetWorkersCount(), aTask.myCreateEvaluation(aThreadPool.GetWorkersCount(), aSeed));
+
+		bool isValid = true;
+		size_t lostWorkersCount = 0;
+		size_t timedOutWorkersCount = 0;
+		std::vector<double> fitnesses;
+		Neat::Population::TrainingCallbacks callbacks;
+		callbacks.myParallelFor = [&aThreadPool](size_t aCount, const std::function<void(size_t)>& aJob) {
+			aThreadPool.ParallelFor(aCount, aJob);
+		};
+		callbacks.myEvaluateGenomes = [&]() {
+			evaluator.EvaluateGenomes(population, callbacks.myParallelFor);
+
+			// The genomes the workers would skip keep a fitness which can't match
+			fitnesses.clear();
+			for (size_t i = 0; i < population.GetSize(); ++i)
+			{
+				fitnesses.push_back(population.GetGenome(i)->GetFitness());
+				if (!population.IsFitnessCached(i))
+					population.GetGenome(i)->SetFitness(std::numeric_limits<double>::quiet_NaN());
+			}
+
+			bool isEvaluated = distributedEvaluator->EvaluateGenomes(population);
+			const Neat::DistributedEvaluator::Stats& stats = distributedEvaluator->GetStats();
+			lostWorkersCount += stats.myLostWorkersCount;
+			timedOutWorkersCount += stats.myTimedOutWorkersCount;
+
+			std::uint64_t checksum = 0xCBF29CE484222325ull;
+			std::uint64_t workersChecksum = checksum;
+			for (size_t i = 0; i < population.GetSize(); ++i)
+			{
+				checksum = HashFitness(checksum, fitnesses[i]);
+				workersChecksum = HashFitness(workersChecksum, population.GetGenome(i)->GetFitness());
+			}
+
+			std::cout << FormatString("Generation %d : %zu genomes sent in %zu batches, %zu resent, %zu lost workers, checksum %016llx in this process, %016llx in the workers",
+				population.GetGeneration(), stats.myGenomesCount, stats.myBatchesCount, stats.myResentBatchesCount, stats.myLostWorkersCount,
+				static_cast<unsigned long long>(checksum), static_cast<unsigned long long>(workersChecksum)) << std::endl;
+			if (!isEvaluated || checksum != workersChecksum)
+			{
+				std::cout << "The workers didn't return the fitnesses of this process" << std::endl;
+				isValid = false;
+			}
+		};
+		population.TrainGenerations(callbacks, ourCheckGenerationsCount, DBL_MAX);
+
+		if (lostWorkersCount != 2 || timedOutWorkersCount != 1)
+		{
+			std::cout << FormatString("Expected 2 lost workers, 1 of them timed out, got %zu lost and %zu timed out", lostWorkersCount, timedOutWorkersCount) << std::endl;
+			isValid = false;
+		}
+		std::cout << (isValid ? "Workers check passed" : "Workers check failed") << std::endl;
+		return isValid;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	InitMemoryLeaksDetection();
+
+	Core::CommandLine commandLine;
+	commandLine.Parse(argc, argv);
+
+	const TrainingTask* task = FindTask(commandLine.GetValue("task"));
+	if (!task)
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	if (commandLine.IsSet("neatworker"))
+		return RunWorker(*task, commandLine);
+
+	// All the options are validated before the training starts
+	uint threadsCount = UINT_MAX;
+	size_t populationSize = task->myPopulationSize;
+	int generationsCount = task->myGenerationsCount;
+	std::uint64_t randomSeed = std::random_device()();
+	int checkpointInterval = 0;
+	double checkedFraction = 0.0;
+	size_t workersCount = commandLine.IsSet("checkworkers") ? 4 : 0;
+	double batchTimeoutSec = commandLine.IsSet("checkworkers") ? ourCheckBatchTimeoutSec : -1.0; // Default of the DistributedEvaluator
+	bool areOptionsValid = ReadOption<uint>(commandLine, "threads", 1, UINT_MAX, threadsCount)
+		&& ReadOption<size_t>(commandLine, "population", 1, SIZE_MAX, populationSize)
+		&& ReadOption(commandLine, "generations", 1, INT_MAX, generationsCount)
+		&& ReadOption<std::uint64_t>(commandLine, "seed", 0, UINT64_MAX, randomSeed)
+		&& ReadOption(commandLine, "checkpoint", 0, INT_MAX, checkpointInterval)
+		&& ReadOption(commandLine, "check", 0.0, 1.0, checkedFraction)
+		&& ReadOption<size_t>(commandLine, "workers", 1, 1024, workersCount)
+		&& ReadOption(commandLine, "batchtimeout", 0.0, 1e9, batchTimeoutSec);
+	if (areOptionsValid && commandLine.IsSet("telemetry") && commandLine.GetValue("telemetry").empty())
+	{
+		std::cout << "Missing path for -telemetry" << std::endl;
+		areOptionsValid = false;
+	}
+	// A crashing and a hanging worker, and at least one to evaluate their batches
+	if (areOptionsValid && commandLine.IsSet("checkworkers") && workersCount < 3)
+	{
+		std::cout << "-checkworkers needs at least 3 workers" << std::endl;
+		areOptionsValid = false;
+	}
+	if (!areOptionsValid)
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	Thread::WorkerPool threadPool(Thread::WorkerPriority::High);
+	threadPool.SetWorkersCount(threadsCount);
+
+	Neat::EvolutionParams::ourPhenotypePrecision = task->myPrecision;
+	Neat::EvolutionParams::ourPhenotypeActivation = task->myActivation;
+
+	std::string executablePath = GetExecutablePath(argv[0]);
+	if (commandLine.IsSet("checkworkers"))
+		return CheckWorkers(*task, executablePath, workersCount, batchTimeoutSec, populationSize, randomSeed, threadPool) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	std::string fileName = std::string("neat/") + task->myName;
+	std::string checkpointPath = fileName + "_checkpoint";
+	std::filesystem::create_directories("neat");
+
+	// Resuming restores the params and the seed of the interrupted run
+	std::unique_ptr<Neat::Population> population;
+	if (commandLine.IsSet("resume") && std::filesystem::exists(checkpointPath))
+	{
+		population = std::make_unique<Neat::Population>(checkpointPath.c_str());
+		if (population->GetSize() == 0)
+		{
+			std::cout << "Could not resume from " << checkpointPath << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	else
+	{
+		Neat::EvolutionParams params;
+		params.myRandomSeed = randomSeed;
+		population = std::make_unique<Neat::Population>(populationSize, task->myInputCount, task->myOutputCount, params);
+	}
+
+	// The systems are the same at every generation, the fitness only depends on the phenotype
+	std::uint64_t seed = population->GetParams().myRandomSeed;
+	Neat::Evaluator evaluator(threadPool.GetWorkersCount(), task->myCreateEvaluation(threadPool.GetWorkersCount(), seed));
+	population->EnableFitnessCache(true);
+
+	// The workers build the same systems from the seed
+	std::unique_ptr<Neat::DistributedEvaluator> distributedEvaluator;
+	if (workersCount > 0)
+	{
+		distributedEvaluator = StartWorkers(*task, executablePath, workersCount, seed);
+		if (!distributedEvaluator)
+			return EXIT_FAILURE;
+		if (batchTimeoutSec >= 0.0)
+			distributedEvaluator->SetBatchTimeout(batchTimeoutSec);
+	}
+
+	Neat::Population::TrainingCallbacks callbacks;
+	callbacks.myParallelFor = [&threadPool](size_t aCount, const std::function<void(size_t)>& aJob) {
+		threadPool.ParallelFor(aCount, aJob);
+	};
+	callbacks.myEvaluateGenomes = [&population, &evaluator, &distributedEvaluator, &callbacks]() {
+		if (distributedEvaluator)
+		{
+			if (distributedEvaluator->EvaluateGenomes(*population))
+				return;
+
+			// The genomes not evaluated by the workers are evaluated again with all the others
+			std::cout << "All the workers were lost, the genomes are evaluated in this process from now on" << std::endl;
+			distributedEvaluator.reset();
+		}
+		evaluator.EvaluateGenomes(*population, callbacks.myParallelFor);
+	};
+
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point generationStart;
+	callbacks.myOnTrainGenerationStart = [&generationStart]() {
+		generationStart = Clock::now();
+	};
+
+	callbacks.myOnTrainGenerationEnd = [&population, &evaluator, &distributedEvaluator, &generationStart, &checkpointPath, checkpointInterval, checkedFraction]() {
+		if (checkedFraction > 0.0 && !population->Check(checkedFraction))
+			std::cout << "Malformed genome at generation " << population->GetGeneration() << std::endl;
+
+		double generationSec = std::chrono::duration<double>(Clock::now() - generationStart).count();
+		double evaluationSec = distributedEvaluator ? distributedEvaluator->GetStats().myDurationSec : evaluator.GetStats().myDurationSec;
+		size_t evaluationsCount = population->GetSize() - population->GetFitnessCacheStats().myHitsCount;
+		const Neat::Genome* bestGenome = population->GetBestGenome();
+
+		// Evaluations per second of the evaluation phase, and of the whole generation with the reproduction
+		std::cout << FormatString("Generation %d : best fitness %.4f, %zu species, %zu evaluations, %.0f evaluations/s (%.0f with the reproduction)",
+			population->GetGeneration(), bestGenome ? bestGenome->GetFitness() : 0.0, population->GetSpecies().size(), evaluationsCount,
+			evaluationSec > 0.0 ? evaluationsCount / evaluationSec : 0.0, generationSec > 0.0 ? evaluationsCount / generationSec : 0.0) << std::endl;
+
+		if (distributedEvaluator && distributedEvaluator->GetStats().myLostWorkersCount > 0)
+		{
+			const Neat::DistributedEvaluator::Stats& stats = distributedEvaluator->GetStats();
+			std::cout << FormatString("  %zu workers lost, %zu of them timed out, %zu batches resent, %zu workers left",
+				stats.myLostWorkersCount, stats.myTimedOutWorkersCount, stats.myResentBatchesCount, distributedEvaluator->GetWorkersCount()) << std::endl;
+		}
+
+		if (checkpointInterval > 0 && (population->GetGeneration() + 1) % checkpointInterval == 0)
+		{
+			if (!population->SaveCheckpoint(checkpointPath.c_str()))
+				std::cout << "Could not save " << checkpointPath << std::endl;
+		}
+	};
+
+	std::cout << FormatString("Training %s : %zu genomes, %u threads, %zu worker processes, seed %llu, from generation %d to %d",
+		task->myName, population->GetSize(), threadPool.GetWorkersCount(), workersCount, static_cast<unsigned long long>(seed), population->GetGeneration() + 1, generationsCount) << std::endl;
+
+	// Sized to keep all the trained generations in the exported telemetry
+	int trainedGenerationsCount = generationsCount - (population->GetGeneration() + 1);
+	Neat::Telemetry telemetry(static_cast<size_t>(std::max(trainedGenerationsCount, 1)));
+	population->SetTelemetry(&telemetry);
+
+	Clock::time_point start = Clock::now();
+	population->TrainGenerations(callbacks, trainedGenerationsCount, task->mySatisfactionThreshold);
+	double durationSec = std::chrono::duration<double>(Clock::now() - start).count();
+	std::cout << FormatString("Training duration (s) : %.2f", durationSec) << std::endl;
+
+	std::cout << "Phases duration (s) :";
+	for (size_t phase = 0; phase < static_cast<size_t>(Neat::Telemetry::Phase::Count); ++phase)
+	{
+		Neat::Telemetry::Phase telemetryPhase = static_cast<Neat::Telemetry::Phase>(phase);
+		std::cout << FormatString(" %s %.2f", Neat::Telemetry::GetPhaseName(telemetryPhase), telemetry.GetPhaseTotalDurationSec(telemetryPhase));
+	}
+	std::cout << std::endl;
+
+	if (commandLine.IsSet("telemetry"))
+	{
+		std::string telemetryPath = commandLine.GetValue("telemetry");
+		bool isSaved = std::filesystem::path(telemetryPath).extension() == ".json" ? telemetry.SaveJson(telemetryPath.c_str()) : telemetry.SaveCsv(telemetryPath.c_str());
+		if (!isSaved)
+			std::cout << "Could not save " << telemetryPath << std::endl;
+	}
+	population->SetTelemetry(nullptr);
+
+	if (const Neat::Genome* bestGenome = population->GetBestGenome())
+	{
+		bestGenome->SaveToFile(fileName.c_str());
+		std::cout << "Best Fitness : " << bestGenome->GetFitness() << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -1,4 +1,5 @@
 #include "Genome.h"
+#include "Evaluator.h"
 #include "EvolutionParams.h"
 #include "Specie.h"
 #include "Population.h"
@@ -9,43 +10,44 @@
 #include <iostream>
 #include <random>
 
-void EvaluatePopulationAsync(Thread::WorkerPool& aPool, Neat::Population& aPopulation, size_t aStartIdx, size_t aEndIdx)
+#define USE_PRUNING 0 // 1 to stop the evaluations that can't reach the median fitness of the generation anymore, faster but not deterministic
+
+double EvaluateGenome(Neat::Genome& aGenome, double aFitnessCutoff, bool& anOutIsPruned)
 {
-	aPool.RequestJob([&aPopulation, aStartIdx, aEndIdx]() {
-		for (size_t i = aStartIdx; i < aEndIdx; ++i)
+	double error = 0.0;
+
+	double xorInputs[4][2] = {
+		{0.0, 0.0},
+		{0.0, 1.0},
+		{1.0, 0.0},
+		{1.0, 1.0}
+	};
+	double xorOutputs[4] = {
+		0.0,
+		1.0,
+		1.0,
+		0.0
+	};
+
+	for (uint j = 0; j < 4; ++j)
+	{
+		std::vector<double> inputs;
+		inputs.push_back(xorInputs[j][0]);
+		inputs.push_back(xorInputs[j][1]);
+		std::vector<double> outputs;
+		aGenome.Evaluate(inputs, outputs);
+
+		error += std::abs(xorOutputs[j] - outputs[0]);
+
+		// The next cases can't decrease the error
+		if (1.0 - error / 4.0 < aFitnessCutoff)
 		{
-			if (Neat::Genome* genome = aPopulation.GetGenome(i))
-			{
-				double error = 0.0;
-
-				double xorInputs[4][2] = {
-					{0.0, 0.0},
-					{0.0, 1.0},
-					{1.0, 0.0},
-					{1.0, 1.0}
-				};
-				double xorOutputs[4] = {
-					0.0,
-					1.0,
-					1.0,
-					0.0
-				};
-
-				for (uint j = 0; j < 4; ++j)
-				{
-					std::vector<double> inputs;
-					inputs.push_back(xorInputs[j][0]);
-					inputs.push_back(xorInputs[j][1]);
-					std::vector<double> outputs;
-					genome->Evaluate(inputs, outputs);
-
-					error += std::abs(xorOutputs[j] - outputs[0]);
-				}
-
-				genome->SetFitness(1.0 - error / 4.0);
-			}
+			anOutIsPruned = true;
+			break;
 		}
-	});
+	}
+
+	return 1.0 - error / 4.0;
 }
 
 void TrainNeat()
@@ -64,22 +66,30 @@ void TrainNeat()
 	Neat::Population population = Neat::Population(100, 2, 1);
 	Neat::Population::TrainingCallbacks callbacks;
 
-	callbacks.myEvaluateGenomes = [&population, &threadPool]() {
-		size_t runPerThread = population.GetSize() / threadPool.GetWorkersCount() + 1;
-		size_t startIdx = 0;
-		while (startIdx < population.GetSize())
-		{
-			EvaluatePopulationAsync(threadPool, population, startIdx, startIdx + runPerThread);
-			startIdx = std::min(population.GetSize(), startIdx + runPerThread);
-		}
-		threadPool.WaitIdle();
+	callbacks.myParallelFor = [&threadPool](size_t aCount, const std::function<void(size_t)>& aJob) {
+		threadPool.ParallelFor(aCount, aJob);
+	};
+
+	Neat::Evaluator evaluator(threadPool.GetWorkersCount(), [](Neat::Genome& aGenome, size_t /*aWorkerIdx*/, double aFitnessCutoff, bool& anOutIsPruned) {
+		return EvaluateGenome(aGenome, aFitnessCutoff, anOutIsPruned);
+	});
+#if USE_PRUNING
+	evaluator.EnablePruning(0.5);
+#endif
+	// The fitness only depends on the phenotype
+	population.EnableFitnessCache(true);
+	callbacks.myEvaluateGenomes = [&population, &evaluator, &callbacks]() {
+		evaluator.EvaluateGenomes(population, callbacks.myParallelFor);
 	};
 
 	int generationIdx = 0;
-	callbacks.myOnTrainGenerationEnd = [&population, &generationIdx]() {
+	callbacks.myOnTrainGenerationEnd = [&population, &evaluator, &generationIdx]() {
 		population.Check();
 		std::cout << "Population Size : " << population.GetSize() << std::endl;
 		std::cout << "Species Count : " << population.GetSpecies().size() << std::endl;
+		std::cout << "Evaluation Utilization : " << 100.0 * evaluator.GetStats().GetUtilization() << "%" << std::endl;
+		std::cout << "Pruned Evaluations : " << evaluator.GetStats().myPrunedCount << std::endl;
+		std::cout << "Fitness Cache Hits : " << 100.0 * population.GetFitnessCacheStats().GetHitRate() << "%" << std::endl;
 		if (const Neat::Genome* bestGenome = population.GetBestGenome())
 		{
 			std::cout << "Generation " << generationIdx << ": Best Fitness : " << bestGenome->GetFitness() << std::endl;
@@ -0,0 +1,90 @@
+#include "BackgroundTraining.h"
+
+#include <cfloat>
+#include <utility>
+
+namespace Neat {
+
+void GenomeExchange::Publish(const Genome& aGenome)
+{
+	// The copy reuses the buffers of a previous genome, and doesn't point to a specie of the population
+	Genome& genome = myBuffers[myWriteIdx];
+	genome = aGenome;
+	genome.SetSpecie(nullptr);
+
+	std::uint8_t previousIdx = mySharedIdx.exchange(myWriteIdx | ourNewFlag, std::memory_order_acq_rel);
+	myWriteIdx = previousIdx & ourIdxMask;
+}
+
+bool GenomeExchange::ConsumeLatest(Genome& anOutGenome)
+{
+	if ((mySharedIdx.load(std::memory_order_relaxed) & ourNewFlag) == 0)
+		return false;
+
+	std::uint8_t previousIdx = mySharedIdx.exchange(myReadIdx, std::memory_order_acq_rel);
+	myReadIdx = previousIdx & ourIdxMask;
+	std::swap(anOutGenome, myBuffers[myReadIdx]);
+	return true;
+}
+
+void GenomeExchange::Discard()
+{
+	mySharedIdx.fetch_and(ourIdxMask, std::memory_order_acq_rel);
+}
+
+BackgroundTraining::BackgroundTraining(size_t aTelemetryCapacity /*= 4096*/)
+	: myTelemetry(aTelemetryCapacity)
+{
+}
+
+BackgroundTraining::~BackgroundTraining()
+{
+	Stop();
+}
+
+void BackgroundTraining::Start(std::function<void()> aTrain)
+{
+	Stop();
+	myTelemetry.Clear();
+	myBestGenome.Discard();
+
+	myIsRunning = true;
+	myThread = std::thread([this, train = std::move(aTrain)]() {
+		train();
+		myIsRunning = false;
+	});
+}
+
+void BackgroundTraining::Stop()
+{
+	myIsStopRequested = true;
+	if (myThread.joinable())
+		myThread.join();
+	myIsStopRequested = false;
+}
+
+void BackgroundTraining::TrainGenerations(Population& aPopulation, const Population::TrainingCallbacks& someCallbacks, int aMaxGenerationCount, double aSatisfactionThreshold)
+{
+	aPopulation.SetTelemetry(&myTelemetry);
+
+	double publishedFitness = -DBL_MAX;
+	for (int i = 0; i < aMaxGenerationCount && !myIsStopRequested; ++i)
+	{
+		aPopulation.TrainOneGeneration(someCallbacks);
+		const Genome* bestGenome = aPopulation.GetBestGenome();
+		if (!bestGenome)
+			continue;
+
+		if (bestGenome->GetFitness() > publishedFitness)
+		{
+			publishedFitness = bestGenome->GetFitness();
+			myBestGenome.Publish(*bestGenome);
+		}
+		if (bestGenome->GetFitness() >= aSatisfactionThreshold)
+			break;
+	}
+
+	aPopulation.SetTelemetry(nullptr);
+}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Genome.h"
+#include "Population.h"
+#include "Telemetry.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace Neat {
+
+// Last genome published by a thread for another one. Triple buffer: the writer fills its own buffer then exchanges it
+// with the shared one, the reader exchanges its own with the shared one when it is newer, neither side ever waits.
+class GenomeExchange
+{
+public:
+	void Publish(const Genome& aGenome); // Writer thread only
+	// Reader thread only, swaps the last published genome into anOutGenome, false if none was published since the last call
+	bool ConsumeLatest(Genome& anOutGenome);
+	// Drops the genome published and not consumed yet, while no writer publishes
+	void Discard();
+
+private:
+	static constexpr std::uint8_t ourIdxMask = 3;
+	static constexpr std::uint8_t ourNewFlag = 4; // On the shared index, until the reader takes the published buffer
+
+	Genome myBuffers[3];
+	std::uint8_t myWriteIdx = 0;
+	std::atomic<std::uint8_t> mySharedIdx = 1;
+	std::uint8_t myReadIdx = 2;
+};
+
+// Runs a training on its own thread, e.g. while a window keeps rendering. The generations are recorded in a telemetry and
+// the best genome is published at each improvement, both are read from any thread without pausing the training.
+class BackgroundTraining
+{
+public:
+	explicit BackgroundTraining(size_t aTelemetryCapacity = 4096);
+	~BackgroundTraining(); // Stops the training
+
+	BackgroundTraining(const BackgroundTraining&) = delete;
+	BackgroundTraining& operator=(const BackgroundTraining&) = delete;
+
+	// Runs aTrain on the training thread, it builds its population and its workers, then calls TrainGenerations.
+	// The telemetry and the best genome of the previous training are cleared.
+	void Start(std::function<void()> aTrain);
+	// Ends the training at the end of its current generation and waits for aTrain to return
+	void Stop();
+	bool IsRunning() const { return myIsRunning.load(); }
+	bool IsStopRequested() const { return myIsStopRequested.load(); }
+
+	// Population::TrainGenerations on the training thread, which also ends when the stop is requested
+	void TrainGenerations(Population& aPopulation, const Population::TrainingCallbacks& someCallbacks, int aMaxGenerationCount, double aSatisfactionThreshold);
+
+	const Telemetry& GetTelemetry() const { return myTelemetry; }
+	GenomeExchange& GetBestGenome() { return myBestGenome; }
+
+private:
+	std::thread myThread;
+	std::atomic<bool> myIsRunning = false;
+	std::atomic<bool> myIsStopRequested = false;
+
+	Telemetry myTelemetry;
+	GenomeExchange myBestGenome;
+};
+
+}
@@ -0,0 +1,211 @@
+#include "Checkpoint.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Neat {
+
+namespace {
+
+// Flushes the file to the disk, the rename is only atomic on a power loss if the data it points to is already there
+bool SyncFile(FILE* aFile)
+{
+#if defined(_WIN32)
+	return _commit(_fileno(aFile)) == 0;
+#else
+	return fsync(fileno(aFile)) == 0;
+#endif
+}
+
+// Flushes the rename itself, Windows has no equivalent for directories and commits it with the file system metadata
+void SyncParentDirectory(const char* aFilePath)
+{
+#if !defined(_WIN32)
+	std::filesystem::path directoryPath = std::filesystem::path(aFilePath).parent_path();
+	int directory = open(directoryPath.empty() ? "." : directoryPath.c_str(), O_RDONLY);
+	if (directory >= 0)
+	{
+		fsync(directory);
+		close(directory);
+	}
+#else
+	(void)aFilePath;
+#endif
+}
+
+}
+
+CheckpointWriter::CheckpointWriter()
+{
+	Append(CheckpointFormat::ourMagic, sizeof(CheckpointFormat::ourMagic));
+	Write(CheckpointFormat::ourVersion);
+	Write(CheckpointFormat::ourByteOrderMark);
+}
+
+bool CheckpointWriter::Commit(const char* aFilePath) const
+{
+	std::string tempFilePath = std::string(aFilePath) + ".tmp";
+
+	FILE* file = std::fopen(tempFilePath.c_str(), "wb");
+	if (!file)
+		return false;
+
+	bool written = std::fwrite(myBuffer.data(), 1, myBuffer.size(), file) == myBuffer.size();
+	written &= std::fflush(file) == 0;
+	written &= SyncFile(file);
+	written &= std::fclose(file) == 0;
+
+	std::error_code error;
+	if (written)
+	{
+		std::filesystem::rename(tempFilePath, aFilePath, error);
+		if (!error)
+			SyncParentDirectory(aFilePath);
+	}
+
+	if (!written || error)
+	{
+		std::filesystem::remove(tempFilePath, error);
+		return false;
+	}
+	return true;
+}
+
+void CheckpointWriter::Append(const void* aData, size_t aSize)
+{
+	const char* data = static_cast<const char*>(aData);
+	myBuffer.insert(myBuffer.end(), data, data + aSize);
+}
+
+void CheckpointWriter::Align()
+{
+	size_t padding = (CheckpointFormat::ourArrayAlignment - myBuffer.size() % CheckpointFormat::ourArrayAlignment) % CheckpointFormat::ourArrayAlignment;
+	myBuffer.resize(myBuffer.size() + padding, 0);
+}
+
+struct CheckpointReader::MappedFile
+{
+#if defined(_WIN32)
+	HANDLE myFile = INVALID_HANDLE_VALUE;
+	HANDLE myMapping = nullptr;
+#else
+	int myFile = -1;
+#endif
+	void* myView = nullptr;
+	size_t mySize = 0;
+
+	MappedFile(const char* aFilePath)
+	{
+#if defined(_WIN32)
+		myFile = CreateFileA(aFilePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (myFile == INVALID_HANDLE_VALUE)
+			return;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(myFile, &size) || size.QuadPart == 0)
+			return;
+
+		myMapping = CreateFileMappingA(myFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!myMapping)
+			return;
+
+		myView = MapViewOfFile(myMapping, FILE_MAP_READ, 0, 0, 0);
+		if (myView)
+			mySize = static_cast<size_t>(size.QuadPart);
+#else
+		myFile = open(aFilePath, O_RDONLY);
+		if (myFile < 0)
+			return;
+
+		struct stat status;
+		if (fstat(myFile, &status) != 0 || status.st_size == 0)
+			return;
+
+		void* view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, myFile, 0);
+		if (view != MAP_FAILED)
+		{
+			myView = view;
+			mySize = static_cast<size_t>(status.st_size);
+		}
+#endif
+	}
+
+	~MappedFile()
+	{
+#if defined(_WIN32)
+		if (myView)
+			UnmapViewOfFile(myView);
+		if (myMapping)
+			CloseHandle(myMapping);
+		if (myFile != INVALID_HANDLE_VALUE)
+			CloseHandle(myFile);
+#else
+		if (myView)
+			munmap(myView, mySize);
+		if (myFile >= 0)
+			close(myFile);
+#endif
+	}
+};
+
+CheckpointReader::CheckpointReader(const char* aFilePath)
+	: myFile(std::make_unique<MappedFile>(aFilePath))
+{
+	if (!myFile->myView)
+		return;
+
+	myData = static_cast<const char*>(myFile->myView);
+	mySize = myFile->mySize;
+	ReadHeader();
+}
+
+CheckpointReader::CheckpointReader(std::span<const char> someData)
+{
+	if (someData.empty() || reinterpret_cast<std::uintptr_t>(someData.data()) % CheckpointFormat::ourArrayAlignment != 0)
+		return;
+
+	myData = someData.data();
+	mySize = someData.size();
+	ReadHeader();
+}
+
+CheckpointReader::~CheckpointReader() = default;
+
+void CheckpointReader::ReadHeader()
+{
+	char magic[sizeof(CheckpointFormat::ourMagic)];
+	std::uint32_t version = 0;
+	std::uint32_t byteOrderMark = 0;
+	if (!Read(magic) || !Read(version) || !Read(byteOrderMark))
+		return;
+
+	if (std::memcmp(magic, CheckpointFormat::ourMagic, sizeof(magic)) != 0
+		|| version != CheckpointFormat::ourVersion
+		|| byteOrderMark != CheckpointFormat::ourByteOrderMark)
+		Fail();
+}
+
+bool CheckpointReader::Align()
+{
+	size_t padding = (CheckpointFormat::ourArrayAlignment - myOffset % CheckpointFormat::ourArrayAlignment) % CheckpointFormat::ourArrayAlignment;
+	if (mySize - myOffset < padding)
+		return Fail();
+
+	myOffset += padding;
+	return true;
+}
+
+}
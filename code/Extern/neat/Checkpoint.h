@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace Neat {
+
+// Versioned binary format of the population checkpoints, see Population::SaveCheckpoint.
+// The arrays are aligned in the file so that they are read in place from the memory-mapped file, without parsing.
+struct CheckpointFormat
+{
+	static constexpr char ourMagic[8] = { 'N', 'E', 'A', 'T', 'C', 'K', 'P', 'T' };
+	static constexpr std::uint32_t ourVersion = 3;
+	static constexpr std::uint32_t ourByteOrderMark = 0x01020304; // Checkpoints are not portable across endianness
+	static constexpr size_t ourArrayAlignment = 16;
+};
+
+class CheckpointWriter
+{
+public:
+	CheckpointWriter();
+
+	template<typename T>
+	void Write(const T& aValue)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		Append(&aValue, sizeof(T));
+	}
+
+	template<typename T>
+	void WriteArray(std::span<const T> someValues)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		Write<std::uint64_t>(someValues.size());
+		Align();
+		Append(someValues.data(), someValues.size_bytes());
+	}
+
+	// Writes and syncs a temporary file then renames it, so that neither a crash nor a power loss leaves a truncated checkpoint
+	bool Commit(const char* aFilePath) const;
+
+	// Whole content, header included, e.g. to send it to another process
+	std::span<const char> GetData() const { return myBuffer; }
+
+private:
+	void Append(const void* aData, size_t aSize);
+	void Align();
+
+	std::vector<char> myBuffer;
+};
+
+class CheckpointReader
+{
+public:
+	CheckpointReader(const char* aFilePath); // Maps the file, check IsValid
+	// Reads the content of a CheckpointWriter in memory, someData must outlive the reader and be aligned on
+	// CheckpointFormat::ourArrayAlignment since the arrays are read in place
+	explicit CheckpointReader(std::span<const char> someData);
+	~CheckpointReader();
+
+	CheckpointReader(const CheckpointReader&) = delete;
+	CheckpointReader& operator=(const CheckpointReader&) = delete;
+
+	// False if the file could not be mapped, has another format, or if a read went out of bounds
+	bool IsValid() const { return myData && !myFailed; }
+
+	template<typename T>
+	bool Read(T& anOutValue)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		if (myFailed || mySize - myOffset < sizeof(T))
+			return Fail();
+
+		std::memcpy(&anOutValue, myData + myOffset, sizeof(T));
+		myOffset += sizeof(T);
+		return true;
+	}
+
+	// Points into the mapped file, valid as long as the reader
+	template<typename T>
+	std::span<const T> ReadArray()
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		static_assert(CheckpointFormat::ourArrayAlignment % alignof(T) == 0);
+		std::uint64_t count = 0;
+		if (!Read(count) || !Align() || count > (mySize - myOffset) / sizeof(T))
+		{
+			Fail();
+			return {};
+		}
+
+		const T* values = reinterpret_cast<const T*>(myData + myOffset);
+		myOffset += static_cast<size_t>(count) * sizeof(T);
+		return std::span<const T>(values, static_cast<size_t>(count));
+	}
+
+private:
+	struct MappedFile;
+
+	void ReadHeader();
+	bool Align();
+	bool Fail() { myFailed = true; return false; }
+
+	std::unique_ptr<MappedFile> myFile;
+	const char* myData = nullptr;
+	size_t mySize = 0;
+	size_t myOffset = 0;
+	bool myFailed = false;
+};
+
+}
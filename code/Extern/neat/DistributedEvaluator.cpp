@@ -0,0 +1,600 @@
+#include "DistributedEvaluator.h"
+
+#include "Checkpoint.h"
+#include "EvolutionParams.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <span>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace Neat {
+
+namespace {
+
+#if defined(_WIN32)
+using SocketHandle = SOCKET;
+const SocketHandle ourInvalidSocket = INVALID_SOCKET;
+#else
+using SocketHandle = int;
+const SocketHandle ourInvalidSocket = -1;
+#endif
+
+const std::uint64_t ourMaxMessageSize = 1ull << 30; // Anything bigger is a corrupted size
+const int ourProcessExitTimeoutMs = 5000; // Then the worker process is killed
+
+// The messages are read in place by a CheckpointReader, which needs its arrays aligned
+struct alignas(CheckpointFormat::ourArrayAlignment) MessageBlock
+{
+	char myBytes[CheckpointFormat::ourArrayAlignment];
+};
+
+enum class ReceiveStatus
+{
+	Message,
+	Closed, // By the other side, between two messages
+	Error,
+};
+
+int PollSockets(std::vector<pollfd>& someSockets, int aTimeoutMs)
+{
+#if defined(_WIN32)
+	return WSAPoll(someSockets.data(), static_cast<ULONG>(someSockets.size()), aTimeoutMs);
+#else
+	return poll(someSockets.data(), static_cast<nfds_t>(someSockets.size()), aTimeoutMs);
+#endif
+}
+
+}
+
+// TCP socket on the loopback interface, the messages are prefixed by their size
+class Socket
+{
+public:
+	Socket()
+	{
+#if defined(_WIN32)
+		static const bool ourIsWinsockStarted = []() {
+			WSADATA data;
+			return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+		}();
+		(void)ourIsWinsockStarted;
+#endif
+	}
+
+	explicit Socket(SocketHandle aHandle)
+		: Socket()
+	{
+		myHandle = aHandle;
+	}
+
+	~Socket() { Close(); }
+
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+
+	bool IsValid() const { return myHandle != ourInvalidSocket; }
+	SocketHandle GetHandle() const { return myHandle; }
+
+	void Close()
+	{
+		if (myHandle == ourInvalidSocket)
+			return;
+#if defined(_WIN32)
+		closesocket(myHandle);
+#else
+		close(myHandle);
+#endif
+		myHandle = ourInvalidSocket;
+	}
+
+	// anOutPort is the port chosen by the system when aPort is 0
+	bool Listen(std::uint16_t aPort, std::uint16_t& anOutPort)
+	{
+		myHandle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (myHandle == ourInvalidSocket)
+			return false;
+
+		sockaddr_in address = GetLoopbackAddress(aPort);
+		socklen_t addressSize = sizeof(address);
+		if (bind(myHandle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+			|| listen(myHandle, SOMAXCONN) != 0
+			|| getsockname(myHandle, reinterpret_cast<sockaddr*>(&address), &addressSize) != 0)
+		{
+			Close();
+			return false;
+		}
+
+		anOutPort = ntohs(address.sin_port);
+		return true;
+	}
+
+	std::unique_ptr<Socket> Accept()
+	{
+		SocketHandle handle = accept(myHandle, nullptr, nullptr);
+		if (handle == ourInvalidSocket)
+			return nullptr;
+
+		std::unique_ptr<Socket> acceptedSocket = std::make_unique<Socket>(handle);
+		acceptedSocket->DisableDelay();
+		return acceptedSocket;
+	}
+
+	bool Connect(std::uint16_t aPort)
+	{
+		Close();
+		myHandle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (myHandle == ourInvalidSocket)
+			return false;
+
+		sockaddr_in address = GetLoopbackAddress(aPort);
+		if (connect(myHandle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+		{
+			Close();
+			return false;
+		}
+
+		DisableDelay();
+		return true;
+	}
+
+	bool Send(std::span<const char> someData)
+	{
+		std::uint64_t size = someData.size();
+		return SendAll(&size, sizeof(size)) && SendAll(someData.data(), someData.size());
+	}
+
+	// anOutMessage points into someOutBuffer, which is reused from a message to the next
+	ReceiveStatus Receive(std::vector<MessageBlock>& someOutBuffer, std::span<const char>& anOutMessage)
+	{
+		std::uint64_t size = 0;
+		size_t receivedSize = 0;
+		if (!ReceiveAll(&size, sizeof(size), receivedSize))
+			return receivedSize == 0 ? ReceiveStatus::Closed : ReceiveStatus::Error;
+		if (size > ourMaxMessageSize)
+			return ReceiveStatus::Error;
+
+		someOutBuffer.resize((static_cast<size_t>(size) + sizeof(MessageBlock) - 1) / sizeof(MessageBlock));
+		if (!ReceiveAll(someOutBuffer.data(), static_cast<size_t>(size), receivedSize))
+			return ReceiveStatus::Error;
+
+		anOutMessage = std::span<const char>(reinterpret_cast<const char*>(someOutBuffer.data()), static_cast<size_t>(size));
+		return ReceiveStatus::Message;
+	}
+
+private:
+	static sockaddr_in GetLoopbackAddress(std::uint16_t aPort)
+	{
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(aPort);
+		return address;
+	}
+
+	// The results are small messages, they are sent right away instead of waiting to be merged with the next ones
+	void DisableDelay()
+	{
+		int noDelay = 1;
+		setsockopt(myHandle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+	}
+
+	bool SendAll(const void* aData, size_t aSize)
+	{
+		const char* data = static_cast<const char*>(aData);
+		while (aSize > 0)
+		{
+#if defined(_WIN32)
+			int sentSize = send(myHandle, data, static_cast<int>(std::min<size_t>(aSize, INT_MAX)), 0);
+#else
+			// A lost peer returns an error instead of raising SIGPIPE
+			ssize_t sentSize = send(myHandle, data, aSize, MSG_NOSIGNAL);
+#endif
+			if (sentSize <= 0)
+				return false;
+			data += sentSize;
+			aSize -= static_cast<size_t>(sentSize);
+		}
+		return true;
+	}
+
+	bool ReceiveAll(void* anOutData, size_t aSize, size_t& anOutReceivedSize)
+	{
+		char* data = static_cast<char*>(anOutData);
+		anOutReceivedSize = 0;
+		while (anOutReceivedSize < aSize)
+		{
+#if defined(_WIN32)
+			int receivedSize = recv(myHandle, data + anOutReceivedSize, static_cast<int>(std::min<size_t>(aSize - anOutReceivedSize, INT_MAX)), 0);
+#else
+			ssize_t receivedSize = recv(myHandle, data + anOutReceivedSize, aSize - anOutReceivedSize, 0);
+#endif
+			if (receivedSize <= 0)
+				return false;
+			anOutReceivedSize += static_cast<size_t>(receivedSize);
+		}
+		return true;
+	}
+
+	SocketHandle myHandle = ourInvalidSocket;
+};
+
+struct DistributedEvaluator::Batch
+{
+	std::uint64_t myId = 0;
+	std::vector<size_t> myGenomeIndices;
+	CheckpointWriter myMessage; // Kept to be sent again if the worker is lost
+};
+
+struct DistributedEvaluator::Worker
+{
+	std::unique_ptr<Socket> mySocket;
+	std::deque<size_t> myBatches; // Sent and not returned yet, in the order the worker evaluates them
+	std::chrono::steady_clock::time_point myDeadline; // Of the first batch, started when the previous one was returned
+	std::vector<MessageBlock> myReceiveBuffer;
+};
+
+struct DistributedEvaluator::Process
+{
+#if defined(_WIN32)
+	HANDLE myHandle = nullptr;
+#else
+	pid_t myPid = -1;
+#endif
+
+	~Process()
+	{
+#if defined(_WIN32)
+		if (!myHandle)
+			return;
+		if (WaitForSingleObject(myHandle, ourProcessExitTimeoutMs) != WAIT_OBJECT_0)
+			TerminateProcess(myHandle, EXIT_FAILURE);
+		CloseHandle(myHandle);
+#else
+		if (myPid <= 0)
+			return;
+		for (int waitedMs = 0; waitpid(myPid, nullptr, WNOHANG) == 0; waitedMs += 10)
+		{
+			if (waitedMs >= ourProcessExitTimeoutMs)
+			{
+				kill(myPid, SIGKILL);
+				waitpid(myPid, nullptr, 0);
+				break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+#endif
+	}
+};
+
+DistributedEvaluator::DistributedEvaluator(std::uint16_t aPort /*= 0*/)
+	: myListener(std::make_unique<Socket>())
+{
+	myListener->Listen(aPort, myPort);
+}
+
+DistributedEvaluator::~DistributedEvaluator()
+{
+	// The workers stop when the coordinator disconnects
+	myWorkers.clear();
+	myListener->Close();
+	myProcesses.clear();
+}
+
+bool DistributedEvaluator::IsListening() const
+{
+	return myListener->IsValid();
+}
+
+bool DistributedEvaluator::LaunchWorkers(size_t aCount, const char* anExecutablePath, const std::vector<std::string>& someArguments)
+{
+	for (size_t i = 0; i < aCount; ++i)
+	{
+		std::unique_ptr<Process> process = std::make_unique<Process>();
+#if defined(_WIN32)
+		std::string commandLine = std::string("\"") + anExecutablePath + "\"";
+		for (const std::string& argument : someArguments)
+			commandLine += " \"" + argument + "\"";
+
+		STARTUPINFOA startupInfo = {};
+		startupInfo.cb = sizeof(startupInfo);
+		PROCESS_INFORMATION processInfo = {};
+		if (!CreateProcessA(anExecutablePath, commandLine.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &processInfo))
+			return false;
+		CloseHandle(processInfo.hThread);
+		process->myHandle = processInfo.hProcess;
+#else
+		std::vector<char*> arguments;
+		arguments.push_back(const_cast<char*>(anExecutablePath));
+		for (const std::string& argument : someArguments)
+			arguments.push_back(const_cast<char*>(argument.c_str()));
+		arguments.push_back(nullptr);
+
+		if (posix_spawn(&process->myPid, anExecutablePath, nullptr, nullptr, arguments.data(), environ) != 0)
+			return false;
+#endif
+		myProcesses.push_back(std::move(process));
+	}
+	return true;
+}
+
+bool DistributedEvaluator::WaitForWorkers(size_t aCount, double aTimeoutSec)
+{
+	using Clock = std::chrono::steady_clock;
+
+	Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(aTimeoutSec));
+	while (myWorkers.size() < aCount && IsListening())
+	{
+		int remainingMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+		if (remainingMs <= 0)
+			break;
+
+		std::vector<pollfd> sockets = { { myListener->GetHandle(), POLLIN, 0 } };
+		if (PollSockets(sockets, remainingMs) > 0)
+			AcceptWorker();
+	}
+	return myWorkers.size() >= aCount;
+}
+
+void DistributedEvaluator::SetBatching(size_t aBatchSize, size_t aBatchesInFlight)
+{
+	myBatchSize = std::max<size_t>(aBatchSize, 1);
+	myBatchesInFlight = std::max<size_t>(aBatchesInFlight, 1);
+}
+
+bool DistributedEvaluator::EvaluateGenomes(Population& aPopulation)
+{
+	using Clock = std::chrono::steady_clock;
+
+	Clock::time_point start = Clock::now();
+	myStats = Stats();
+
+	// The batches are written once, the workers compile the genomes with the same phenotype settings as this process
+	myBatches.clear();
+	for (size_t i = 0; i < aPopulation.GetSize(); ++i)
+	{
+		if (aPopulation.IsFitnessCached(i))
+			continue;
+		if (myBatches.empty() || myBatches.back().myGenomeIndices.size() >= myBatchSize)
+			myBatches.emplace_back().myId = myNextBatchId++;
+		myBatches.back().myGenomeIndices.push_back(i);
+	}
+	for (Batch& batch : myBatches)
+	{
+		batch.myMessage.Write(batch.myId);
+		batch.myMessage.Write(EvolutionParams::ourPhenotypePrecision);
+		batch.myMessage.Write(EvolutionParams::ourPhenotypeActivation);
+		batch.myMessage.Write<std::uint64_t>(batch.myGenomeIndices.size());
+		for (size_t genomeIdx : batch.myGenomeIndices)
+			aPopulation.GetGenome(genomeIdx)->WriteCheckpoint(batch.myMessage);
+		myStats.myGenomesCount += batch.myGenomeIndices.size();
+	}
+	myStats.myBatchesCount = myBatches.size();
+
+	std::deque<size_t> pendingBatches;
+	for (size_t i = 0; i < myBatches.size(); ++i)
+		pendingBatches.push_back(i);
+
+	size_t evaluatedBatchesCount = 0;
+	std::vector<pollfd> sockets;
+	while (evaluatedBatchesCount < myBatches.size())
+	{
+		// Every worker has the next batches while it evaluates the current one
+		for (size_t i = 0; i < myWorkers.size();)
+		{
+			Worker& worker = *myWorkers[i];
+			bool isSent = true;
+			while (isSent && worker.myBatches.size() < myBatchesInFlight && !pendingBatches.empty())
+			{
+				isSent = SendBatch(worker, pendingBatches.front());
+				if (isSent)
+					pendingBatches.pop_front();
+			}
+
+			if (isSent)
+				++i;
+			else
+				LoseWorker(i, pendingBatches);
+		}
+
+		if (myWorkers.empty())
+			break;
+
+		// Waits for results, for a new worker, or until the first deadline
+		int timeoutMs = -1;
+		sockets.clear();
+		sockets.push_back({ myListener->GetHandle(), POLLIN, 0 });
+		for (const std::unique_ptr<Worker>& worker : myWorkers)
+		{
+			sockets.push_back({ worker->mySocket->GetHandle(), POLLIN, 0 });
+			if (myBatchTimeoutSec > 0.0 && !worker->myBatches.empty())
+			{
+				std::int64_t remainingMs = std::chrono::ceil<std::chrono::milliseconds>(worker->myDeadline - Clock::now()).count();
+				remainingMs = std::clamp<std::int64_t>(remainingMs, 0, INT_MAX);
+				timeoutMs = timeoutMs < 0 ? static_cast<int>(remainingMs) : std::min(timeoutMs, static_cast<int>(remainingMs));
+			}
+		}
+		if (PollSockets(sockets, timeoutMs) < 0)
+			break;
+
+		for (size_t i = myWorkers.size(); i-- > 0;)
+		{
+			short events = sockets[i + 1].revents;
+			if (events == 0)
+				continue;
+			if ((events & POLLIN) == 0 || !ReceiveResults(*myWorkers[i], aPopulation, evaluatedBatchesCount))
+				LoseWorker(i, pendingBatches);
+		}
+
+		// A hung worker keeps its socket open, only its deadline tells it is lost
+		if (myBatchTimeoutSec > 0.0)
+		{
+			Clock::time_point now = Clock::now();
+			for (size_t i = myWorkers.size(); i-- > 0;)
+			{
+				if (!myWorkers[i]->myBatches.empty() && myWorkers[i]->myDeadline <= now)
+				{
+					myStats.myTimedOutWorkersCount++;
+					LoseWorker(i, pendingBatches);
+				}
+			}
+		}
+
+		if (sockets[0].revents & POLLIN)
+			AcceptWorker();
+	}
+
+	myStats.myDurationSec = std::chrono::duration<double>(Clock::now() - start).count();
+	return evaluatedBatchesCount == myBatches.size();
+}
+
+void DistributedEvaluator::AcceptWorker()
+{
+	if (std::unique_ptr<Socket> socket = myListener->Accept())
+	{
+		std::unique_ptr<Worker> worker = std::make_unique<Worker>();
+		worker->mySocket = std::move(socket);
+		myWorkers.push_back(std::move(worker));
+	}
+}
+
+bool DistributedEvaluator::SendBatch(Worker& aWorker, size_t aBatchIdx)
+{
+	std::span<const char> message = myBatches[aBatchIdx].myMessage.GetData();
+	if (!aWorker.mySocket->Send(message))
+		return false;
+
+	if (aWorker.myBatches.empty())
+		aWorker.myDeadline = GetBatchDeadline();
+	aWorker.myBatches.push_back(aBatchIdx);
+	myStats.mySentBytes += message.size();
+	return true;
+}
+
+bool DistributedEvaluator::ReceiveResults(Worker& aWorker, Population& aPopulation, size_t& anOutEvaluatedBatchesCount)
+{
+	std::span<const char> message;
+	if (aWorker.myBatches.empty() || aWorker.mySocket->Receive(aWorker.myReceiveBuffer, message) != ReceiveStatus::Message)
+		return false;
+
+	// The worker evaluates its batches in the order they were sent
+	const Batch& batch = myBatches[aWorker.myBatches.front()];
+	CheckpointReader reader(message);
+	std::uint64_t batchId = 0;
+	reader.Read(batchId);
+	std::span<const double> fitnesses = reader.ReadArray<double>();
+	if (!reader.IsValid() || batchId != batch.myId || fitnesses.size() != batch.myGenomeIndices.size())
+		return false;
+
+	for (size_t i = 0; i < fitnesses.size(); ++i)
+		aPopulation.GetGenome(batch.myGenomeIndices[i])->SetFitness(fitnesses[i]);
+
+	aWorker.myBatches.pop_front();
+	aWorker.myDeadline = GetBatchDeadline(); // The worker starts its next batch
+	anOutEvaluatedBatchesCount++;
+	return true;
+}
+
+std::chrono::steady_clock::time_point DistributedEvaluator::GetBatchDeadline() const
+{
+	using Clock = std::chrono::steady_clock;
+	return Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(myBatchTimeoutSec));
+}
+
+void DistributedEvaluator::LoseWorker(size_t aWorkerIdx, std::deque<size_t>& someOutPendingBatches)
+{
+	// Its batches go first, in their order, to the next free workers
+	std::deque<size_t>& batches = myWorkers[aWorkerIdx]->myBatches;
+	someOutPendingBatches.insert(someOutPendingBatches.begin(), batches.begin(), batches.end());
+	myStats.myResentBatchesCount += batches.size();
+	myStats.myLostWorkersCount++;
+	myWorkers.erase(myWorkers.begin() + aWorkerIdx);
+}
+
+DistributedWorker::DistributedWorker(EvaluateGenome anEvaluateGenome)
+	: myEvaluateGenome(std::move(anEvaluateGenome))
+	, mySocket(std::make_unique<Socket>())
+{
+}
+
+DistributedWorker::~DistributedWorker() = default;
+
+bool DistributedWorker::Connect(std::uint16_t aPort, double aTimeoutSec /*= 10.0*/)
+{
+	using Clock = std::chrono::steady_clock;
+
+	Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(aTimeoutSec));
+	while (!mySocket->Connect(aPort))
+	{
+		if (Clock::now() >= deadline)
+			return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+	return true;
+}
+
+bool DistributedWorker::Run()
+{
+	std::vector<MessageBlock> receiveBuffer;
+	std::vector<double> fitnesses;
+	Genome genome; // Reused for all the genomes, so are its buffers
+	while (true)
+	{
+		std::span<const char> message;
+		ReceiveStatus status = mySocket->Receive(receiveBuffer, message);
+		if (status != ReceiveStatus::Message)
+			return status == ReceiveStatus::Closed;
+
+		CheckpointReader reader(message);
+		std::uint64_t batchId = 0;
+		std::uint64_t genomesCount = 0;
+		Phenotype::Precision phenotypePrecision = Phenotype::Precision::Double;
+		Phenotype::Activation phenotypeActivation = Phenotype::Activation::Exact;
+		reader.Read(batchId);
+		reader.Read(phenotypePrecision);
+		reader.Read(phenotypeActivation);
+		reader.Read(genomesCount);
+		if (!reader.IsValid() || !EvolutionParams::IsValidPhenotypeBackend(phenotypePrecision, phenotypeActivation))
+			return false;
+		EvolutionParams::ourPhenotypePrecision = phenotypePrecision;
+		EvolutionParams::ourPhenotypeActivation = phenotypeActivation;
+
+		fitnesses.clear();
+		for (std::uint64_t i = 0; i < genomesCount; ++i)
+		{
+			if (!genome.ReadCheckpoint(reader))
+				return false;
+			fitnesses.push_back(myEvaluateGenome(genome));
+			myEvaluatedGenomesCount++;
+		}
+
+		CheckpointWriter results;
+		results.Write(batchId);
+		results.WriteArray<double>(fitnesses);
+		if (!mySocket->Send(results.GetData()))
+			return false;
+	}
+}
+
+}
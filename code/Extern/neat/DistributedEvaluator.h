@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Population.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Neat {
+
+class Socket; // Platform sockets, defined in the .cpp
+
+// Evaluates the genomes of a population in worker processes, to use more cores than a single process can.
+// The coordinator listens on a TCP port of the loopback interface and the workers, each running a DistributedWorker,
+// connect to it at any time. The genomes are sent by batches in the binary format of the checkpoints, with their
+// execution order, and each worker gets a few batches ahead so that it never waits for the next one.
+// When a worker disconnects, e.g. its process crashed, or hangs on a batch past the batch timeout, its batches are sent
+// again to the other workers.
+// The workers only receive the genomes, so the evaluations must be deterministic as for Population::EnableFitnessCache,
+// and the genomes found in the fitness cache are not sent.
+class DistributedEvaluator
+{
+public:
+	// Listens on aPort, or on any free port if 0, see GetPort
+	explicit DistributedEvaluator(std::uint16_t aPort = 0);
+	~DistributedEvaluator(); // Disconnects the workers, then waits for the processes it launched to stop
+
+	DistributedEvaluator(const DistributedEvaluator&) = delete;
+	DistributedEvaluator& operator=(const DistributedEvaluator&) = delete;
+
+	bool IsListening() const;
+	std::uint16_t GetPort() const { return myPort; }
+
+	// Starts aCount processes of anExecutablePath with someArguments, which have to run a DistributedWorker connected to GetPort
+	bool LaunchWorkers(size_t aCount, const char* anExecutablePath, const std::vector<std::string>& someArguments);
+	// Accepts the workers until aCount of them are connected, false if they are not after aTimeoutSec
+	bool WaitForWorkers(size_t aCount, double aTimeoutSec);
+	size_t GetWorkersCount() const { return myWorkers.size(); }
+
+	// aBatchSize genomes per message, and up to aBatchesInFlight batches sent to a worker before it returns the first one
+	void SetBatching(size_t aBatchSize, size_t aBatchesInFlight);
+	// A worker which doesn't return a batch aTimeoutSec after starting it is lost as if it disconnected, 0 to wait forever.
+	// It has to be above the evaluation time of the slowest batch.
+	void SetBatchTimeout(double aTimeoutSec) { myBatchTimeoutSec = std::max(aTimeoutSec, 0.0); }
+
+	// Sets the fitness of the genomes not in the fitness cache, the workers connecting meanwhile take part.
+	// False if all the workers were lost before the end, the genomes not evaluated then keep their fitness.
+	bool EvaluateGenomes(Population& aPopulation);
+
+	// Of the last EvaluateGenomes
+	struct Stats
+	{
+		double myDurationSec = 0.0;
+		size_t myGenomesCount = 0; // Sent to the workers, the fitness cache hits are not
+		size_t myBatchesCount = 0;
+		size_t myResentBatchesCount = 0; // Batches of the lost workers
+		size_t myLostWorkersCount = 0;
+		size_t myTimedOutWorkersCount = 0; // Among the lost ones
+		size_t mySentBytes = 0;
+	};
+	const Stats& GetStats() const { return myStats; }
+
+private:
+	struct Batch;
+	struct Worker;
+	struct Process;
+
+	void AcceptWorker();
+	bool SendBatch(Worker& aWorker, size_t aBatchIdx);
+	bool ReceiveResults(Worker& aWorker, Population& aPopulation, size_t& anOutEvaluatedBatchesCount);
+	void LoseWorker(size_t aWorkerIdx, std::deque<size_t>& someOutPendingBatches);
+	std::chrono::steady_clock::time_point GetBatchDeadline() const; // Of a batch started now
+
+	std::unique_ptr<Socket> myListener;
+	std::uint16_t myPort = 0;
+	std::vector<std::unique_ptr<Worker>> myWorkers;
+	std::vector<std::unique_ptr<Process>> myProcesses;
+
+	size_t myBatchSize = 8;
+	size_t myBatchesInFlight = 2;
+	double myBatchTimeoutSec = 60.0;
+
+	std::vector<Batch> myBatches; // Of the current EvaluateGenomes
+	std::uint64_t myNextBatchId = 0; // Never reused, to match the results with their batch
+
+	Stats myStats;
+};
+
+// Worker process side of a DistributedEvaluator, evaluates the genomes it receives serially: the parallelism comes
+// from the count of worker processes.
+class DistributedWorker
+{
+public:
+	// Returns the fitness of aGenome
+	using EvaluateGenome = std::function<double(Genome& aGenome)>;
+
+	explicit DistributedWorker(EvaluateGenome anEvaluateGenome);
+	~DistributedWorker();
+
+	DistributedWorker(const DistributedWorker&) = delete;
+	DistributedWorker& operator=(const DistributedWorker&) = delete;
+
+	// Retries until aTimeoutSec, the coordinator can still be starting
+	bool Connect(std::uint16_t aPort, double aTimeoutSec = 10.0);
+	// Evaluates the batches until the coordinator disconnects, false if the connection was lost or a message was malformed
+	bool Run();
+
+	size_t GetEvaluatedGenomesCount() const { return myEvaluatedGenomesCount; }
+
+private:
+	EvaluateGenome myEvaluateGenome;
+	std::unique_ptr<Socket> mySocket;
+	size_t myEvaluatedGenomesCount = 0;
+};
+
+}
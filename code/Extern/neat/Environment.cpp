@@ -0,0 +1,54 @@
+#include "Environment.h"
+
+#include "Genome.h"
+
+namespace Neat {
+
+double EpisodeRunner::Run(Genome& aGenome, Environment& anEnvironment, double aRewardCutoff)
+{
+	return RunImpl(aGenome, anEnvironment, 1, aRewardCutoff);
+}
+
+double EpisodeRunner::Run(Genome& aGenome, BatchEnvironment& anEnvironment, double aRewardCutoff)
+{
+	return RunImpl(aGenome, anEnvironment, anEnvironment.GetBatchSize(), aRewardCutoff);
+}
+
+template<typename EnvironmentType>
+double EpisodeRunner::RunImpl(Genome& aGenome, EnvironmentType& anEnvironment, size_t aBatchSize, double aRewardCutoff)
+{
+	// Only grows, so this doesn't allocate after the first episodes
+	myObservations.resize(anEnvironment.GetObservationsCount() * aBatchSize);
+	myActions.resize(anEnvironment.GetActionsCount() * aBatchSize);
+
+	const bool canPrune = aRewardCutoff > -DBL_MAX;
+
+	double reward = 0.0;
+	myStepsCount = 0;
+	myIsPruned = false;
+	anEnvironment.Reset();
+	while (!anEnvironment.IsDone() && !anEnvironment.IsTerminated())
+	{
+		anEnvironment.Observe(myObservations);
+		if (aBatchSize == 1)
+			aGenome.Evaluate(std::span<const double>(myObservations), std::span<double>(myActions));
+		else
+			aGenome.EvaluateBatch(myObservations, myActions, aBatchSize);
+		anEnvironment.Act(myActions);
+		reward += anEnvironment.Step();
+		myStepsCount++;
+
+		if (canPrune)
+		{
+			double rewardBound = reward + anEnvironment.GetRewardBound();
+			if (rewardBound < aRewardCutoff)
+			{
+				myIsPruned = true;
+				return rewardBound;
+			}
+		}
+	}
+	return reward;
+}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cfloat>
+#include <span>
+#include <vector>
+
+namespace Neat {
+
+class Genome;
+
+// Control task a genome is evaluated on, one episode at a time.
+// Observations and actions go through spans owned by the caller, so stepping an episode doesn't allocate.
+class Environment
+{
+public:
+	virtual ~Environment() {}
+
+	virtual size_t GetObservationsCount() const = 0; // Inputs of the genome
+	virtual size_t GetActionsCount() const = 0; // Outputs of the genome
+
+	virtual void Reset() = 0; // Back to the initial state, environments are reused for every episode
+	virtual void Observe(std::span<double> someOutObservations) const = 0;
+	virtual void Act(std::span<const double> someActions) = 0;
+	virtual double Step() = 0; // Advances the simulation with the last actions, returns the reward of the step
+	virtual bool IsDone() const = 0; // The episode reached its horizon
+
+	// Early termination, the episode can't collect any reward anymore (e.g. a balancing task whose pole fell)
+	virtual bool IsTerminated() const { return false; }
+	// Upper bound of the reward the remaining steps can still collect, used to prune the hopeless evaluations
+	virtual double GetRewardBound() const { return DBL_MAX; }
+};
+
+// Several instances of a control task stepped in lockstep, so a genome evaluates all of them in one batch.
+// Observations and actions use a SoA layout: someOutObservations[i * GetBatchSize() + s] is the observation i
+// of the instance s, same for the actions. All the instances have the same episode length.
+class BatchEnvironment
+{
+public:
+	virtual ~BatchEnvironment() {}
+
+	virtual size_t GetBatchSize() const = 0;
+	virtual size_t GetObservationsCount() const = 0; // Per instance
+	virtual size_t GetActionsCount() const = 0; // Per instance
+
+	virtual void Reset() = 0;
+	virtual void Observe(std::span<double> someOutObservations) const = 0;
+	virtual void Act(std::span<const double> someActions) = 0;
+	virtual double Step() = 0; // Returns the sum of the rewards of the instances
+	virtual bool IsDone() const = 0;
+
+	// All the instances terminated early, the terminated instances don't collect rewards anymore
+	virtual bool IsTerminated() const { return false; }
+	// Upper bound of the sum of the rewards the remaining steps can still collect
+	virtual double GetRewardBound() const { return DBL_MAX; }
+};
+
+// Runs episodes with observations and actions buffers that are only allocated once, use one runner per worker.
+// The episodes stop early when the environment terminates, or when the reward can't reach aRewardCutoff anymore:
+// the episode is then pruned and Run returns the upper bound of its reward, which is below aRewardCutoff.
+class EpisodeRunner
+{
+public:
+	// Returns the sum of the rewards of the episode
+	double Run(Genome& aGenome, Environment& anEnvironment, double aRewardCutoff = -DBL_MAX);
+	// Returns the sum of the rewards of the episodes of all the instances
+	double Run(Genome& aGenome, BatchEnvironment& anEnvironment, double aRewardCutoff = -DBL_MAX);
+
+	size_t GetStepsCount() const { return myStepsCount; } // Of the last episode
+	bool IsPruned() const { return myIsPruned; } // The last episode was stopped by aRewardCutoff
+
+private:
+	template<typename EnvironmentType>
+	double RunImpl(Genome& aGenome, EnvironmentType& anEnvironment, size_t aBatchSize, double aRewardCutoff);
+
+	std::vector<double> myObservations;
+	std::vector<double> myActions;
+	size_t myStepsCount = 0;
+	bool myIsPruned = false;
+};
+
+}
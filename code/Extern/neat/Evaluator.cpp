@@ -0,0 +1,240 @@
+#include "Evaluator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+namespace Neat {
+
+namespace {
+
+// Rounds up, but not the rounding errors of a ratio such as 1 / 3
+size_t CeilCount(double aCount)
+{
+	return static_cast<size_t>(std::ceil(aCount - 1e-6));
+}
+
+}
+
+Evaluator::Evaluator(size_t aWorkersCount, EvaluateGenome anEvaluateGenome)
+	: myWorkersCount(std::max<size_t>(aWorkersCount, 1))
+	, myEvaluateGenome(std::move(anEvaluateGenome))
+{
+	myStats.myWorkersBusySec.resize(myWorkersCount);
+	myStats.myWorkersGenomesCount.resize(myWorkersCount);
+}
+
+void Evaluator::EnablePruning(double aPercentile, size_t aMinEvaluationsCount)
+{
+	myPruningPercentile = std::clamp(aPercentile, 0.0, 1.0);
+	myPruningMinEvaluationsCount = std::max<size_t>(aMinEvaluationsCount, 1);
+}
+
+void Evaluator::EnableRacing(EvaluateScenarios anEvaluateScenarios, size_t aScenariosCount, size_t aFirstRungScenariosCount, double aPromotedRatio)
+{
+	myEvaluateScenarios = std::move(anEvaluateScenarios);
+	myScenariosCount = std::max<size_t>(aScenariosCount, 1);
+	myPromotedRatio = std::clamp(aPromotedRatio, 0.01, 1.0);
+
+	// The scenarios of a rung grow as fast as the count of genomes shrinks, so that each rung costs about the same
+	myRungsEndScenarioIdx.clear();
+	size_t endScenarioIdx = std::clamp<size_t>(aFirstRungScenariosCount, 1, myScenariosCount);
+	while (endScenarioIdx < myScenariosCount && myPromotedRatio < 1.0)
+	{
+		myRungsEndScenarioIdx.push_back(endScenarioIdx);
+		endScenarioIdx = std::max(endScenarioIdx + 1, CeilCount(endScenarioIdx / myPromotedRatio));
+	}
+	myRungsEndScenarioIdx.push_back(myScenariosCount);
+}
+
+void Evaluator::EvaluateGenomes(Population& aPopulation, const Population::ParallelFor& aParallelFor)
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::fill(myStats.myWorkersBusySec.begin(), myStats.myWorkersBusySec.end(), 0.0);
+	std::fill(myStats.myWorkersGenomesCount.begin(), myStats.myWorkersGenomesCount.end(), 0);
+	myStats.myPrunedCount = 0;
+	myStats.myScenariosEvaluationsCount = 0;
+	myStats.myFullScenariosEvaluationsCount = 0;
+
+	Clock::time_point start = Clock::now();
+	if (IsRacingEnabled())
+	{
+		EvaluateRungs(aPopulation, aParallelFor);
+	}
+	else
+	{
+		myFitnesses.clear();
+		myFitnessCutoff = -DBL_MAX;
+		std::atomic<size_t> prunedCount = 0;
+
+		// The genomes with a cached fitness are skipped, but still count as full evaluations for the pruning
+		myEvaluatedGenomes.clear();
+		for (size_t genomeIdx = 0; genomeIdx < aPopulation.GetSize(); ++genomeIdx)
+		{
+			if (!aPopulation.IsFitnessCached(genomeIdx))
+				myEvaluatedGenomes.push_back(genomeIdx);
+			else if (IsPruningEnabled())
+				AddFullEvaluation(aPopulation.GetGenome(genomeIdx)->GetFitness());
+		}
+
+		RunWorkers(myEvaluatedGenomes.size(), aParallelFor, [this, &aPopulation, &prunedCount](size_t anIdx, size_t aWorkerIdx) {
+			size_t genomeIdx = myEvaluatedGenomes[anIdx];
+			Genome* genome = aPopulation.GetGenome(genomeIdx);
+			bool isPruned = false;
+			double fitness = myEvaluateGenome(*genome, aWorkerIdx, myFitnessCutoff.load(std::memory_order_relaxed), isPruned);
+			genome->SetFitness(fitness);
+			if (isPruned)
+			{
+				prunedCount++;
+				aPopulation.ExcludeFromFitnessCache(genomeIdx);
+			}
+			else if (IsPruningEnabled())
+			{
+				AddFullEvaluation(fitness);
+			}
+		});
+		myStats.myPrunedCount = prunedCount;
+	}
+	myStats.myDurationSec = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void Evaluator::RunWorkers(size_t aCount, const Population::ParallelFor& aParallelFor, const std::function<void(size_t, size_t)>& aJob)
+{
+	using Clock = std::chrono::steady_clock;
+
+	// A single genome per pick: an evaluation lasts much longer than the atomic increment,
+	// and larger chunks would bring back the imbalance of the static split
+	std::atomic<size_t> nextIdx = 0;
+	auto runWorker = [this, &nextIdx, &aJob, aCount](size_t aWorkerIdx) {
+		double busySec = 0.0;
+		size_t evaluatedCount = 0;
+		for (size_t idx = nextIdx++; idx < aCount; idx = nextIdx++)
+		{
+			Clock::time_point start = Clock::now();
+			aJob(idx, aWorkerIdx);
+			busySec += std::chrono::duration<double>(Clock::now() - start).count();
+			evaluatedCount++;
+		}
+		myStats.myWorkersBusySec[aWorkerIdx] += busySec;
+		myStats.myWorkersGenomesCount[aWorkerIdx] += evaluatedCount;
+	};
+
+	if (aParallelFor)
+	{
+		aParallelFor(myWorkersCount, runWorker);
+	}
+	else
+	{
+		runWorker(0);
+	}
+}
+
+void Evaluator::EvaluateRungs(Population& aPopulation, const Population::ParallelFor& aParallelFor)
+{
+	// The fitnesses depend on the other genomes, none of them can be cached
+	const size_t genomesCount = aPopulation.GetSize();
+	for (size_t genomeIdx = 0; genomeIdx < genomesCount; ++genomeIdx)
+		aPopulation.ExcludeFromFitnessCache(genomeIdx);
+
+	myScoreSums.assign(genomesCount, 0.0);
+	myRacingGenomes.resize(genomesCount);
+	std::iota(myRacingGenomes.begin(), myRacingGenomes.end(), 0);
+	myRungsEliminatedGenomes.resize(myRungsEndScenarioIdx.size());
+	for (std::vector<size_t>& eliminatedGenomes : myRungsEliminatedGenomes)
+		eliminatedGenomes.clear();
+
+	size_t firstScenarioIdx = 0;
+	for (size_t rungIdx = 0; rungIdx < myRungsEndScenarioIdx.size(); ++rungIdx)
+	{
+		const size_t endScenarioIdx = myRungsEndScenarioIdx[rungIdx];
+		const size_t scenariosCount = endScenarioIdx - firstScenarioIdx;
+		RunWorkers(myRacingGenomes.size(), aParallelFor, [this, &aPopulation, firstScenarioIdx, scenariosCount](size_t anIdx, size_t aWorkerIdx) {
+			size_t genomeIdx = myRacingGenomes[anIdx];
+			myScoreSums[genomeIdx] += myEvaluateScenarios(*aPopulation.GetGenome(genomeIdx), aWorkerIdx, firstScenarioIdx, scenariosCount);
+		});
+		myStats.myScenariosEvaluationsCount += myRacingGenomes.size() * scenariosCount;
+
+		for (size_t genomeIdx : myRacingGenomes)
+			aPopulation.GetGenome(genomeIdx)->SetFitness(myScoreSums[genomeIdx] / endScenarioIdx);
+
+		if (rungIdx + 1 == myRungsEndScenarioIdx.size())
+			break;
+
+		// Ties are broken by index, so the promotion doesn't depend on the workers
+		std::sort(myRacingGenomes.begin(), myRacingGenomes.end(), [this](size_t aGenomeIdx, size_t anOtherGenomeIdx) {
+			if (myScoreSums[aGenomeIdx] != myScoreSums[anOtherGenomeIdx])
+				return myScoreSums[aGenomeIdx] > myScoreSums[anOtherGenomeIdx];
+			return aGenomeIdx < anOtherGenomeIdx;
+		});
+		size_t promotedCount = std::max<size_t>(1, CeilCount(myRacingGenomes.size() * myPromotedRatio));
+		promotedCount = std::min(promotedCount, myRacingGenomes.size());
+		myRungsEliminatedGenomes[rungIdx].assign(myRacingGenomes.begin() + promotedCount, myRacingGenomes.end());
+		myRacingGenomes.resize(promotedCount);
+		firstScenarioIdx = endScenarioIdx;
+	}
+
+	// A genome eliminated early can have a better average on its few scenarios than a promoted one on all of them,
+	// cap it so that the promoted genomes stay the best, from the last rung to the first one
+	double minPromotedFitness = DBL_MAX;
+	for (size_t genomeIdx : myRacingGenomes)
+		minPromotedFitness = std::min(minPromotedFitness, aPopulation.GetGenome(genomeIdx)->GetFitness());
+	for (size_t rungIdx = myRungsEliminatedGenomes.size(); rungIdx-- > 0;)
+	{
+		for (size_t genomeIdx : myRungsEliminatedGenomes[rungIdx])
+		{
+			Genome* genome = aPopulation.GetGenome(genomeIdx);
+			genome->SetFitness(std::min(genome->GetFitness(), minPromotedFitness));
+		}
+		for (size_t genomeIdx : myRungsEliminatedGenomes[rungIdx])
+			minPromotedFitness = std::min(minPromotedFitness, aPopulation.GetGenome(genomeIdx)->GetFitness());
+	}
+
+	myStats.myFullScenariosEvaluationsCount = genomesCount * myScenariosCount;
+}
+
+void Evaluator::AddFullEvaluation(double aFitness)
+{
+	std::lock_guard<std::mutex> lock(myFitnessesMutex);
+	myFitnesses.push_back(aFitness);
+	if (myFitnesses.size() < myPruningMinEvaluationsCount)
+		return;
+
+	// Linear in the count of evaluations, negligible next to an evaluation
+	mySortedFitnesses = myFitnesses;
+	auto percentileIt = mySortedFitnesses.begin() + static_cast<size_t>(myPruningPercentile * (mySortedFitnesses.size() - 1));
+	std::nth_element(mySortedFitnesses.begin(), percentileIt, mySortedFitnesses.end());
+	myFitnessCutoff.store(*percentileIt, std::memory_order_relaxed);
+}
+
+double Evaluator::Stats::GetUtilization() const
+{
+	if (myDurationSec <= 0.0 || myWorkersBusySec.empty())
+		return 0.0;
+
+	double busySec = 0.0;
+	for (double workerBusySec : myWorkersBusySec)
+		busySec += workerBusySec;
+	return busySec / (myDurationSec * myWorkersBusySec.size());
+}
+
+double Evaluator::Stats::GetMaxIdleSec() const
+{
+	if (myWorkersBusySec.empty())
+		return 0.0;
+
+	return std::max(0.0, myDurationSec - *std::min_element(myWorkersBusySec.begin(), myWorkersBusySec.end()));
+}
+
+double Evaluator::Stats::GetSavedEvaluationsRatio() const
+{
+	if (myFullScenariosEvaluationsCount == 0)
+		return 0.0;
+
+	return 1.0 - static_cast<double>(myScenariosEvaluationsCount) / myFullScenariosEvaluationsCount;
+}
+
+}
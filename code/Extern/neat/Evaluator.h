@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Population.h"
+
+#include <atomic>
+#include <cfloat>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace Neat {
+
+// Evaluates the fitness of all the genomes of a population over several workers.
+// The workers pick the genomes one by one as soon as they are free, so that a long evaluation doesn't hold back the others,
+// and each worker has an index to reuse its own environments and buffers, created once by the caller.
+// The genomes whose fitness is in the population cache are not evaluated again, see Population::EnableFitnessCache.
+class Evaluator
+{
+public:
+	// Returns the fitness of aGenome, the state of aWorkerIdx is not used by any other evaluation at the same time.
+	// The evaluation can stop as soon as the fitness can't reach aFitnessCutoff anymore, it then returns an upper bound
+	// of the fitness below the cutoff and sets anOutIsPruned. aFitnessCutoff is -DBL_MAX when nothing can be pruned.
+	using EvaluateGenome = std::function<double(Genome& aGenome, size_t aWorkerIdx, double aFitnessCutoff, bool& anOutIsPruned)>;
+	// Returns the sum of the scores of aGenome on the scenarios [aFirstScenarioIdx, aFirstScenarioIdx + aScenariosCount).
+	// A scenario must give the same score to the same genome whatever the other scenarios evaluated before it.
+	using EvaluateScenarios = std::function<double(Genome& aGenome, size_t aWorkerIdx, size_t aFirstScenarioIdx, size_t aScenariosCount)>;
+
+	Evaluator(size_t aWorkersCount, EvaluateGenome anEvaluateGenome);
+
+	size_t GetWorkersCount() const { return myWorkersCount; }
+
+	// Upper bound pruning: once aMinEvaluationsCount genomes are fully evaluated in a generation, the evaluations
+	// that can't reach the aPercentile (in [0, 1]) of their fitnesses are stopped.
+	// Faster, but not deterministic: the cutoff depends on the order the workers finish their evaluations.
+	void EnablePruning(double aPercentile, size_t aMinEvaluationsCount = 32);
+	void DisablePruning() { myPruningPercentile = -1.0; }
+	bool IsPruningEnabled() const { return myPruningPercentile >= 0.0; }
+
+	// Racing (successive halving) over aScenariosCount scenarios, used instead of anEvaluateGenome and the pruning.
+	// All the genomes are scored on the first aFirstRungScenariosCount scenarios, then only the best aPromotedRatio of them
+	// are scored on the next scenarios up to aFirstRungScenariosCount / aPromotedRatio, and so on until the best are
+	// scored on all the scenarios. The scenarios are the same for all the genomes, so their scores can be compared.
+	// The fitness is the average score on the scenarios evaluated, capped below the fitnesses of the genomes that were promoted.
+	// Deterministic: the ranking doesn't depend on the order the workers finish their evaluations.
+	void EnableRacing(EvaluateScenarios anEvaluateScenarios, size_t aScenariosCount, size_t aFirstRungScenariosCount, double aPromotedRatio);
+	void DisableRacing() { myRungsEndScenarioIdx.clear(); }
+	bool IsRacingEnabled() const { return !myRungsEndScenarioIdx.empty(); }
+	// End of the scenarios of each rung, the rung i evaluates the scenarios [GetRungs()[i - 1], GetRungs()[i])
+	const std::vector<size_t>& GetRungs() const { return myRungsEndScenarioIdx; }
+
+	// Runs serially when aParallelFor is not set
+	void EvaluateGenomes(Population& aPopulation, const Population::ParallelFor& aParallelFor);
+
+	// Of the last EvaluateGenomes
+	struct Stats
+	{
+		double myDurationSec = 0.0;
+		std::vector<double> myWorkersBusySec;
+		std::vector<size_t> myWorkersGenomesCount;
+		size_t myPrunedCount = 0;
+		// When racing, count of the evaluated genome and scenario pairs, and of the pairs without racing
+		size_t myScenariosEvaluationsCount = 0;
+		size_t myFullScenariosEvaluationsCount = 0;
+
+		double GetUtilization() const; // Ratio of the workers time spent evaluating, 1 when no worker waits for the others
+		double GetMaxIdleSec() const; // Time the least busy worker waited for the others
+		double GetSavedEvaluationsRatio() const; // Ratio of the scenario evaluations skipped by the racing
+	};
+	const Stats& GetStats() const { return myStats; }
+
+private:
+	// Runs aJob(anIdx, aWorkerIdx) for all the indices in [0, aCount), adds the workers time to the stats
+	void RunWorkers(size_t aCount, const Population::ParallelFor& aParallelFor, const std::function<void(size_t, size_t)>& aJob);
+	void EvaluateRungs(Population& aPopulation, const Population::ParallelFor& aParallelFor);
+	void AddFullEvaluation(double aFitness);
+
+	size_t myWorkersCount = 1;
+	EvaluateGenome myEvaluateGenome;
+	Stats myStats;
+
+	double myPruningPercentile = -1.0;
+	size_t myPruningMinEvaluationsCount = 32;
+	// Fitnesses of the full evaluations of the current generation, and their percentile
+	std::mutex myFitnessesMutex;
+	std::vector<double> myFitnesses;
+	std::vector<double> mySortedFitnesses;
+	std::atomic<double> myFitnessCutoff = -DBL_MAX;
+	std::vector<size_t> myEvaluatedGenomes; // Not in the fitness cache
+
+	EvaluateScenarios myEvaluateScenarios;
+	size_t myScenariosCount = 0;
+	double myPromotedRatio = 1.0;
+	std::vector<size_t> myRungsEndScenarioIdx;
+	// Indexed by genome, reused between the generations
+	std::vector<double> myScoreSums;
+	std::vector<size_t> myRacingGenomes; // Still racing in the current rung
+	std::vector<std::vector<size_t>> myRungsEliminatedGenomes;
+};
+
+}
@@ -1,8 +1,9 @@
 #include "EvolutionParams.h"
 
+#include "Checkpoint.h"
+
 namespace Neat {
 
-std::default_random_engine EvolutionParams::ourRandomGenerator(0);
 std::atomic_uint64_t EvolutionParams::ourNextInnovationId = 0;
 
 void EvolutionParams::SetNextInnovationNumber(std::uint64_t aNextId)
@@ -10,9 +11,106 @@ void EvolutionParams::SetNextInnovationNumber(std::uint64_t aNextId)
 	ourNextInnovationId.store(aNextId);
 }
 
-std::uint64_t EvolutionParams::GetInnovationNumber()
+std::uint64_t EvolutionParams::ReserveInnovationNumbers(std::uint64_t aCount)
+{
+	return ourNextInnovationId.fetch_add(aCount);
+}
+
+bool EvolutionParams::IsValidPhenotypeBackend(Phenotype::Precision aPrecision, Phenotype::Activation anActivation)
+{
+	return (aPrecision == Phenotype::Precision::Double || aPrecision == Phenotype::Precision::Float)
+		&& (anActivation == Phenotype::Activation::Exact || anActivation == Phenotype::Activation::Rational || anActivation == Phenotype::Activation::Table);
+}
+
+void EvolutionParams::WriteCheckpoint(CheckpointWriter& aWriter, std::uint64_t aNextInnovationId) const
 {
-	return ourNextInnovationId.fetch_add(1);
+	aWriter.Write(myRandomSeed);
+	aWriter.Write(aNextInnovationId);
+	aWriter.Write(myMutationInnovationIdsEnd);
+
+	aWriter.Write(myLinkWeightMutationProba);
+	aWriter.Write(myLinkWeightTotalMutationProba);
+	aWriter.Write(myLinkWeightPartialMutationPower);
+	aWriter.Write(myLinkWeightBound);
+
+	aWriter.Write(myNewLinkProba);
+	aWriter.Write(myNewNodeProba);
+
+	aWriter.Write(mySingleParentReproductionProba);
+	aWriter.Write(myAmountGenomesToKeep);
+
+	aWriter.Write(mySpecieThreshold);
+	aWriter.Write(myMatchingGeneCoeff);
+	aWriter.Write(myNonMatchingGeneCoeff);
+	aWriter.Write(myNormalizeSpecieDistance);
+	aWriter.Write<std::uint64_t>(myNormalizeSpecieDistanceMinGenes);
+
+	aWriter.Write(myPopulationStagnantThreshold);
+	aWriter.Write(mySpecieStagnantThreshold);
+	aWriter.Write(mySpecieNewThreshold);
+	aWriter.Write(mySpecieOldThreshold);
+	aWriter.Write(mySpecieStagnantPenality);
+	aWriter.Write(mySpecieNewBonus);
+	aWriter.Write<std::uint64_t>(mySteadyStateRespeciationInterval);
+
+	aWriter.Write(ourPhenotypePrecision);
+	aWriter.Write(ourPhenotypeActivation);
+}
+
+bool EvolutionParams::ReadCheckpoint(CheckpointReader& aReader, std::uint64_t& anOutNextInnovationId)
+{
+	std::uint64_t nextInnovationId = 0;
+	std::uint64_t normalizeSpecieDistanceMinGenes = 0;
+	std::uint64_t steadyStateRespeciationInterval = 0;
+	Phenotype::Precision phenotypePrecision = Phenotype::Precision::Double;
+	Phenotype::Activation phenotypeActivation = Phenotype::Activation::Exact;
+
+	// Nothing is changed until the whole params are read and checked
+	EvolutionParams params = *this;
+
+	aReader.Read(params.myRandomSeed);
+	aReader.Read(nextInnovationId);
+	aReader.Read(params.myMutationInnovationIdsEnd);
+
+	aReader.Read(params.myLinkWeightMutationProba);
+	aReader.Read(params.myLinkWeightTotalMutationProba);
+	aReader.Read(params.myLinkWeightPartialMutationPower);
+	aReader.Read(params.myLinkWeightBound);
+
+	aReader.Read(params.myNewLinkProba);
+	aReader.Read(params.myNewNodeProba);
+
+	aReader.Read(params.mySingleParentReproductionProba);
+	aReader.Read(params.myAmountGenomesToKeep);
+
+	aReader.Read(params.mySpecieThreshold);
+	aReader.Read(params.myMatchingGeneCoeff);
+	aReader.Read(params.myNonMatchingGeneCoeff);
+	aReader.Read(params.myNormalizeSpecieDistance);
+	aReader.Read(normalizeSpecieDistanceMinGenes);
+
+	aReader.Read(params.myPopulationStagnantThreshold);
+	aReader.Read(params.mySpecieStagnantThreshold);
+	aReader.Read(params.mySpecieNewThreshold);
+	aReader.Read(params.mySpecieOldThreshold);
+	aReader.Read(params.mySpecieStagnantPenality);
+	aReader.Read(params.mySpecieNewBonus);
+	aReader.Read(steadyStateRespeciationInterval);
+
+	aReader.Read(phenotypePrecision);
+	aReader.Read(phenotypeActivation);
+
+	if (!aReader.IsValid() || !IsValidPhenotypeBackend(phenotypePrecision, phenotypeActivation))
+		return false;
+
+	params.myNormalizeSpecieDistanceMinGenes = static_cast<size_t>(normalizeSpecieDistanceMinGenes);
+	params.mySteadyStateRespeciationInterval = static_cast<size_t>(steadyStateRespeciationInterval);
+
+	*this = params;
+	anOutNextInnovationId = nextInnovationId;
+	ourPhenotypePrecision = phenotypePrecision;
+	ourPhenotypeActivation = phenotypeActivation;
+	return true;
 }
 
 }
@@ -1,17 +1,34 @@
 #pragma once
 
+#include "Link.h"
+#include "Phenotype.h"
+
+#include <atomic>
 #include <random>
 
 namespace Neat {
 
+class CheckpointReader;
+class CheckpointWriter;
+
+// The static ourX are the process wide defaults, each population copies them into its own myX at construction,
+// so that several configurations can be trained in the same process
 class EvolutionParams
 {
 public:
-	static void SetRandomSeed(unsigned int aSeed) { ourRandomGenerator = std::default_random_engine(aSeed); }
-	static std::default_random_engine& GetRandomGenerator() { return ourRandomGenerator; }
+	// Seed of the populations created afterwards, each population then splits its own random streams
+	static void SetRandomSeed(std::uint64_t aSeed) { ourRandomSeed = aSeed; }
+	static std::uint64_t GetRandomSeed() { return ourRandomSeed; }
 
+	// Counter of the genomes loaded from a file, the populations have their own counter
 	static void SetNextInnovationNumber(std::uint64_t aNextId);
-	static std::uint64_t GetInnovationNumber();
+	static std::uint64_t GetNextInnovationNumber() { return ourNextInnovationId.load(); }
+	static std::uint64_t ReserveInnovationNumbers(std::uint64_t aCount); // Returns the first reserved number
+
+	// Innovation numbers reserved for each Genome::Mutate, MutateAddNode creates up to 3 links and MutateAddLink 1
+	static constexpr std::uint64_t ourMutationInnovationsCount = 4;
+	// Given to Genome::Mutate instead of reserved numbers, the mutation then only changes the weights
+	static constexpr std::uint64_t ourNoMutationInnovationId = UINT64_MAX;
 
 	static inline double ourLinkWeightMutationProba = 0.8;
 	static inline double ourLinkWeightTotalMutationProba = 0.1;
@@ -27,6 +44,8 @@ public:
 	static inline double ourSpecieThreshold = 3.0;
 	static inline double ourMatchingGeneCoeff = 0.4;
 	static inline double ourNonMatchingGeneCoeff = 1.0;
+	static inline bool ourNormalizeSpecieDistance = false; // Divides the non matching genes count by the genes count
+	static inline size_t ourNormalizeSpecieDistanceMinGenes = 20;
 
 	static inline int ourPopulationStagnantThreshold = 20;
 	static inline int ourSpecieStagnantThreshold = 15;
@@ -35,8 +54,60 @@ public:
 	static inline double ourSpecieStagnantPenality = 0.01;
 	static inline double ourSpecieNewBonus = 1.0;
 
+	static inline size_t ourSteadyStateRespeciationInterval = 100; // Replacements between two respeciations, see Population::TrainSteadyState
+
+	// Backend of the evaluations rather than a param of the evolution, so it stays process wide: the genomes compile
+	// their phenotype without knowing their population, and the workers of a DistributedEvaluator receive it with each
+	// batch. Reading a checkpoint sets it for all the populations of the process.
+	static inline Phenotype::Precision ourPhenotypePrecision = Phenotype::Precision::Double;
+	static inline Phenotype::Activation ourPhenotypeActivation = Phenotype::Activation::Exact;
+
+	// Per population params, see the defaults above
+	std::uint64_t myRandomSeed = ourRandomSeed;
+
+	double myLinkWeightMutationProba = ourLinkWeightMutationProba;
+	double myLinkWeightTotalMutationProba = ourLinkWeightTotalMutationProba;
+	double myLinkWeightPartialMutationPower = ourLinkWeightPartialMutationPower;
+	double myLinkWeightBound = ourLinkWeightBound;
+
+	double myNewLinkProba = ourNewLinkProba;
+	double myNewNodeProba = ourNewNodeProba;
+
+	double mySingleParentReproductionProba = ourSingleParentReproductionProba;
+	double myAmountGenomesToKeep = ourAmountGenomesToKeep;
+
+	double mySpecieThreshold = ourSpecieThreshold;
+	double myMatchingGeneCoeff = ourMatchingGeneCoeff;
+	double myNonMatchingGeneCoeff = ourNonMatchingGeneCoeff;
+	bool myNormalizeSpecieDistance = ourNormalizeSpecieDistance;
+	size_t myNormalizeSpecieDistanceMinGenes = ourNormalizeSpecieDistanceMinGenes;
+
+	int myPopulationStagnantThreshold = ourPopulationStagnantThreshold;
+	int mySpecieStagnantThreshold = ourSpecieStagnantThreshold;
+	int mySpecieNewThreshold = ourSpecieNewThreshold;
+	int mySpecieOldThreshold = ourSpecieOldThreshold;
+	double mySpecieStagnantPenality = ourSpecieStagnantPenality;
+	double mySpecieNewBonus = ourSpecieNewBonus;
+
+	size_t mySteadyStateRespeciationInterval = ourSteadyStateRespeciationInterval;
+
+	// The mutations of the population number their innovations from there, after the links of its initial genomes.
+	// Populations exchanging genomes need disjoint ranges, see IslandModel. Only used at the creation of the population.
+	std::uint64_t myFirstMutationInnovationId = 0;
+	// End of the range, excluded. The links store 32 bits ids, so once the range is used up the mutations don't add links
+	// nor nodes anymore, only the weights keep evolving.
+	std::uint64_t myMutationInnovationIdsEnd = Link::ourMaxInnovationId + 1;
+
+	// All the params, the seed and the innovation counter of the population, for the population checkpoints.
+	// Reading also restores the process wide phenotype backend.
+	void WriteCheckpoint(CheckpointWriter& aWriter, std::uint64_t aNextInnovationId) const;
+	bool ReadCheckpoint(CheckpointReader& aReader, std::uint64_t& anOutNextInnovationId);
+
+	// False for the values out of the enums, as read from a corrupted checkpoint or message
+	static bool IsValidPhenotypeBackend(Phenotype::Precision aPrecision, Phenotype::Activation anActivation);
+
 private:
-	static std::default_random_engine ourRandomGenerator;
+	static inline std::uint64_t ourRandomSeed = 0;
 	static std::atomic_uint64_t ourNextInnovationId;
 };
 
@@ -1,8 +1,11 @@
 #include "Genome.h"
 
+#include "Checkpoint.h"
 #include "EvolutionParams.h"
+#include "InnovationTable.h"
 #include "Specie.h"
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -35,26 +38,36 @@ namespace
 	}
 }
 
-Genome::Genome(size_t anInputCount, size_t anOutputCount)
+Genome::Genome(size_t anInputCount, size_t anOutputCount, Random& aRandom, const EvolutionParams& someParams, std::uint64_t aFirstInnovationId)
 	: myInputCount(anInputCount)
 	, myOutputCount(anOutputCount)
 {
-	std::uniform_real_distribution<> rand(-EvolutionParams::ourLinkWeightBound, EvolutionParams::ourLinkWeightBound);
+	std::uniform_real_distribution<> rand(-someParams.myLinkWeightBound, someParams.myLinkWeightBound);
 
+	// Bias, Inputs and Outputs are keyed by their index, which is the same in all genomes
 	myNodes.reserve(1 + myInputCount + myOutputCount); // +1 for Bias
-	myNodes.push_back(Node::Type::Bias);
+	myNodes.push_back(Node(Node::Type::Bias, 0));
 
 	for (size_t i = 0; i < myInputCount; ++i)
-		myNodes.push_back(Node::Type::Input);
+		myNodes.push_back(Node(Node::Type::Input, myNodes.size()));
 
+	std::uint64_t nextInnovationId = aFirstInnovationId;
 	for (size_t i = 0; i < myOutputCount; ++i)
 	{
-		myNodes.push_back(Node::Type::Output);
+		myNodes.push_back(Node(Node::Type::Output, myNodes.size()));
 
 		size_t nodeIdx = 1 + myInputCount + i;
-		LinkNodes(0, nodeIdx, rand(EvolutionParams::GetRandomGenerator()), true);
+		LinkNodes(0, nodeIdx, rand(aRandom), true, nextInnovationId);
 		for (size_t j = 0; j < myInputCount; ++j)
-			LinkNodes(1 + j, nodeIdx, rand(EvolutionParams::GetRandomGenerator()), true);
+			LinkNodes(1 + j, nodeIdx, rand(aRandom), true, nextInnovationId);
+	}
+
+	myExecutionOrder.resize(myNodes.size());
+	myExecutionRanks.resize(myNodes.size());
+	for (size_t i = 0; i < myNodes.size(); ++i)
+	{
+		myExecutionOrder[i] = static_cast<std::uint32_t>(i);
+		myExecutionRanks[i] = static_cast<std::uint32_t>(i);
 	}
 }
 
@@ -82,16 +95,34 @@ Genome::Genome(const char* aFilePath)
 		myOutputCount = std::stoi(lines[2]);
 
 		myNodes.reserve(1 + myInputCount + hiddenCount + myOutputCount); // +1 for Bias
-		myNodes.push_back(Node::Type::Bias);
+		myNodes.push_back(Node(Node::Type::Bias, 0));
 
 		for (size_t i = 0; i < myInputCount; ++i)
-			myNodes.push_back(Node::Type::Input);
-
-		for (size_t i = 0; i < hiddenCount; ++i)
-			myNodes.push_back(Node::Type::Hidden);
+			myNodes.push_back(Node(Node::Type::Input, myNodes.size()));
 
 		for (size_t i = 0; i < myOutputCount; ++i)
-			myNodes.push_back(Node::Type::Output);
+			myNodes.push_back(Node(Node::Type::Output, myNodes.size()));
+
+		for (size_t i = 0; i < hiddenCount; ++i)
+			myNodes.push_back(Node(Node::Type::Hidden, 0)); // Keyed once all the innovation numbers are known
+
+		// The file refers to the nodes by execution order: Bias, Inputs, Hidden nodes, then Outputs
+		auto getNodeIdx = [this, hiddenCount](size_t aRank) -> size_t {
+			if (aRank < 1 + myInputCount)
+				return aRank;
+			if (aRank < 1 + myInputCount + hiddenCount)
+				return aRank + myOutputCount;
+			return aRank - hiddenCount;
+		};
+
+		myExecutionOrder.resize(myNodes.size());
+		myExecutionRanks.resize(myNodes.size());
+		for (size_t rank = 0; rank < myNodes.size(); ++rank)
+		{
+			size_t nodeIdx = getNodeIdx(rank);
+			myExecutionOrder[rank] = static_cast<std::uint32_t>(nodeIdx);
+			myExecutionRanks[nodeIdx] = static_cast<std::uint32_t>(rank);
+		}
 
 		for (size_t i = 3; i < lines.size(); ++i)
 		{
@@ -109,9 +140,19 @@ Genome::Genome(const char* aFilePath)
 				continue;
 
 			std::uint64_t innovationId = std::stoull(tokens[0]);
-			LinkNodes(innovationId, std::stoull(tokens[1]), std::stoull(tokens[2]), std::stod(tokens[3]), std::stoi(tokens[4]));
+			size_t srcRank = std::stoull(tokens[1]);
+			size_t dstRank = std::stoull(tokens[2]);
+			if (srcRank >= myNodes.size() || dstRank >= myNodes.size())
+				continue;
+
+			LinkNodes(innovationId, getNodeIdx(srcRank), getNodeIdx(dstRank), std::stod(tokens[3]), std::stoi(tokens[4]));
 			EvolutionParams::SetNextInnovationNumber(innovationId + 1);
 		}
+
+		// The links split by the hidden nodes are not saved, so give them fresh keys
+		std::uint64_t firstHiddenKey = EvolutionParams::ReserveInnovationNumbers(hiddenCount);
+		for (size_t i = 0; i < hiddenCount; ++i)
+			myNodes[1 + myInputCount + myOutputCount + i].SetKey(Node::ourHiddenNodeKeyFlag | (firstHiddenKey + i));
 	}
 }
 
@@ -123,15 +164,100 @@ void Genome::SaveToFile(const char* aFilePath) const
 
 	file << myInputCount << ";" << GetHiddenNodesCount() << ";" << myOutputCount << ";" << std::endl;
 
-	for (auto it = myLinks.begin(); it != myLinks.end(); ++it)
+	for (const Link& link : myLinks)
 	{
-		const Link& link = it->second;
-		file << it->first << " " << link.GetSrcNodeIdx() << " " << link.GetDstNodeIdx() << " "
+		file << link.GetInnovationId() << " " << myExecutionRanks[link.GetSrcNodeIdx()] << " " << myExecutionRanks[link.GetDstNodeIdx()] << " "
 			<< link.GetWeight() << " " << link.IsEnabled() << ";" << std::endl;
 	}
 }
 
-Genome::Genome(const Genome* aParent1, const Genome* aParent2)
+void Genome::WriteCheckpoint(CheckpointWriter& aWriter) const
+{
+	aWriter.Write<std::uint64_t>(myInputCount);
+	aWriter.Write<std::uint64_t>(myOutputCount);
+	aWriter.Write(myFitness);
+	aWriter.Write(myAdjustedFitness);
+
+	std::vector<std::uint8_t> nodeTypes;
+	std::vector<std::uint64_t> nodeKeys;
+	nodeTypes.reserve(myNodes.size());
+	nodeKeys.reserve(myNodes.size());
+	for (const Node& node : myNodes)
+	{
+		nodeTypes.push_back(static_cast<std::uint8_t>(node.GetType()));
+		nodeKeys.push_back(node.GetKey());
+	}
+	aWriter.WriteArray<std::uint8_t>(nodeTypes);
+	aWriter.WriteArray<std::uint64_t>(nodeKeys);
+	aWriter.WriteArray<std::uint32_t>(myExecutionOrder);
+	aWriter.WriteArray<Link>(myLinks);
+}
+
+bool Genome::ReadCheckpoint(CheckpointReader& aReader)
+{
+	std::uint64_t inputCount = 0;
+	std::uint64_t outputCount = 0;
+	aReader.Read(inputCount);
+	aReader.Read(outputCount);
+	aReader.Read(myFitness);
+	aReader.Read(myAdjustedFitness);
+	std::span<const std::uint8_t> nodeTypes = aReader.ReadArray<std::uint8_t>();
+	std::span<const std::uint64_t> nodeKeys = aReader.ReadArray<std::uint64_t>();
+	std::span<const std::uint32_t> executionOrder = aReader.ReadArray<std::uint32_t>();
+	std::span<const Link> links = aReader.ReadArray<Link>();
+
+	if (!aReader.IsValid() || nodeKeys.size() != nodeTypes.size() || executionOrder.size() != nodeTypes.size() || nodeTypes.size() < 1 + inputCount + outputCount)
+		return false;
+
+	myInputCount = static_cast<size_t>(inputCount);
+	myOutputCount = static_cast<size_t>(outputCount);
+
+	myNodes.clear();
+	myNodes.reserve(nodeTypes.size());
+	for (size_t i = 0; i < nodeTypes.size(); ++i)
+	{
+		if (nodeTypes[i] > static_cast<std::uint8_t>(Node::Type::Output))
+			return false;
+		myNodes.push_back(Node(static_cast<Node::Type>(nodeTypes[i]), nodeKeys[i]));
+	}
+
+	myExecutionOrder.assign(executionOrder.begin(), executionOrder.end());
+	myExecutionRanks.assign(myNodes.size(), UINT32_MAX);
+	for (size_t rank = 0; rank < myExecutionOrder.size(); ++rank)
+	{
+		if (myExecutionOrder[rank] >= myNodes.size() || myExecutionRanks[myExecutionOrder[rank]] != UINT32_MAX)
+			return false;
+		myExecutionRanks[myExecutionOrder[rank]] = static_cast<std::uint32_t>(rank);
+	}
+
+	// The genes are copied as they are, only the graph and the index are rebuilt from them. As for Check, the links have to
+	// be sorted by innovation id, follow the execution order, and join two nodes at most once.
+	myLinks.assign(links.begin(), links.end());
+	myLinkIndex.Clear();
+	for (size_t i = 0; i < myLinks.size(); ++i)
+	{
+		const Link& link = myLinks[i];
+		if (link.GetSrcNodeIdx() >= myNodes.size() || link.GetDstNodeIdx() >= myNodes.size())
+			return false;
+		if ((i > 0 && myLinks[i - 1].GetInnovationId() >= link.GetInnovationId())
+			|| myExecutionRanks[link.GetSrcNodeIdx()] >= myExecutionRanks[link.GetDstNodeIdx()])
+		{
+			return false;
+		}
+		std::uint64_t indexedInnovationId = 0;
+		if (myLinkIndex.Find(link.GetSrcNodeIdx(), link.GetDstNodeIdx(), indexedInnovationId))
+			return false;
+
+		myNodes[link.GetDstNodeIdx()].AddInputLink(link.GetInnovationId(), link.GetSrcNodeIdx());
+		myNodes[link.GetSrcNodeIdx()].AddOutputNode(link.GetDstNodeIdx());
+		myLinkIndex.Insert(link.GetSrcNodeIdx(), link.GetDstNodeIdx(), link.GetInnovationId());
+	}
+
+	myPhenotype.Clear();
+	return true;
+}
+
+Genome::Genome(const Genome* aParent1, const Genome* aParent2, Random& aRandom)
 {
 	const Genome* primaryParent = aParent1->myFitness >= aParent2->myFitness ? aParent1 : aParent2;
 	const Genome* secondaryParent = aParent1->myFitness >= aParent2->myFitness ? aParent2 : aParent1;
@@ -139,20 +265,26 @@ Genome::Genome(const Genome* aParent1, const Genome* aParent2)
 	myInputCount = primaryParent->myInputCount;
 	myOutputCount = primaryParent->myOutputCount;
 	
+	myNodes.reserve(primaryParent->myNodes.size());
 	for (const Node& node : primaryParent->myNodes)
-		myNodes.push_back(Node(node.GetType()));
-
-	for (auto it = primaryParent->myLinks.begin(); it != primaryParent->myLinks.end(); ++it)
+		myNodes.push_back(Node(node.GetType(), node.GetKey()));
+	myExecutionOrder = primaryParent->myExecutionOrder;
+	myExecutionRanks = primaryParent->myExecutionRanks;
+
+	// Both parents are sorted by innovation id, so the common genes are found with a single merge
+	myLinks.reserve(primaryParent->myLinks.size());
+	auto it2 = secondaryParent->myLinks.begin();
+	for (const Link& primaryParentLink : primaryParent->myLinks)
 	{
-		std::uint64_t innovationId = it->first;
-		const Link& primaryParentLink = it->second;
-		
-		auto it2 = secondaryParent->myLinks.find(innovationId);
-		if (it2 != secondaryParent->myLinks.end())
+		std::uint64_t innovationId = primaryParentLink.GetInnovationId();
+		while (it2 != secondaryParent->myLinks.end() && it2->GetInnovationId() < innovationId)
+			++it2;
+
+		if (it2 != secondaryParent->myLinks.end() && it2->GetInnovationId() == innovationId)
 		{
 			// Common gene, choose weight randomly
 			std::uniform_int_distribution<> rand(0, 1);
-			double weight = (rand(EvolutionParams::GetRandomGenerator()) == 0) ? primaryParentLink.GetWeight() : it2->second.GetWeight();
+			double weight = (rand(aRandom) == 0) ? primaryParentLink.GetWeight() : it2->GetWeight();
 
 			LinkNodes(innovationId, primaryParentLink.GetSrcNodeIdx(), primaryParentLink.GetDstNodeIdx(), weight, primaryParentLink.IsEnabled());
 		}
@@ -164,97 +296,277 @@ Genome::Genome(const Genome* aParent1, const Genome* aParent2)
 	}
 }
 
-void Genome::Mutate()
+void Genome::Mutate(Random& aRandom, const EvolutionParams& someParams, std::uint64_t aFirstInnovationId)
 {
 	//Check();
 
 	std::uniform_real_distribution<> rand(0.0, 1.0);
+	std::uint64_t nextInnovationId = aFirstInnovationId;
+	bool canAddGenes = aFirstInnovationId != EvolutionParams::ourNoMutationInnovationId;
+
+	if (rand(aRandom) <= someParams.myLinkWeightMutationProba)
+		MutateLinkWeights(aRandom, someParams);
 
-	if (rand(EvolutionParams::GetRandomGenerator()) <= EvolutionParams::ourLinkWeightMutationProba)
-		MutateLinkWeights();
+	// The probabilities are drawn even without innovation numbers, so that the random stream stays the same
+	if (rand(aRandom) <= someParams.myNewLinkProba && canAddGenes)
+		MutateAddLink(aRandom, someParams, nextInnovationId);
 
-	if (rand(EvolutionParams::GetRandomGenerator()) <= EvolutionParams::ourNewLinkProba)
-		MutateAddLink();
+	if (rand(aRandom) <= someParams.myNewNodeProba && canAddGenes)
+		MutateAddNode(aRandom, nextInnovationId);
 
-	if (rand(EvolutionParams::GetRandomGenerator()) <= EvolutionParams::ourNewNodeProba)
-		MutateAddNode();
+	assert(!canAddGenes || nextInnovationId <= aFirstInnovationId + EvolutionParams::ourMutationInnovationsCount);
 
 	//Check();
 }
 
-bool Genome::Check() const
+void Genome::ResolveInnovations(std::uint64_t aFirstInnovationId, InnovationTable& anInnovationTable)
 {
-	for (size_t idx = 0; idx < myNodes.size(); ++idx)
+	if (aFirstInnovationId == EvolutionParams::ourNoMutationInnovationId)
+		return;
+
+	std::uint64_t endInnovationId = aFirstInnovationId + EvolutionParams::ourMutationInnovationsCount;
+	auto first = std::lower_bound(myLinks.begin(), myLinks.end(), aFirstInnovationId,
+		[](const Link& aLink, std::uint64_t anId) { return aLink.GetInnovationId() < anId; });
+
+	// The new links are visited in creation order, so a node added on a new link gets the key of the resolved link.
+	// The links keep their numbers until all are registered, for FindLink to search them while they are still sorted.
+	struct Renumbering
 	{
-		// Verify that all links are valid
+		Link* myLink;
+		std::uint64_t myInnovationId;
+	};
+	Renumbering renumberings[EvolutionParams::ourMutationInnovationsCount];
+	size_t renumberingsCount = 0;
+	for (auto it = first; it != myLinks.end() && it->GetInnovationId() < endInnovationId; ++it)
+	{
+		std::uint64_t oldInnovationId = it->GetInnovationId();
+		std::uint64_t innovationId = anInnovationTable.Register(myNodes[it->GetSrcNodeIdx()].GetKey(), myNodes[it->GetDstNodeIdx()].GetKey(), oldInnovationId);
 
-		for (std::uint64_t linkId : myNodes[idx].GetInputLinks())
+		// Keep the new number if the genome already owns the registered one (the same link split twice)
+		if (innovationId == oldInnovationId || FindLink(innovationId)
+			|| std::any_of(renumberings, renumberings + renumberingsCount, [innovationId](const Renumbering& aRenumbering) { return aRenumbering.myInnovationId == innovationId; }))
 		{
-			auto it = myLinks.find(linkId);
-			assert(it != myLinks.end());
-			if (it == myLinks.end())
-				return false;
+			continue;
+		}
 
-			assert(it->second.GetDstNodeIdx() == idx);
-			if (it->second.GetDstNodeIdx() != idx)
-				return false;
+		assert(renumberingsCount < EvolutionParams::ourMutationInnovationsCount);
+		renumberings[renumberingsCount++] = { &*it, innovationId };
+		for (size_t i = 1 + myInputCount + myOutputCount; i < myNodes.size(); ++i)
+		{
+			if (myNodes[i].GetKey() == (Node::ourHiddenNodeKeyFlag | oldInnovationId))
+				myNodes[i].SetKey(Node::ourHiddenNodeKeyFlag | innovationId);
+		}
+	}
+
+	for (size_t r = 0; r < renumberingsCount; ++r)
+	{
+		Link& link = *renumberings[r].myLink;
+		std::uint64_t oldInnovationId = link.GetInnovationId();
+		link.SetInnovationId(renumberings[r].myInnovationId);
+		myNodes[link.GetDstNodeIdx()].ReplaceInputLink(oldInnovationId, renumberings[r].myInnovationId);
+		myLinkIndex.Insert(link.GetSrcNodeIdx(), link.GetDstNodeIdx(), renumberings[r].myInnovationId);
+	}
+	bool renumbered = renumberingsCount > 0;
+
+	if (renumbered)
+	{
+		// Registered numbers come from genomes resolved earlier, they are above the inherited links when the genomes are resolved
+		// in the order of their reserved numbers, as in a generation, but not in the steady-state training
+		std::sort(myLinks.begin(), myLinks.end(), [](const Link& aLink1, const Link& aLink2) { return aLink1.GetInnovationId() < aLink2.GetInnovationId(); });
+		myPhenotype.Clear();
+	}
+}
+
+bool Genome::Check() const
+{
+	// Single pass over the nodes and the links, cheap enough to run every generation
+
+	const size_t nodesCount = myNodes.size();
+	assert(nodesCount >= 1 + myInputCount + myOutputCount);
+	if (nodesCount < 1 + myInputCount + myOutputCount)
+		return false;
+
+	// Verify that the execution order is a permutation of the nodes, with the Outputs last
+
+	assert(myExecutionOrder.size() == nodesCount && myExecutionRanks.size() == nodesCount);
+	if (myExecutionOrder.size() != nodesCount || myExecutionRanks.size() != nodesCount)
+		return false;
+
+	for (size_t rank = 0; rank < nodesCount; ++rank)
+	{
+		bool isRanked = myExecutionOrder[rank] < nodesCount && myExecutionRanks[myExecutionOrder[rank]] == rank;
+		assert(isRanked);
+		if (!isRanked)
+			return false;
+	}
+
+	for (size_t i = 0; i < myOutputCount; ++i)
+	{
+		size_t outputNodeIdx = 1 + myInputCount + i;
+		assert(myExecutionRanks[outputNodeIdx] == nodesCount - myOutputCount + i);
+		if (myExecutionRanks[outputNodeIdx] != nodesCount - myOutputCount + i)
+			return false;
+	}
+
+	// Verify that the links are sorted, indexed, executed after their source, and listed by their destination node.
+	// The input links of a node are sorted like the links, so a cursor per node matches them in the same pass.
+
+	assert(myLinkIndex.GetSize() == myLinks.size());
+	if (myLinkIndex.GetSize() != myLinks.size())
+		return false;
+
+	std::vector<std::set<std::uint64_t>::const_iterator> inputLinkCursors(nodesCount);
+	for (size_t idx = 0; idx < nodesCount; ++idx)
+		inputLinkCursors[idx] = myNodes[idx].GetInputLinks().begin();
+
+	for (size_t i = 0; i < myLinks.size(); ++i)
+	{
+		const Link& link = myLinks[i];
+		bool isValid = (i == 0 || myLinks[i - 1].GetInnovationId() < link.GetInnovationId())
+			&& link.GetSrcNodeIdx() < nodesCount && link.GetDstNodeIdx() < nodesCount
+			&& myExecutionRanks[link.GetSrcNodeIdx()] < myExecutionRanks[link.GetDstNodeIdx()];
+		assert(isValid);
+		if (!isValid)
+			return false;
+
+		std::uint64_t innovationId = 0;
+		bool indexed = myLinkIndex.Find(link.GetSrcNodeIdx(), link.GetDstNodeIdx(), innovationId) && innovationId == link.GetInnovationId();
+		assert(indexed);
+		if (!indexed)
+			return false;
+
+		auto& cursor = inputLinkCursors[link.GetDstNodeIdx()];
+		bool isInputLink = cursor != myNodes[link.GetDstNodeIdx()].GetInputLinks().end() && *cursor == link.GetInnovationId();
+		assert(isInputLink);
+		if (!isInputLink)
+			return false;
+		++cursor;
+	}
+
+	for (size_t idx = 0; idx < nodesCount; ++idx)
+	{
+		const Node& node = myNodes[idx];
+		bool isConsistent = inputLinkCursors[idx] == node.GetInputLinks().end() && node.GetInputNodes().size() == node.GetInputLinks().size();
+		assert(isConsistent);
+		if (!isConsistent)
+			return false;
 
-			assert(it->second.GetSrcNodeIdx() < it->second.GetDstNodeIdx());
-			if (it->second.GetSrcNodeIdx() >= it->second.GetDstNodeIdx())
+		for (std::uint32_t srcNodeIdx : node.GetInputNodes())
+		{
+			bool isValid = srcNodeIdx < nodesCount && myExecutionRanks[srcNodeIdx] < myExecutionRanks[idx];
+			assert(isValid);
+			if (!isValid)
 				return false;
 		}
+	}
 
-		// Verify there is no recursion in the network
+	// Kahn's algorithm, in the execution order: a node is only reached once all its sources are, so there is no recursion
+	// in the network, and it inherits their connection to the Bias and the Inputs
 
-		std::set<size_t> dependencies;
-		bool collectedDependencies = CollectNodeDependencies(idx, dependencies);
-		assert(collectedDependencies);
-		if (!collectedDependencies)
+	constexpr std::uint8_t connectedToBias = 1;
+	constexpr std::uint8_t connectedToInput = 2;
+	std::vector<std::uint32_t> pendingInputsCounts(nodesCount);
+	std::vector<std::uint8_t> connections(nodesCount, 0);
+	for (size_t idx = 0; idx < nodesCount; ++idx)
+		pendingInputsCounts[idx] = static_cast<std::uint32_t>(myNodes[idx].GetInputNodes().size());
+
+	for (std::uint32_t idx : myExecutionOrder)
+	{
+		const Node& node = myNodes[idx];
+		assert(pendingInputsCounts[idx] == 0);
+		if (pendingInputsCounts[idx] != 0)
 			return false;
 
-		if (myNodes[idx].GetType() == Node::Type::Bias || myNodes[idx].GetType() == Node::Type::Input)
+		if (node.GetType() == Node::Type::Bias || node.GetType() == Node::Type::Input)
 		{
 			// Verify Bias and Inputs don't have dependencies
 
-			assert(dependencies.size() == 0);
-			if (dependencies.size() > 0)
+			assert(node.GetInputNodes().empty());
+			if (!node.GetInputNodes().empty())
 				return false;
+
+			connections[idx] = node.GetType() == Node::Type::Bias ? connectedToBias : connectedToInput;
 		}
 		else
 		{
 			// Verify that all other nodes are connected to the Bias node and at least 1 Input node
 
-			bool connectedToBias = dependencies.contains(0);
-			assert(connectedToBias);
-			if (!connectedToBias)
+			assert(connections[idx] == (connectedToBias | connectedToInput));
+			if (connections[idx] != (connectedToBias | connectedToInput))
 				return false;
+		}
 
-			bool connectedToInput = false;
-			for (size_t inputIdx = 0; inputIdx < myInputCount; ++inputIdx)
-			{
-				if (dependencies.contains(1 + inputIdx))
-				{
-					connectedToInput = true;
-					break;
-				}
-			}
-			assert(connectedToInput);
-			if (!connectedToInput)
+		for (std::uint32_t dstNodeIdx : node.GetOutputNodes())
+		{
+			bool isPending = dstNodeIdx < nodesCount && pendingInputsCounts[dstNodeIdx] > 0;
+			assert(isPending);
+			if (!isPending)
 				return false;
+
+			--pendingInputsCounts[dstNodeIdx];
+			connections[dstNodeIdx] |= connections[idx];
 		}
+	}
+	return true;
+}
 
-		// Verify that the nodes are correctly ordered (by execution)
+Phenotype& Genome::Compile()
+{
+	if (myPhenotype.IsCompiled()
+		&& myPhenotype.GetPrecision() == EvolutionParams::ourPhenotypePrecision
+		&& myPhenotype.GetActivation() == EvolutionParams::ourPhenotypeActivation)
+		return myPhenotype;
+
+	myPhenotype.BeginCompilation(myInputCount, EvolutionParams::ourPhenotypePrecision, EvolutionParams::ourPhenotypeActivation);
+
+	// Flag the nodes contributing to the outputs, walking the execution order backward
+	std::vector<bool> reachable(myNodes.size(), false);
+	for (size_t i = 0; i < myOutputCount; ++i)
+		reachable[1 + myInputCount + i] = true;
+	for (size_t rank = myNodes.size(); rank-- > 1 + myInputCount;)
+	{
+		size_t nodeIdx = myExecutionOrder[rank];
+		if (!reachable[nodeIdx])
+			continue;
 
-		for (size_t dependencyIdx : dependencies)
+		for (std::uint64_t linkId : myNodes[nodeIdx].GetInputLinks())
 		{
-			if (dependencyIdx >= idx)
-			{
-				assert(false);
-				return false;
-			}
+			const Link* link = FindLink(linkId);
+			if (link && link->IsEnabled())
+				reachable[link->GetSrcNodeIdx()] = true;
 		}
 	}
-	return true;
+
+	// Bias and Inputs keep their index, the reachable nodes are packed after them, in execution order
+	std::vector<std::uint32_t> valueIndices(myNodes.size(), 0);
+	std::uint32_t valuesCount = static_cast<std::uint32_t>(1 + myInputCount);
+	for (size_t i = 0; i < valuesCount; ++i)
+		valueIndices[i] = static_cast<std::uint32_t>(i);
+	for (size_t rank = valuesCount; rank < myNodes.size(); ++rank)
+		if (reachable[myExecutionOrder[rank]])
+			valueIndices[myExecutionOrder[rank]] = valuesCount++;
+
+	for (size_t rank = 1 + myInputCount; rank < myNodes.size(); ++rank)
+	{
+		size_t nodeIdx = myExecutionOrder[rank];
+		if (!reachable[nodeIdx])
+			continue;
+
+		// Links are kept in the same order as Node::GetInputLinks, for the sums to be reproducible
+		for (std::uint64_t linkId : myNodes[nodeIdx].GetInputLinks())
+		{
+			const Link* link = FindLink(linkId);
+			if (link && link->IsEnabled())
+				myPhenotype.AddLink(valueIndices[link->GetSrcNodeIdx()], link->GetWeight());
+		}
+		myPhenotype.EndNode();
+	}
+
+	for (size_t i = 0; i < myOutputCount; ++i)
+		myPhenotype.AddOutput(valueIndices[1 + myInputCount + i]);
+
+	myPhenotype.EndCompilation(valuesCount);
+	return myPhenotype;
 }
 
 bool Genome::Evaluate(const std::vector<double>& someInputs, std::vector<double>& someOutputs)
@@ -263,224 +575,263 @@ bool Genome::Evaluate(const std::vector<double>& someInputs, std::vector<double>
 		return false;
 
 	someOutputs.resize(myOutputCount);
-	if (myOutputCount == 0)
-		return true;
-
-	myNodes[0].SetInputValue(1.0);
-	for (size_t i = 0; i < myInputCount; ++i)
-		myNodes[i + 1].SetInputValue(someInputs[i]);
-
-	for (Node& node : myNodes)
-		node.Evaluate(myNodes, myLinks);
+	return Evaluate(std::span<const double>(someInputs), std::span<double>(someOutputs));
+}
 
-	for (size_t i = 0; i < myOutputCount; ++i)
-		someOutputs[i] = myNodes[i + myNodes.size() - myOutputCount].GetOutputValue();
+bool Genome::Evaluate(std::span<const double> someInputs, std::span<double> someOutputs)
+{
+	return Compile().Evaluate(someInputs, someOutputs);
+}
 
-	return true;
+bool Genome::EvaluateBatch(std::span<const double> someInputs, std::span<double> someOutputs, size_t aBatchSize)
+{
+	return Compile().EvaluateBatch(someInputs, someOutputs, aBatchSize);
 }
 
-void Genome::LinkNodes(size_t aSrcNodeIdx, size_t aDstNodeIdx, double aWeight, bool anEnable)
+void Genome::LinkNodes(size_t aSrcNodeIdx, size_t aDstNodeIdx, double aWeight, bool anEnable, std::uint64_t& aNextInnovationId)
 {
-	for (auto it = myLinks.begin(); it != myLinks.end(); ++it)
+	std::uint64_t innovationId = 0;
+	if (myLinkIndex.Find(aSrcNodeIdx, aDstNodeIdx, innovationId))
 	{
-		Link& link = it->second;
-		if (link.GetSrcNodeIdx() == aSrcNodeIdx && link.GetDstNodeIdx() == aDstNodeIdx)
+		if (Link* link = FindLink(innovationId))
 		{
-			link.SetWeight(aWeight);
-			link.SetEnabled(anEnable);
+			link->SetWeight(aWeight);
+			link->SetEnabled(anEnable);
 			return;
 		}
 	}
-	std::uint64_t innovationId = EvolutionParams::GetInnovationNumber();
-	myLinks.insert({innovationId, Link(aSrcNodeIdx, aDstNodeIdx, aWeight, anEnable)});
-	myNodes[aDstNodeIdx].AddInputLink(innovationId);
+	LinkNodes(aNextInnovationId++, aSrcNodeIdx, aDstNodeIdx, aWeight, anEnable);
 }
 
 void Genome::LinkNodes(std::uint64_t anInnovationId, size_t aSrcNodeIdx, size_t aDstNodeIdx, double aWeight, bool anEnable)
 {
-	myLinks.insert({ anInnovationId,Link(aSrcNodeIdx, aDstNodeIdx, aWeight, anEnable) });
-	myNodes[aDstNodeIdx].AddInputLink(anInnovationId);
+	// New innovations usually have the highest id, so this is mostly a push_back
+	auto it = std::upper_bound(myLinks.begin(), myLinks.end(), anInnovationId,
+		[](std::uint64_t anId, const Link& aLink) { return anId < aLink.GetInnovationId(); });
+	if (it != myLinks.begin() && (it - 1)->GetInnovationId() == anInnovationId)
+		return;
+
+	myLinks.insert(it, Link(anInnovationId, aSrcNodeIdx, aDstNodeIdx, aWeight, anEnable));
+	myLinkIndex.Insert(aSrcNodeIdx, aDstNodeIdx, anInnovationId);
+	myNodes[aDstNodeIdx].AddInputLink(anInnovationId, aSrcNodeIdx);
+	myNodes[aSrcNodeIdx].AddOutputNode(aDstNodeIdx);
 }
 
-bool Genome::CollectNodeDependencies(size_t aNodeIdx, std::set<size_t>& someOutNodes, size_t aRecursion) const
+const Link* Genome::FindLink(std::uint64_t anInnovationId) const
 {
-	if (aRecursion > myNodes.size())
-		return false;
+	auto it = std::lower_bound(myLinks.begin(), myLinks.end(), anInnovationId,
+		[](const Link& aLink, std::uint64_t anId) { return aLink.GetInnovationId() < anId; });
+	if (it == myLinks.end() || it->GetInnovationId() != anInnovationId)
+		return nullptr;
+	return &(*it);
+}
 
-	for (std::uint64_t linkId : myNodes[aNodeIdx].GetInputLinks())
+Link* Genome::FindLink(std::uint64_t anInnovationId)
+{
+	return const_cast<Link*>(static_cast<const Genome*>(this)->FindLink(anInnovationId));
+}
+
+void Genome::CollectAncestors(size_t aNodeIdx, std::uint32_t aMinRank, std::vector<std::uint32_t>& someOutNodes) const
+{
+	std::vector<bool> visited(myNodes.size(), false);
+	std::vector<std::uint32_t> toVisit(1, static_cast<std::uint32_t>(aNodeIdx));
+	while (!toVisit.empty())
 	{
-		auto it = myLinks.find(linkId);
-		if (it == myLinks.end())
-			continue;
+		std::uint32_t nodeIdx = toVisit.back();
+		toVisit.pop_back();
 
-		size_t srcIdx = it->second.GetSrcNodeIdx();
-		if (someOutNodes.contains(srcIdx))
-			continue;
+		for (std::uint32_t srcNodeIdx : myNodes[nodeIdx].GetInputNodes())
+		{
+			if (visited[srcNodeIdx] || myExecutionRanks[srcNodeIdx] < aMinRank)
+				continue;
 
-		someOutNodes.insert(srcIdx);
-		CollectNodeDependencies(srcIdx, someOutNodes, aRecursion + 1);
+			visited[srcNodeIdx] = true;
+			someOutNodes.push_back(srcNodeIdx);
+			toVisit.push_back(srcNodeIdx);
+		}
 	}
-	return true;
 }
 
-void Genome::MoveNode(size_t anOldNodeIdx, size_t aNewNodeIdx)
+void Genome::CollectDescendants(size_t aNodeIdx, std::uint32_t aMaxRank, std::vector<std::uint32_t>& someOutNodes) const
 {
-	assert(anOldNodeIdx != aNewNodeIdx);
-	if (anOldNodeIdx == aNewNodeIdx)
-		return;
+	std::vector<bool> visited(myNodes.size(), false);
+	std::vector<std::uint32_t> toVisit(1, static_cast<std::uint32_t>(aNodeIdx));
+	while (!toVisit.empty())
+	{
+		std::uint32_t nodeIdx = toVisit.back();
+		toVisit.pop_back();
+
+		for (std::uint32_t dstNodeIdx : myNodes[nodeIdx].GetOutputNodes())
+		{
+			if (visited[dstNodeIdx] || myExecutionRanks[dstNodeIdx] > aMaxRank)
+				continue;
+
+			visited[dstNodeIdx] = true;
+			someOutNodes.push_back(dstNodeIdx);
+			toVisit.push_back(dstNodeIdx);
+		}
+	}
+}
+
+void Genome::InsertInExecutionOrder(size_t aNodeIdx, size_t aRank)
+{
+	myExecutionOrder.insert(myExecutionOrder.begin() + aRank, static_cast<std::uint32_t>(aNodeIdx));
+	myExecutionRanks.resize(myNodes.size());
+
+	// Only the nodes after the insertion are shifted, the links are not affected
+	for (size_t rank = aRank; rank < myExecutionOrder.size(); ++rank)
+		myExecutionRanks[myExecutionOrder[rank]] = static_cast<std::uint32_t>(rank);
+}
 
-	if (anOldNodeIdx > aNewNodeIdx)
+void Genome::ReorderBeforeLink(size_t aSrcNodeIdx, size_t aDstNodeIdx)
+{
+	// Pearce-Kelly: only the nodes between the destination and the source in the execution order can be affected.
+	// The descendants of the destination placed before the source have to move after it,
+	// and the ancestors of the source placed after the destination have to move before them.
+	std::uint32_t srcRank = myExecutionRanks[aSrcNodeIdx];
+	std::uint32_t dstRank = myExecutionRanks[aDstNodeIdx];
+	assert(srcRank > dstRank);
+
+	std::vector<std::uint32_t> forwardNodes(1, static_cast<std::uint32_t>(aDstNodeIdx));
+	CollectDescendants(aDstNodeIdx, srcRank, forwardNodes);
+
+	std::vector<std::uint32_t> backwardNodes(1, static_cast<std::uint32_t>(aSrcNodeIdx));
+	CollectAncestors(aSrcNodeIdx, dstRank, backwardNodes);
+
+	auto compareRanks = [this](std::uint32_t aNodeIdx1, std::uint32_t aNodeIdx2) { return myExecutionRanks[aNodeIdx1] < myExecutionRanks[aNodeIdx2]; };
+	std::sort(forwardNodes.begin(), forwardNodes.end(), compareRanks);
+	std::sort(backwardNodes.begin(), backwardNodes.end(), compareRanks);
+
+	// Reuse the ranks of the affected nodes, the backward nodes first, each group keeping its relative order
+	std::vector<std::uint32_t> ranks;
+	ranks.reserve(forwardNodes.size() + backwardNodes.size());
+	for (std::uint32_t nodeIdx : backwardNodes)
+		ranks.push_back(myExecutionRanks[nodeIdx]);
+	for (std::uint32_t nodeIdx : forwardNodes)
+		ranks.push_back(myExecutionRanks[nodeIdx]);
+	std::sort(ranks.begin(), ranks.end());
+
+	size_t rankIdx = 0;
+	for (std::uint32_t nodeIdx : backwardNodes)
 	{
-		// Node was advanced earlier in the execution list
-		myNodes.insert(myNodes.begin() + aNewNodeIdx, std::move(myNodes[anOldNodeIdx]));
-		myNodes.erase(myNodes.begin() + anOldNodeIdx + 1);
+		myExecutionRanks[nodeIdx] = ranks[rankIdx];
+		myExecutionOrder[ranks[rankIdx++]] = nodeIdx;
 	}
-	else
+	for (std::uint32_t nodeIdx : forwardNodes)
 	{
-		// Node was pushed further in the execution list
-		myNodes.insert(myNodes.begin() + aNewNodeIdx + 1, std::move(myNodes[anOldNodeIdx]));
-		myNodes.erase(myNodes.begin() + anOldNodeIdx);
+		myExecutionRanks[nodeIdx] = ranks[rankIdx];
+		myExecutionOrder[ranks[rankIdx++]] = nodeIdx;
 	}
-
-	// Node indices changed, so all links have to be updated
-	for (auto it = myLinks.begin(); it != myLinks.end(); ++it)
-		it->second.UpdateAfterNodeMove(anOldNodeIdx, aNewNodeIdx);
 }
 
-void Genome::MutateLinkWeights()
+void Genome::MutateLinkWeights(Random& aRandom, const EvolutionParams& someParams)
 {
-	for (auto it = myLinks.begin(); it != myLinks.end(); ++it)
+	myPhenotype.Clear();
+
+	for (Link& link : myLinks)
 	{
-		Link& link = it->second;
 		std::uniform_real_distribution<> rand(0.0, 1.0);
-		if (rand(EvolutionParams::GetRandomGenerator()) <= EvolutionParams::ourLinkWeightTotalMutationProba)
+		if (rand(aRandom) <= someParams.myLinkWeightTotalMutationProba)
 		{
-			std::uniform_real_distribution<> rand2(-EvolutionParams::ourLinkWeightBound, EvolutionParams::ourLinkWeightBound);
-			link.SetWeight(rand2(EvolutionParams::GetRandomGenerator()));
+			std::uniform_real_distribution<> rand2(-someParams.myLinkWeightBound, someParams.myLinkWeightBound);
+			link.SetWeight(rand2(aRandom));
 		}
 		else
 		{
-			std::normal_distribution<> rand2(0.0, EvolutionParams::ourLinkWeightPartialMutationPower);
-			link.SetWeight(std::clamp(link.GetWeight() + rand2(EvolutionParams::GetRandomGenerator()), -EvolutionParams::ourLinkWeightBound, EvolutionParams::ourLinkWeightBound));
+			std::normal_distribution<> rand2(0.0, someParams.myLinkWeightPartialMutationPower);
+			link.SetWeight(std::clamp(link.GetWeight() + rand2(aRandom), -someParams.myLinkWeightBound, someParams.myLinkWeightBound));
 		}
 	}
 }
 
-void Genome::MutateAddLink()
+void Genome::MutateAddLink(Random& aRandom, const EvolutionParams& someParams, std::uint64_t& aNextInnovationId)
 {
-	auto getRandomConnectableSrcNodeIdx = [this](size_t aDstNodeIdx) {
-		std::set<size_t> availableSrcNodeIdx;
-
-		std::set<size_t> dstDependencies;
-		CollectNodeDependencies(aDstNodeIdx, dstDependencies);
-		for (size_t i = 0, e = myNodes.size() - myOutputCount; i < e; ++i)
-		{
-			if (i == aDstNodeIdx || dstDependencies.contains(i))
-				continue;
+	// Hidden nodes and Outputs can be destinations, they are stored after the Bias and the Inputs
+	std::uniform_int_distribution<> rand(1 + (int)myInputCount, (int)myNodes.size() - 1);
+	size_t dstNodeIdx = rand(aRandom);
 
-			std::set<size_t> srcDependencies;
-			CollectNodeDependencies(i, srcDependencies);
+	// The source can't be an ancestor of the destination (already connected), nor a descendant of it (it would create a cycle).
+	// This walk stays linear in the nodes and links: most destinations have few or no available sources, an Output starts
+	// linked to every Input, so rejecting random candidates with a bounded search would mostly end up walking it anyway.
+	std::vector<std::uint32_t> excludedNodes(1, static_cast<std::uint32_t>(dstNodeIdx));
+	CollectAncestors(dstNodeIdx, 0, excludedNodes);
+	CollectDescendants(dstNodeIdx, UINT32_MAX, excludedNodes);
 
-			if (srcDependencies.contains(aDstNodeIdx))
-				continue;
+	std::vector<bool> excluded(myNodes.size(), false);
+	for (std::uint32_t nodeIdx : excludedNodes)
+		excluded[nodeIdx] = true;
 
-			availableSrcNodeIdx.insert(i);
-		}
+	std::vector<std::uint32_t> availableSrcNodes;
+	for (size_t rank = 0, e = myNodes.size() - myOutputCount; rank < e; ++rank)
+	{
+		std::uint32_t nodeIdx = myExecutionOrder[rank];
+		if (!excluded[nodeIdx])
+			availableSrcNodes.push_back(nodeIdx);
+	}
 
-		if (availableSrcNodeIdx.size() == 0)
-			return aDstNodeIdx; // Already fully connected
+	if (availableSrcNodes.size() == 0)
+		return; // Already fully connected
 
-		std::uniform_int_distribution<> rand(0, (int)availableSrcNodeIdx.size() - 1);
-		auto randIt = availableSrcNodeIdx.begin();
-		std::advance(randIt, rand(EvolutionParams::GetRandomGenerator()));
-		return *randIt;
-	};
+	std::uniform_int_distribution<> rand2(0, (int)availableSrcNodes.size() - 1);
+	size_t srcNodeIdx = availableSrcNodes[rand2(aRandom)];
 
-	std::uniform_int_distribution<> rand(1 + (int)myInputCount, (int)myNodes.size() - 1);
-	size_t dstNodeIdx = rand(EvolutionParams::GetRandomGenerator());
-	size_t srcNodeIdx = getRandomConnectableSrcNodeIdx(dstNodeIdx);
-	if (srcNodeIdx == dstNodeIdx)
-		return;
+	myPhenotype.Clear();
 
-	if (srcNodeIdx > dstNodeIdx)
-	{
-		std::set<size_t> srcDependencies;
-		CollectNodeDependencies(srcNodeIdx, srcDependencies);
-
-		std::vector<size_t> nodesToMove;
-		nodesToMove.reserve(srcDependencies.size() + 1);
-		nodesToMove.push_back(srcNodeIdx);
-		for (size_t idx : srcDependencies)
-			if (idx > dstNodeIdx)
-				nodesToMove.push_back(idx);
-		std::sort(nodesToMove.begin(), nodesToMove.end());
-
-		// Move al these nodes before the dstNode, keeping them ordered
-		for (size_t idx : nodesToMove)
-		{
-			MoveNode(idx, dstNodeIdx);
-			dstNodeIdx++; // the dstNode has been pushed forward as a result
-		}
-		srcNodeIdx = dstNodeIdx - 1;
-	}
+	if (myExecutionRanks[srcNodeIdx] > myExecutionRanks[dstNodeIdx])
+		ReorderBeforeLink(srcNodeIdx, dstNodeIdx);
 
-	std::uniform_real_distribution<> rand2(-EvolutionParams::ourLinkWeightBound, EvolutionParams::ourLinkWeightBound);
-	LinkNodes(srcNodeIdx, dstNodeIdx, rand2(EvolutionParams::GetRandomGenerator()), true);
+	std::uniform_real_distribution<> rand3(-someParams.myLinkWeightBound, someParams.myLinkWeightBound);
+	LinkNodes(srcNodeIdx, dstNodeIdx, rand3(aRandom), true, aNextInnovationId);
 }
 
-void Genome::MutateAddNode()
+void Genome::MutateAddNode(Random& aRandom, std::uint64_t& aNextInnovationId)
 {
-	auto getRandomSplittableLink = [this]() -> Link& {
+	auto getRandomSplittableLink = [this, &aRandom]() -> Link& {
 		int splittableLinksCount = 0;
-		for (auto it = myLinks.begin(); it != myLinks.end(); ++it)
+		for (const Link& link : myLinks)
 		{
-			if (it->second.IsSplittable())
+			if (link.IsSplittable())
 				splittableLinksCount++;
 		}
 
 		std::uniform_int_distribution<> rand(0, splittableLinksCount - 1);
 
-		int selectedLinkIdx = rand(EvolutionParams::GetRandomGenerator());
+		int selectedLinkIdx = rand(aRandom);
 		int visitedSplittableLinks = -1;
-		for (auto it = myLinks.begin(); it != myLinks.end(); ++it)
+		for (Link& link : myLinks)
 		{
-			if (it->second.IsSplittable())
+			if (link.IsSplittable())
 				visitedSplittableLinks++;
 
 			if (visitedSplittableLinks == selectedLinkIdx)
-				return it->second;
+				return link;
 		}
 
 		// Never happens
-		return myLinks.begin()->second;
+		return myLinks.front();
 	};
 	Link& linkToSplit = getRandomSplittableLink();
 
+	myPhenotype.Clear();
+
 	// Disable the link, but keep it to potential be re-enabled later or participate to cross-overs
 	linkToSplit.SetEnabled(false);
 
-	// Insert a new hidden node while keeping the noed vector sorted by execution order
-	size_t newNodeIdx = 0;
-	if (myNodes[linkToSplit.GetDstNodeIdx()].GetType() == Node::Type::Output)
-	{
-		// Place the new hidden node just before the outputs
-		newNodeIdx = myNodes.size() - myOutputCount;
-		myNodes.insert(myNodes.end() - myOutputCount, Node(Node::Type::Hidden));
-	}
-	else
-	{
-		// Place the new hidden node just before the dest node
-		newNodeIdx = linkToSplit.GetDstNodeIdx();
-		myNodes.insert(myNodes.begin() + linkToSplit.GetDstNodeIdx(), Node(Node::Type::Hidden));
-	}
+	// Adding links may reallocate the links array, so copy the split link first
+	const Link splitLink = linkToSplit;
+
+	size_t newNodeIdx = myNodes.size();
+	myNodes.push_back(Node(Node::Type::Hidden, Node::ourHiddenNodeKeyFlag | splitLink.GetInnovationId()));
 
-	// Node indices changed, so all links have to be updated
-	for (auto it = myLinks.begin(); it != myLinks.end(); ++it)
-		it->second.UpdateAfterNodeAdd(newNodeIdx);
+	// Place the new hidden node just before the dest node, or just before the outputs
+	if (myNodes[splitLink.GetDstNodeIdx()].GetType() == Node::Type::Output)
+		InsertInExecutionOrder(newNodeIdx, myNodes.size() - 1 - myOutputCount);
+	else
+		InsertInExecutionOrder(newNodeIdx, myExecutionRanks[splitLink.GetDstNodeIdx()]);
 
-	LinkNodes(0, newNodeIdx, 0.0, true);
-	LinkNodes(linkToSplit.GetSrcNodeIdx(), newNodeIdx, 1.0, true);
-	LinkNodes(newNodeIdx, linkToSplit.GetDstNodeIdx(), linkToSplit.GetWeight(), true);
+	LinkNodes(0, newNodeIdx, 0.0, true, aNextInnovationId);
+	LinkNodes(splitLink.GetSrcNodeIdx(), newNodeIdx, 1.0, true, aNextInnovationId);
+	LinkNodes(newNodeIdx, splitLink.GetDstNodeIdx(), splitLink.GetWeight(), true, aNextInnovationId);
 }
 
 }
@@ -1,32 +1,60 @@
 #pragma once
 
+#include "LinkIndex.h"
 #include "Node.h"
+#include "Phenotype.h"
+#include "Random.h"
 
+#include <span>
 #include <vector>
 #include <map>
 
 namespace Neat {
 
+class CheckpointReader;
+class CheckpointWriter;
+class EvolutionParams;
+class InnovationTable;
 class Specie;
 
 class Genome
 {
 public:
-	Genome(size_t anInputCount, size_t anOutputCount);
+	Genome() = default;
+	// Links the bias and the inputs to the outputs, with the innovation numbers [aFirstInnovationId, aFirstInnovationId + GetGenesCount())
+	Genome(size_t anInputCount, size_t anOutputCount, Random& aRandom, const EvolutionParams& someParams, std::uint64_t aFirstInnovationId);
 	
 	Genome(const char* aFilePath);
 	void SaveToFile(const char* aFilePath) const;
 
-	Genome(const Genome* aParent1, const Genome* aParent2);
-	void Mutate();
-	bool Check() const; // Asserts that the network is not malformed
+	// Binary state for the population checkpoints, the links are read without parsing
+	void WriteCheckpoint(CheckpointWriter& aWriter) const;
+	bool ReadCheckpoint(CheckpointReader& aReader);
 
-	const std::map<std::uint64_t, Link>& GetLinks() const { return myLinks; }
+	Genome(const Genome* aParent1, const Genome* aParent2, Random& aRandom);
+	// The new links use the innovation numbers [aFirstInnovationId, aFirstInnovationId + EvolutionParams::ourMutationInnovationsCount),
+	// which have to be reserved by the caller, this keeps the numbering deterministic when mutating in parallel.
+	// EvolutionParams::ourNoMutationInnovationId only mutates the weights.
+	void Mutate(Random& aRandom, const EvolutionParams& someParams, std::uint64_t aFirstInnovationId);
+	// Gives the links created by the mutation starting at aFirstInnovationId the innovation numbers already registered
+	// for the same structure in anInnovationTable, and registers the others. Genomes have to be resolved in a fixed order.
+	void ResolveInnovations(std::uint64_t aFirstInnovationId, InnovationTable& anInnovationTable);
+	bool Check() const; // Asserts that the network is not malformed, in a single pass over the nodes and the links
+
+	const std::vector<Link>& GetLinks() const { return myLinks; } // Sorted by innovation id
+	const Link* FindLink(std::uint64_t anInnovationId) const;
 
 	size_t GetNodesCount() const { return myNodes.size(); }
 	size_t GetGenesCount() const { return myLinks.size(); }
 
+	// Builds the phenotype if the genes changed since the last compilation
+	Phenotype& Compile();
+	const Phenotype& GetPhenotype() const { return myPhenotype; }
+	std::uint64_t GetPhenotypeHash() { return Compile().GetHash(); } // See Phenotype::GetHash
+
 	bool Evaluate(const std::vector<double>& someInputs, std::vector<double>& someOutputs);
+	bool Evaluate(std::span<const double> someInputs, std::span<double> someOutputs);
+	bool EvaluateBatch(std::span<const double> someInputs, std::span<double> someOutputs, size_t aBatchSize); // See Phenotype::EvaluateBatch
 	void SetFitness(double aFitness) { myFitness = aFitness; }
 	double GetFitness() const { return myFitness; }
 	void AdjustFitness(double anAdjustedFitness) { myAdjustedFitness = anAdjustedFitness; }
@@ -37,21 +65,32 @@ public:
 
 private:
 	size_t GetHiddenNodesCount() const { return myNodes.size() - 1 - myInputCount - myOutputCount; } // -1 for Bias
-	void LinkNodes(size_t aSrcNodeIdx, size_t aDstNodeIdx, double aWeight, bool anEnable);
+	void LinkNodes(size_t aSrcNodeIdx, size_t aDstNodeIdx, double aWeight, bool anEnable, std::uint64_t& aNextInnovationId);
 	void LinkNodes(std::uint64_t anInnovationId, size_t aSrcNodeIdx, size_t aDstNodeIdx, double aWeight, bool anEnable);
 
-	bool CollectNodeDependencies(size_t aNodeIdx, std::set<size_t>& someOutNodes, size_t aRecursion = 0) const;
-	void MoveNode(size_t anOldNodeIdx, size_t aNewNodeIdx);
+	Link* FindLink(std::uint64_t anInnovationId);
+
+	// Only the nodes whose execution rank is in [aMinRank, aMaxRank] are collected, and walked through
+	void CollectAncestors(size_t aNodeIdx, std::uint32_t aMinRank, std::vector<std::uint32_t>& someOutNodes) const;
+	void CollectDescendants(size_t aNodeIdx, std::uint32_t aMaxRank, std::vector<std::uint32_t>& someOutNodes) const;
 
-	void MutateLinkWeights();
-	void MutateAddLink();
-	void MutateAddNode();
+	void InsertInExecutionOrder(size_t aNodeIdx, size_t aRank);
+	void ReorderBeforeLink(size_t aSrcNodeIdx, size_t aDstNodeIdx);
 
-	std::vector<Node> myNodes;	// Sorted by execution order
-	std::map<std::uint64_t, Link> myLinks;
+	void MutateLinkWeights(Random& aRandom, const EvolutionParams& someParams);
+	void MutateAddLink(Random& aRandom, const EvolutionParams& someParams, std::uint64_t& aNextInnovationId);
+	void MutateAddNode(Random& aRandom, std::uint64_t& aNextInnovationId);
+
+	std::vector<Node> myNodes;	// Bias, Inputs, Outputs, then Hidden nodes in creation order
+	std::vector<Link> myLinks;	// Sorted by innovation id
+	LinkIndex myLinkIndex;	// Innovation id of the links, by source and destination nodes
+	std::vector<std::uint32_t> myExecutionOrder;	// Node indices sorted by execution order, the Outputs are always last
+	std::vector<std::uint32_t> myExecutionRanks;	// Position of every node in myExecutionOrder
 	size_t myInputCount = 0;	
 	size_t myOutputCount = 0;
 
+	Phenotype myPhenotype;
+
 	double myFitness = 0.0;
 	double myAdjustedFitness = 0.0;
 
@@ -0,0 +1,18 @@
+#include "InnovationTable.h"
+
+namespace Neat {
+
+std::uint64_t InnovationTable::Register(std::uint64_t aSrcNodeKey, std::uint64_t aDstNodeKey, std::uint64_t anInnovationId)
+{
+	auto it = myInnovations.try_emplace(Key{ aSrcNodeKey, aDstNodeKey }, anInnovationId).first;
+	return it->second;
+}
+
+std::size_t InnovationTable::KeyHash::operator()(const Key& aKey) const
+{
+	std::uint64_t hash = aKey.mySrcNodeKey * 0x9E3779B97F4A7C15ull;
+	hash ^= aKey.myDstNodeKey + 0x7F4A7C159E3779B9ull + (hash << 6) + (hash >> 2);
+	return static_cast<std::size_t>(hash);
+}
+
+}
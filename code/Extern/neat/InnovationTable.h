@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+namespace Neat {
+
+// Innovation numbers of the links added during a generation, keyed on the structural keys of the nodes they connect
+// (see Node::GetKey), so that the same structural mutation appearing in several genomes shares one innovation number
+class InnovationTable
+{
+public:
+	void Clear() { myInnovations.clear(); }
+	std::size_t GetSize() const { return myInnovations.size(); }
+
+	// Returns the innovation number already registered for this link, or registers and returns anInnovationId
+	std::uint64_t Register(std::uint64_t aSrcNodeKey, std::uint64_t aDstNodeKey, std::uint64_t anInnovationId);
+
+private:
+	struct Key
+	{
+		std::uint64_t mySrcNodeKey;
+		std::uint64_t myDstNodeKey;
+		bool operator==(const Key& anOther) const = default;
+	};
+
+	struct KeyHash
+	{
+		std::size_t operator()(const Key& aKey) const;
+	};
+
+	std::unordered_map<Key, std::uint64_t, KeyHash> myInnovations;
+};
+
+}
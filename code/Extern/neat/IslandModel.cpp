@@ -0,0 +1,171 @@
+#include "IslandModel.h"
+
+#include "Random.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace Neat {
+
+IslandModel::IslandModel(size_t anIslandsCount, size_t aPopulationSize, size_t anInputCount, size_t anOutputCount, const EvolutionParams& someParams /*= EvolutionParams()*/)
+{
+	// The initial links are numbered the same in all the islands, then each island numbers its mutations in its own
+	// share of the 32 bits innovation numbers of the links, and stops adding genes once its share is used up
+	std::uint64_t innovationsRangeSize = (Link::ourMaxInnovationId + 1) / std::max<size_t>(anIslandsCount, 1);
+	Random seedsRandom(someParams.myRandomSeed);
+	myIslands.reserve(anIslandsCount);
+	for (size_t i = 0; i < anIslandsCount; ++i)
+	{
+		EvolutionParams islandParams = someParams;
+		Random islandRandom = seedsRandom.Fork(i);
+		islandParams.myRandomSeed = (static_cast<std::uint64_t>(islandRandom()) << 32) | islandRandom();
+		islandParams.myFirstMutationInnovationId = std::max(someParams.myFirstMutationInnovationId, i * innovationsRangeSize);
+		islandParams.myMutationInnovationIdsEnd = std::min(someParams.myMutationInnovationIdsEnd, (i + 1) * innovationsRangeSize);
+		myIslands.push_back(std::make_unique<Population>(aPopulationSize, anInputCount, anOutputCount, islandParams));
+	}
+	myEmigrants.resize(anIslandsCount);
+}
+
+void IslandModel::SetMigration(Topology aTopology, int aMigrationInterval, size_t aMigrantsCount)
+{
+	myTopology = aTopology;
+	myMigrationInterval = aMigrationInterval;
+	myMigrantsCount = aMigrantsCount;
+}
+
+void IslandModel::TrainGenerations(const std::vector<Population::TrainingCallbacks>& someIslandsCallbacks, const Population::ParallelFor& anIslandsParallelFor,
+	int aMaxGenerationCount, double aSatisfactionThreshold)
+{
+	using Clock = std::chrono::steady_clock;
+
+	myStats = Stats();
+	if (myIslands.empty() || someIslandsCallbacks.size() < myIslands.size())
+		return;
+
+	// The emigrants are copied right after their evaluation, the genomes are replaced by their offsprings afterwards
+	std::vector<Population::TrainingCallbacks> islandsCallbacks(someIslandsCallbacks.begin(), someIslandsCallbacks.begin() + myIslands.size());
+	for (size_t i = 0; i < myIslands.size(); ++i)
+	{
+		islandsCallbacks[i].myEvaluateGenomes = [this, i, evaluateGenomes = someIslandsCallbacks[i].myEvaluateGenomes]() {
+			if (evaluateGenomes)
+				evaluateGenomes();
+			if (myIslands[i]->GetGeneration() == myLastEpochGeneration)
+				CollectEmigrants(i);
+		};
+	}
+
+	Clock::time_point start = Clock::now();
+	std::atomic<bool> isSatisfied = false;
+	int generationsCount = 0;
+	while (generationsCount < aMaxGenerationCount && !isSatisfied)
+	{
+		// All the islands are at the same generation, they train independently until the next migration
+		int epochGenerationsCount = aMaxGenerationCount - generationsCount;
+		if (myMigrationInterval > 0 && myMigrantsCount > 0 && myIslands.size() > 1)
+			epochGenerationsCount = std::min(epochGenerationsCount, myMigrationInterval);
+		myLastEpochGeneration = GetGeneration() + epochGenerationsCount;
+		for (std::vector<Genome>& emigrants : myEmigrants)
+			emigrants.clear();
+
+		auto trainIsland = [this, &islandsCallbacks, &isSatisfied, epochGenerationsCount, aSatisfactionThreshold](size_t anIslandIdx) {
+			Population& island = *myIslands[anIslandIdx];
+			for (int i = 0; i < epochGenerationsCount && !isSatisfied; ++i)
+			{
+				island.TrainOneGeneration(islandsCallbacks[anIslandIdx]);
+				const Genome* bestGenome = island.GetBestGenome();
+				if (bestGenome && bestGenome->GetFitness() >= aSatisfactionThreshold)
+					isSatisfied = true;
+			}
+		};
+
+		if (anIslandsParallelFor)
+		{
+			anIslandsParallelFor(myIslands.size(), trainIsland);
+		}
+		else
+		{
+			for (size_t i = 0; i < myIslands.size(); ++i)
+				trainIsland(i);
+		}
+		generationsCount += epochGenerationsCount;
+
+		if (!isSatisfied && generationsCount < aMaxGenerationCount)
+		{
+			Clock::time_point migrationStart = Clock::now();
+			Migrate();
+			myStats.myMigrationsDurationSec += std::chrono::duration<double>(Clock::now() - migrationStart).count();
+		}
+	}
+
+	myStats.myDurationSec = std::chrono::duration<double>(Clock::now() - start).count();
+	myStats.myGenerationsCount = GetGeneration() + 1;
+}
+
+const Genome* IslandModel::GetBestGenome() const
+{
+	const Genome* bestGenome = nullptr;
+	for (const std::unique_ptr<Population>& island : myIslands)
+	{
+		const Genome* islandBestGenome = island->GetBestGenome();
+		if (islandBestGenome && (!bestGenome || islandBestGenome->GetFitness() > bestGenome->GetFitness()))
+			bestGenome = islandBestGenome;
+	}
+	return bestGenome;
+}
+
+void IslandModel::CollectEmigrants(size_t anIslandIdx)
+{
+	Population& island = *myIslands[anIslandIdx];
+
+	std::vector<size_t> genomeIndices(island.GetSize());
+	for (size_t i = 0; i < genomeIndices.size(); ++i)
+		genomeIndices[i] = i;
+
+	size_t emigrantsCount = std::min(myMigrantsCount, genomeIndices.size());
+	std::partial_sort(genomeIndices.begin(), genomeIndices.begin() + emigrantsCount, genomeIndices.end(), [&island](size_t anIdx1, size_t anIdx2) {
+		double fitness1 = island.GetGenome(anIdx1)->GetFitness();
+		double fitness2 = island.GetGenome(anIdx2)->GetFitness();
+		return fitness1 != fitness2 ? fitness1 > fitness2 : anIdx1 < anIdx2;
+	});
+
+	std::vector<Genome>& emigrants = myEmigrants[anIslandIdx];
+	emigrants.clear();
+	for (size_t i = 0; i < emigrantsCount; ++i)
+		emigrants.push_back(*island.GetGenome(genomeIndices[i]));
+}
+
+void IslandModel::Migrate()
+{
+	myStats.myMigrationsCount++;
+
+	std::vector<const Genome*> immigrants;
+	for (size_t i = 0; i < myIslands.size(); ++i)
+	{
+		immigrants.clear();
+		if (myTopology == Topology::Ring)
+		{
+			for (const Genome& emigrant : myEmigrants[(i + myIslands.size() - 1) % myIslands.size()])
+				immigrants.push_back(&emigrant);
+		}
+		else
+		{
+			for (size_t j = 0; j < myIslands.size(); ++j)
+			{
+				if (j == i)
+					continue;
+				for (const Genome& emigrant : myEmigrants[j])
+					immigrants.push_back(&emigrant);
+			}
+
+			// Keeps the best of all the others, in the islands order on ties to stay deterministic
+			size_t immigrantsCount = std::min(myMigrantsCount, immigrants.size());
+			std::stable_sort(immigrants.begin(), immigrants.end(), [](const Genome* aGenome1, const Genome* aGenome2) { return aGenome1->GetFitness() > aGenome2->GetFitness(); });
+			immigrants.resize(immigrantsCount);
+		}
+
+		myIslands[i]->AddImmigrants(immigrants);
+	}
+}
+
+}
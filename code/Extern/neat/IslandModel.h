@@ -0,0 +1,69 @@
+#pragma once
+
+#include "EvolutionParams.h"
+#include "Population.h"
+
+#include <memory>
+#include <vector>
+
+namespace Neat {
+
+// Island model: independent populations trained in parallel, which share their best genomes every few generations.
+// The reproduction of a population is partly serial, splitting it in islands trained at the same time keeps more
+// workers busy, each island evaluating its genomes on its own workers.
+// Every island has its own random streams and its own range of innovation numbers, so the result doesn't depend on
+// the workers, and the migrants never share an innovation number with a different structure of their new island.
+class IslandModel
+{
+public:
+	enum class Topology
+	{
+		Ring, // Each island receives the migrants of the previous one
+		FullyConnected, // Each island receives the best migrants of all the others
+	};
+
+	// Every island has aPopulationSize genomes, and a seed derived from the seed of someParams
+	IslandModel(size_t anIslandsCount, size_t aPopulationSize, size_t anInputCount, size_t anOutputCount, const EvolutionParams& someParams = EvolutionParams());
+
+	size_t GetIslandsCount() const { return myIslands.size(); }
+	Population& GetIsland(size_t anIslandIdx) { return *myIslands[anIslandIdx]; }
+	const Population& GetIsland(size_t anIslandIdx) const { return *myIslands[anIslandIdx]; }
+
+	// The best aMigrantsCount genomes of each island migrate every aMigrationInterval generations, no migration if 0
+	void SetMigration(Topology aTopology, int aMigrationInterval, size_t aMigrantsCount);
+
+	// Trains all the islands until one of them reaches aSatisfactionThreshold, the islands are run by anIslandsParallelFor
+	// and only wait for each other to migrate. someIslandsCallbacks has the callbacks of each island, with its own workers.
+	void TrainGenerations(const std::vector<Population::TrainingCallbacks>& someIslandsCallbacks, const Population::ParallelFor& anIslandsParallelFor,
+		int aMaxGenerationCount, double aSatisfactionThreshold);
+
+	int GetGeneration() const { return myIslands.empty() ? -1 : myIslands[0]->GetGeneration(); }
+	const Genome* GetBestGenome() const;
+
+	// Of the last TrainGenerations
+	struct Stats
+	{
+		double myDurationSec = 0.0;
+		double myMigrationsDurationSec = 0.0; // Serial part, when the islands wait for each other
+		size_t myMigrationsCount = 0;
+		int myGenerationsCount = 0;
+	};
+	const Stats& GetStats() const { return myStats; }
+
+private:
+	void CollectEmigrants(size_t anIslandIdx);
+	void Migrate();
+
+	std::vector<std::unique_ptr<Population>> myIslands;
+
+	Topology myTopology = Topology::Ring;
+	int myMigrationInterval = 0;
+	size_t myMigrantsCount = 0;
+
+	int myLastEpochGeneration = 0; // Generation after which the islands migrate
+	std::vector<std::vector<Genome>> myEmigrants; // Best evaluated genomes of each island, sorted by fitness
+
+	Stats myStats;
+};
+
+}
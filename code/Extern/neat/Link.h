@@ -1,42 +1,55 @@
 #pragma once
 
 #include <atomic>
+#include <cassert>
+#include <cstdint>
 #include <string>
 
 namespace Neat {
 
 class Node;
 
+// Compact gene, the genomes store them in arrays sorted by innovation id
 class Link
 {
 public:
-	Link(size_t anSrcNodeIdx, size_t anDstNodeIdx, double aWeight, bool anEnable)
-		: mySrcNodeIdx(anSrcNodeIdx)
-		, myDstNodeIdx(anDstNodeIdx)
-		, myWeight(aWeight)
+	// The innovation ids are stored on 32 bits. The populations keep the ids of their mutations under
+	// EvolutionParams::myMutationInnovationIdsEnd, which is at most ourMaxInnovationId + 1.
+	static constexpr std::uint64_t ourMaxInnovationId = UINT32_MAX;
+
+	Link(std::uint64_t anInnovationId, size_t anSrcNodeIdx, size_t anDstNodeIdx, double aWeight, bool anEnable)
+		: myInnovationId(static_cast<std::uint32_t>(anInnovationId))
+		, mySrcNodeIdx(static_cast<std::uint32_t>(anSrcNodeIdx))
+		, myDstNodeIdx(static_cast<std::uint32_t>(anDstNodeIdx))
 		, myEnabled(anEnable)
-	{}
+		, myWeight(static_cast<float>(aWeight))
+	{
+		assert(anInnovationId <= ourMaxInnovationId);
+	}
 
+	std::uint64_t GetInnovationId() const { return myInnovationId; }
 	size_t GetSrcNodeIdx() const { return mySrcNodeIdx; }
 	size_t GetDstNodeIdx() const { return myDstNodeIdx; }
 	double GetWeight() const { return myWeight; }
-	bool IsEnabled() const { return myEnabled; }
+	bool IsEnabled() const { return myEnabled != 0; }
 
 	bool IsSplittable() const;
 
-	void UpdateAfterNodeAdd(size_t aNewNodeIdx);
-	void UpdateAfterNodeMove(size_t anOldNodeIdx, size_t aNewNodeIdx);
-	void SetWeight(double aWeight) { myWeight = aWeight; }
+	void SetWeight(double aWeight) { myWeight = static_cast<float>(aWeight); }
 	void SetEnabled(bool aEnable) { myEnabled = aEnable; }
+	void SetInnovationId(std::uint64_t anInnovationId)
+	{
+		assert(anInnovationId <= ourMaxInnovationId);
+		myInnovationId = static_cast<std::uint32_t>(anInnovationId);
+	}
 
 private:
-	void UpdateIdxAfterNodeAdd(size_t& aInOutNodeIdx, size_t aNewNodeIdx);
-	void UpdateIdxAfterNodeMove(size_t& aInOutNodeIdx, size_t anOldNodeIdx, size_t aNewNodeIdx);
-
-	size_t mySrcNodeIdx;
-	size_t myDstNodeIdx;
-	double myWeight;
-	bool myEnabled;
+	std::uint32_t myInnovationId;
+	std::uint32_t mySrcNodeIdx;	// Node indices are stable, they don't depend on the execution order
+	std::uint32_t myDstNodeIdx : 31;
+	std::uint32_t myEnabled : 1;
+	float myWeight;
 };
+static_assert(sizeof(Link) == 16);
 
 }
@@ -0,0 +1,66 @@
+#include "LinkIndex.h"
+
+namespace Neat {
+
+void LinkIndex::Clear()
+{
+	myEntries.clear();
+	myCount = 0;
+}
+
+void LinkIndex::Insert(std::size_t aSrcNodeIdx, std::size_t aDstNodeIdx, std::uint64_t anInnovationId)
+{
+	// Keep the load factor under 1/2, so that probing sequences stay short
+	if (2 * (myCount + 1) > myEntries.size())
+		Grow();
+
+	std::uint64_t key = GetKey(aSrcNodeIdx, aDstNodeIdx);
+	Entry& entry = myEntries[FindEntry(key)];
+	if (entry.myKey == ourEmptyKey)
+	{
+		entry.myKey = key;
+		myCount++;
+	}
+	entry.myInnovationId = anInnovationId;
+}
+
+bool LinkIndex::Find(std::size_t aSrcNodeIdx, std::size_t aDstNodeIdx, std::uint64_t& anOutInnovationId) const
+{
+	if (myEntries.empty())
+		return false;
+
+	const Entry& entry = myEntries[FindEntry(GetKey(aSrcNodeIdx, aDstNodeIdx))];
+	if (entry.myKey == ourEmptyKey)
+		return false;
+
+	anOutInnovationId = entry.myInnovationId;
+	return true;
+}
+
+std::uint64_t LinkIndex::GetKey(std::size_t aSrcNodeIdx, std::size_t aDstNodeIdx)
+{
+	return (static_cast<std::uint64_t>(aSrcNodeIdx) << 32) | static_cast<std::uint64_t>(aDstNodeIdx);
+}
+
+std::size_t LinkIndex::FindEntry(std::uint64_t aKey) const
+{
+	// Fibonacci hashing, then linear probing
+	std::size_t mask = myEntries.size() - 1;
+	std::size_t idx = static_cast<std::size_t>((aKey * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+	while (myEntries[idx].myKey != ourEmptyKey && myEntries[idx].myKey != aKey)
+		idx = (idx + 1) & mask;
+	return idx;
+}
+
+void LinkIndex::Grow()
+{
+	std::vector<Entry> oldEntries;
+	oldEntries.swap(myEntries);
+	myEntries.resize(oldEntries.empty() ? 16 : 2 * oldEntries.size());
+
+	for (const Entry& entry : oldEntries)
+		if (entry.myKey != ourEmptyKey)
+			myEntries[FindEntry(entry.myKey)] = entry;
+}
+
+}
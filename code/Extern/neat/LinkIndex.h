@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Neat {
+
+// Hash index of the links of a genome, keyed on their source and destination nodes.
+// Uses open addressing in a single array, so that copying a genome stays cheap.
+class LinkIndex
+{
+public:
+	void Clear();
+	void Insert(std::size_t aSrcNodeIdx, std::size_t aDstNodeIdx, std::uint64_t anInnovationId); // Replaces the innovation id if the link is already indexed
+	bool Find(std::size_t aSrcNodeIdx, std::size_t aDstNodeIdx, std::uint64_t& anOutInnovationId) const;
+
+	std::size_t GetSize() const { return myCount; }
+
+private:
+	static constexpr std::uint64_t ourEmptyKey = UINT64_MAX;
+
+	struct Entry
+	{
+		std::uint64_t myKey = ourEmptyKey;
+		std::uint64_t myInnovationId = 0;
+	};
+
+	static std::uint64_t GetKey(std::size_t aSrcNodeIdx, std::size_t aDstNodeIdx);
+	std::size_t FindEntry(std::uint64_t aKey) const; // Index of the entry of aKey, or of the empty entry where it would be inserted
+	void Grow();
+
+	std::vector<Entry> myEntries; // The size is 0 or a power of 2
+	std::size_t myCount = 0;
+};
+
+}
@@ -20,23 +20,40 @@ public:
 		Output,
 	};
 
-	Node(Type aType)
+	// Hidden nodes keys are ourHiddenNodeKeyFlag | the innovation id of the link they split,
+	// so that the same node created in different genomes has the same key
+	static constexpr std::uint64_t ourHiddenNodeKeyFlag = 1ull << 63;
+
+	Node(Type aType, std::uint64_t aKey)
 		: myType(aType)
+		, myKey(aKey)
 	{}
 
 	Type GetType() const { return myType; }
+	std::uint64_t GetKey() const { return myKey; } // Identifies the node across genomes, unlike its index
+	void SetKey(std::uint64_t aKey) { myKey = aKey; }
 	const std::set<std::uint64_t>& GetInputLinks() const { return myInputLinks; }
-	void AddInputLink(std::uint64_t anLinkId) { myInputLinks.insert(anLinkId); }
-	void SetInputValue(double aValue) { myInputValue = aValue; }
-	double GetOutputValue() const { return myOutputValue; }
+	const std::vector<std::uint32_t>& GetInputNodes() const { return myInputNodes; }
+	const std::vector<std::uint32_t>& GetOutputNodes() const { return myOutputNodes; }
 
-	void Evaluate(const std::vector<Node>& someNodes, const std::map<std::uint64_t, Link>& someLinks);
+	void AddInputLink(std::uint64_t anLinkId, size_t aSrcNodeIdx)
+	{
+		myInputLinks.insert(anLinkId);
+		myInputNodes.push_back(static_cast<std::uint32_t>(aSrcNodeIdx));
+	}
+	void ReplaceInputLink(std::uint64_t anOldLinkId, std::uint64_t aNewLinkId)
+	{
+		myInputLinks.erase(anOldLinkId);
+		myInputLinks.insert(aNewLinkId);
+	}
+	void AddOutputNode(size_t aDstNodeIdx) { myOutputNodes.push_back(static_cast<std::uint32_t>(aDstNodeIdx)); }
 
 private:
 	Type myType = Type::Input;
+	std::uint64_t myKey = 0;
 	std::set<std::uint64_t> myInputLinks;
-	double myInputValue = 0.0;
-	double myOutputValue = 0.0;
+	std::vector<std::uint32_t> myInputNodes;	// Source of every input link, used to walk the graph
+	std::vector<std::uint32_t> myOutputNodes;	// Destination of every output link
 };
 
 }
@@ -0,0 +1,442 @@
+#include "Phenotype.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define NEAT_SIMD_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NEAT_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace Neat {
+
+namespace {
+	const double ourSigmoidSlope = 4.924273;
+
+	std::uint64_t HashCombine(std::uint64_t aHash, std::uint64_t aValue)
+	{
+		// SplitMix64 finalizer of the combined value
+		aHash ^= aValue + 0x9E3779B97F4A7C15ull + (aHash << 6) + (aHash >> 2);
+		aHash = (aHash ^ (aHash >> 30)) * 0xBF58476D1CE4E5B9ull;
+		aHash = (aHash ^ (aHash >> 27)) * 0x94D049BB133111EBull;
+		return aHash ^ (aHash >> 31);
+	}
+
+	template<typename T>
+	std::uint64_t HashValues(std::uint64_t aHash, const std::vector<T>& someValues)
+	{
+		aHash = HashCombine(aHash, someValues.size());
+		for (const T& value : someValues)
+		{
+			// The bits of the weights
+			std::uint64_t bits = 0;
+			std::memcpy(&bits, &value, sizeof(T));
+			aHash = HashCombine(aHash, bits);
+		}
+		return aHash;
+	}
+
+	template<typename T>
+	T ExactSigmoid(T anInput)
+	{
+		return T(1) / (T(1) + std::exp(-anInput * T(ourSigmoidSlope)));
+	}
+
+	// sigmoid(x) = (1 + tanh(x / 2)) / 2, with tanh replaced by its [7/6] Pade approximant.
+	// The approximant reaches 1 around 4.97, clamping there keeps the error under 5e-5, see Phenotype::ourRationalMaxError.
+	template<typename T>
+	T RationalSigmoid(T anInput)
+	{
+		const T x = std::clamp(anInput * T(ourSigmoidSlope / 2.0), T(-4.97), T(4.97));
+		const T x2 = x * x;
+		const T tanh = x * (T(135135) + x2 * (T(17325) + x2 * (T(378) + x2)))
+			/ (T(135135) + x2 * (T(62370) + x2 * (T(3150) + x2 * T(28))));
+		return T(0.5) + T(0.5) * tanh;
+	}
+
+	// Sigmoid sampled over [-16, 16] (before the slope), the error of the linear interpolation stays under 1e-6, see
+	// Phenotype::ourTableMaxError
+	template<typename T>
+	struct SigmoidTable
+	{
+		static constexpr size_t ourSize = 4096;
+		static constexpr double ourRange = 16.0;
+		static constexpr double ourScale = ourSize / (2.0 * ourRange);
+
+		SigmoidTable()
+		{
+			for (size_t i = 0; i <= ourSize; ++i)
+				myValues[i] = static_cast<T>(1.0 / (1.0 + std::exp(-(static_cast<double>(i) / ourScale - ourRange))));
+		}
+
+		std::array<T, ourSize + 1> myValues;
+	};
+
+	template<typename T>
+	T TableSigmoid(T anInput)
+	{
+		static const SigmoidTable<T> table;
+
+		const T position = std::clamp((anInput * T(ourSigmoidSlope) + T(SigmoidTable<T>::ourRange)) * T(SigmoidTable<T>::ourScale), T(0), T(SigmoidTable<T>::ourSize));
+		const size_t idx = std::min(static_cast<size_t>(position), SigmoidTable<T>::ourSize - 1);
+		const T alpha = position - static_cast<T>(idx);
+		return table.myValues[idx] + (table.myValues[idx + 1] - table.myValues[idx]) * alpha;
+	}
+
+	template<typename T, Phenotype::Activation A>
+	T Activate(T anInput)
+	{
+		if constexpr (A == Phenotype::Activation::Rational)
+			return RationalSigmoid(anInput);
+		else if constexpr (A == Phenotype::Activation::Table)
+			return TableSigmoid(anInput);
+		else
+			return ExactSigmoid(anInput);
+	}
+
+	// Thin wrappers so the batch evaluation can be written once for both precisions
+	template<typename T> struct Simd { static constexpr size_t ourWidth = 1; };
+#if NEAT_SIMD_AVX2
+	template<> struct Simd<double>
+	{
+		using Register = __m256d;
+		static constexpr size_t ourWidth = 4;
+		static Register Zero() { return _mm256_setzero_pd(); }
+		static Register Set(double aValue) { return _mm256_set1_pd(aValue); }
+		static Register Load(const double* aPtr) { return _mm256_loadu_pd(aPtr); }
+		static void Store(double* aPtr, Register aValue) { _mm256_storeu_pd(aPtr, aValue); }
+		static Register MulAdd(Register aSum, Register aValue, Register aWeight) { return _mm256_add_pd(aSum, _mm256_mul_pd(aValue, aWeight)); }
+		static Register Add(Register aLeft, Register aRight) { return _mm256_add_pd(aLeft, aRight); }
+		static Register Mul(Register aLeft, Register aRight) { return _mm256_mul_pd(aLeft, aRight); }
+		static Register Div(Register aLeft, Register aRight) { return _mm256_div_pd(aLeft, aRight); }
+		static Register Clamp(Register aValue, Register aMin, Register aMax) { return _mm256_min_pd(_mm256_max_pd(aValue, aMin), aMax); }
+	};
+	template<> struct Simd<float>
+	{
+		using Register = __m256;
+		static constexpr size_t ourWidth = 8;
+		static Register Zero() { return _mm256_setzero_ps(); }
+		static Register Set(float aValue) { return _mm256_set1_ps(aValue); }
+		static Register Load(const float* aPtr) { return _mm256_loadu_ps(aPtr); }
+		static void Store(float* aPtr, Register aValue) { _mm256_storeu_ps(aPtr, aValue); }
+		static Register MulAdd(Register aSum, Register aValue, Register aWeight) { return _mm256_add_ps(aSum, _mm256_mul_ps(aValue, aWeight)); }
+		static Register Add(Register aLeft, Register aRight) { return _mm256_add_ps(aLeft, aRight); }
+		static Register Mul(Register aLeft, Register aRight) { return _mm256_mul_ps(aLeft, aRight); }
+		static Register Div(Register aLeft, Register aRight) { return _mm256_div_ps(aLeft, aRight); }
+		static Register Clamp(Register aValue, Register aMin, Register aMax) { return _mm256_min_ps(_mm256_max_ps(aValue, aMin), aMax); }
+	};
+#elif NEAT_SIMD_SSE2
+	template<> struct Simd<double>
+	{
+		using Register = __m128d;
+		static constexpr size_t ourWidth = 2;
+		static Register Zero() { return _mm_setzero_pd(); }
+		static Register Set(double aValue) { return _mm_set1_pd(aValue); }
+		static Register Load(const double* aPtr) { return _mm_loadu_pd(aPtr); }
+		static void Store(double* aPtr, Register aValue) { _mm_storeu_pd(aPtr, aValue); }
+		static Register MulAdd(Register aSum, Register aValue, Register aWeight) { return _mm_add_pd(aSum, _mm_mul_pd(aValue, aWeight)); }
+		static Register Add(Register aLeft, Register aRight) { return _mm_add_pd(aLeft, aRight); }
+		static Register Mul(Register aLeft, Register aRight) { return _mm_mul_pd(aLeft, aRight); }
+		static Register Div(Register aLeft, Register aRight) { return _mm_div_pd(aLeft, aRight); }
+		static Register Clamp(Register aValue, Register aMin, Register aMax) { return _mm_min_pd(_mm_max_pd(aValue, aMin), aMax); }
+	};
+	template<> struct Simd<float>
+	{
+		using Register = __m128;
+		static constexpr size_t ourWidth = 4;
+		static Register Zero() { return _mm_setzero_ps(); }
+		static Register Set(float aValue) { return _mm_set1_ps(aValue); }
+		static Register Load(const float* aPtr) { return _mm_loadu_ps(aPtr); }
+		static void Store(float* aPtr, Register aValue) { _mm_storeu_ps(aPtr, aValue); }
+		static Register MulAdd(Register aSum, Register aValue, Register aWeight) { return _mm_add_ps(aSum, _mm_mul_ps(aValue, aWeight)); }
+		static Register Add(Register aLeft, Register aRight) { return _mm_add_ps(aLeft, aRight); }
+		static Register Mul(Register aLeft, Register aRight) { return _mm_mul_ps(aLeft, aRight); }
+		static Register Div(Register aLeft, Register aRight) { return _mm_div_ps(aLeft, aRight); }
+		static Register Clamp(Register aValue, Register aMin, Register aMax) { return _mm_min_ps(_mm_max_ps(aValue, aMin), aMax); }
+	};
+#endif
+
+	// Applies the activation to a row of samples, only the rational approximation is vectorized.
+	// The vectorized path does the same operations in the same order as RationalSigmoid.
+	template<typename T, Phenotype::Activation A>
+	void ActivateRow(T* aRow, size_t aCount)
+	{
+		size_t s = 0;
+#if NEAT_SIMD_AVX2 || NEAT_SIMD_SSE2
+		if constexpr (A == Phenotype::Activation::Rational)
+		{
+			using S = Simd<T>;
+			const typename S::Register halfSlope = S::Set(T(ourSigmoidSlope / 2.0));
+			const typename S::Register min = S::Set(T(-4.97));
+			const typename S::Register max = S::Set(T(4.97));
+			const typename S::Register half = S::Set(T(0.5));
+			for (; s + S::ourWidth <= aCount; s += S::ourWidth)
+			{
+				const typename S::Register x = S::Clamp(S::Mul(S::Load(aRow + s), halfSlope), min, max);
+				const typename S::Register x2 = S::Mul(x, x);
+				const typename S::Register numerator = S::Mul(x, S::Add(S::Set(T(135135)), S::Mul(x2, S::Add(S::Set(T(17325)), S::Mul(x2, S::Add(S::Set(T(378)), x2))))));
+				const typename S::Register denominator = S::Add(S::Set(T(135135)), S::Mul(x2, S::Add(S::Set(T(62370)), S::Mul(x2, S::Add(S::Set(T(3150)), S::Mul(x2, S::Set(T(28))))))));
+				S::Store(aRow + s, S::Add(half, S::Mul(half, S::Div(numerator, denominator))));
+			}
+		}
+#endif
+		for (; s < aCount; ++s)
+			aRow[s] = Activate<T, A>(aRow[s]);
+	}
+	// Sweeps the inputs through ActivateRow, to check the vectorized path as well, up to past the clamps of the
+	// approximations. The reference is the double precision sigmoid of the inputs rounded to T.
+	template<typename T, Phenotype::Activation A>
+	double MeasureActivationErrorImpl()
+	{
+		const size_t samplesCount = 1 << 20;
+		const double range = 4.0;
+
+		std::vector<T> inputs(samplesCount + 1);
+		for (size_t i = 0; i <= samplesCount; ++i)
+			inputs[i] = static_cast<T>(-range + 2.0 * range * static_cast<double>(i) / static_cast<double>(samplesCount));
+
+		std::vector<T> outputs = inputs;
+		ActivateRow<T, A>(outputs.data(), outputs.size());
+
+		double maxError = 0.0;
+		for (size_t i = 0; i <= samplesCount; ++i)
+			maxError = std::max(maxError, std::abs(static_cast<double>(outputs[i]) - ExactSigmoid(static_cast<double>(inputs[i]))));
+		return maxError;
+	}
+}
+
+template<> Phenotype::Buffers<double>& Phenotype::GetBuffers<double>() { return myDoubleBuffers; }
+template<> Phenotype::Buffers<float>& Phenotype::GetBuffers<float>() { return myFloatBuffers; }
+
+double Phenotype::GetActivationMaxError(Activation anActivation)
+{
+	switch (anActivation)
+	{
+	case Activation::Rational: return ourRationalMaxError;
+	case Activation::Table: return ourTableMaxError;
+	default: return ourExactMaxError;
+	}
+}
+
+double Phenotype::MeasureActivationError(Precision aPrecision, Activation anActivation)
+{
+	switch (aPrecision)
+	{
+	case Precision::Float:
+		switch (anActivation)
+		{
+		case Activation::Rational: return MeasureActivationErrorImpl<float, Activation::Rational>();
+		case Activation::Table: return MeasureActivationErrorImpl<float, Activation::Table>();
+		default: return MeasureActivationErrorImpl<float, Activation::Exact>();
+		}
+	default:
+		switch (anActivation)
+		{
+		case Activation::Rational: return MeasureActivationErrorImpl<double, Activation::Rational>();
+		case Activation::Table: return MeasureActivationErrorImpl<double, Activation::Table>();
+		default: return MeasureActivationErrorImpl<double, Activation::Exact>();
+		}
+	}
+}
+
+void Phenotype::Clear()
+{
+	myPrecision = Precision::Double;
+	myActivation = Activation::Exact;
+	myInputCount = 0;
+	myLinkOffsets.clear();
+	myLinkSources.clear();
+	myOutputIndices.clear();
+	myDoubleBuffers.myLinkWeights.clear();
+	myDoubleBuffers.myValues.clear();
+	myDoubleBuffers.myBatchValues.clear();
+	myFloatBuffers.myLinkWeights.clear();
+	myFloatBuffers.myValues.clear();
+	myFloatBuffers.myBatchValues.clear();
+	myHash = 0;
+	myIsCompiled = false;
+}
+
+void Phenotype::BeginCompilation(size_t anInputCount, Precision aPrecision, Activation anActivation)
+{
+	Clear();
+	myInputCount = anInputCount;
+	myPrecision = aPrecision;
+	myActivation = anActivation;
+	myLinkOffsets.push_back(0);
+}
+
+void Phenotype::AddLink(std::uint32_t aSrcValueIdx, double aWeight)
+{
+	myLinkSources.push_back(aSrcValueIdx);
+	if (myPrecision == Precision::Float)
+		myFloatBuffers.myLinkWeights.push_back(static_cast<float>(aWeight));
+	else
+		myDoubleBuffers.myLinkWeights.push_back(aWeight);
+}
+
+void Phenotype::EndNode()
+{
+	myLinkOffsets.push_back(static_cast<std::uint32_t>(myLinkSources.size()));
+}
+
+void Phenotype::AddOutput(std::uint32_t aValueIdx)
+{
+	myOutputIndices.push_back(aValueIdx);
+}
+
+void Phenotype::EndCompilation(size_t aValuesCount)
+{
+	if (myPrecision == Precision::Float)
+		myFloatBuffers.myValues.resize(aValuesCount, 0.f);
+	else
+		myDoubleBuffers.myValues.resize(aValuesCount, 0.0);
+
+	myHash = HashCombine(static_cast<std::uint64_t>(myPrecision), static_cast<std::uint64_t>(myActivation));
+	myHash = HashCombine(myHash, myInputCount);
+	myHash = HashCombine(myHash, aValuesCount);
+	myHash = HashValues(myHash, myLinkOffsets);
+	myHash = HashValues(myHash, myLinkSources);
+	myHash = HashValues(myHash, myOutputIndices);
+	if (myPrecision == Precision::Float)
+		myHash = HashValues(myHash, myFloatBuffers.myLinkWeights);
+	else
+		myHash = HashValues(myHash, myDoubleBuffers.myLinkWeights);
+	myIsCompiled = true;
+}
+
+bool Phenotype::Evaluate(std::span<const double> someInputs, std::span<double> someOutputs)
+{
+	if (!myIsCompiled || someInputs.size() != myInputCount || someOutputs.size() != myOutputIndices.size())
+		return false;
+
+	switch (myPrecision)
+	{
+	case Precision::Float:
+		switch (myActivation)
+		{
+		case Activation::Rational: EvaluateImpl<float, Activation::Rational>(someInputs, someOutputs); break;
+		case Activation::Table: EvaluateImpl<float, Activation::Table>(someInputs, someOutputs); break;
+		default: EvaluateImpl<float, Activation::Exact>(someInputs, someOutputs); break;
+		}
+		break;
+	default:
+		switch (myActivation)
+		{
+		case Activation::Rational: EvaluateImpl<double, Activation::Rational>(someInputs, someOutputs); break;
+		case Activation::Table: EvaluateImpl<double, Activation::Table>(someInputs, someOutputs); break;
+		default: EvaluateImpl<double, Activation::Exact>(someInputs, someOutputs); break;
+		}
+		break;
+	}
+	return true;
+}
+
+bool Phenotype::EvaluateBatch(std::span<const double> someInputs, std::span<double> someOutputs, size_t aBatchSize)
+{
+	if (!myIsCompiled || someInputs.size() != myInputCount * aBatchSize || someOutputs.size() != myOutputIndices.size() * aBatchSize)
+		return false;
+
+	if (aBatchSize == 0)
+		return true;
+
+	switch (myPrecision)
+	{
+	case Precision::Float:
+		switch (myActivation)
+		{
+		case Activation::Rational: EvaluateBatchImpl<float, Activation::Rational>(someInputs, someOutputs, aBatchSize); break;
+		case Activation::Table: EvaluateBatchImpl<float, Activation::Table>(someInputs, someOutputs, aBatchSize); break;
+		default: EvaluateBatchImpl<float, Activation::Exact>(someInputs, someOutputs, aBatchSize); break;
+		}
+		break;
+	default:
+		switch (myActivation)
+		{
+		case Activation::Rational: EvaluateBatchImpl<double, Activation::Rational>(someInputs, someOutputs, aBatchSize); break;
+		case Activation::Table: EvaluateBatchImpl<double, Activation::Table>(someInputs, someOutputs, aBatchSize); break;
+		default: EvaluateBatchImpl<double, Activation::Exact>(someInputs, someOutputs, aBatchSize); break;
+		}
+		break;
+	}
+	return true;
+}
+
+template<typename T, Phenotype::Activation A>
+void Phenotype::EvaluateImpl(std::span<const double> someInputs, std::span<double> someOutputs)
+{
+	Buffers<T>& buffers = GetBuffers<T>();
+	const T* weights = buffers.myLinkWeights.data();
+	T* values = buffers.myValues.data();
+
+	values[0] = T(1);
+	for (size_t i = 0; i < myInputCount; ++i)
+		values[1 + i] = static_cast<T>(someInputs[i]);
+
+	T* evaluatedValues = values + 1 + myInputCount;
+	for (size_t i = 0, e = GetEvaluatedNodesCount(); i < e; ++i)
+	{
+		T sum = T(0);
+		for (std::uint32_t l = myLinkOffsets[i], le = myLinkOffsets[i + 1]; l < le; ++l)
+			sum += values[myLinkSources[l]] * weights[l];
+		evaluatedValues[i] = Activate<T, A>(sum);
+	}
+
+	for (size_t i = 0; i < myOutputIndices.size(); ++i)
+		someOutputs[i] = static_cast<double>(values[myOutputIndices[i]]);
+}
+
+template<typename T, Phenotype::Activation A>
+void Phenotype::EvaluateBatchImpl(std::span<const double> someInputs, std::span<double> someOutputs, size_t aBatchSize)
+{
+	Buffers<T>& buffers = GetBuffers<T>();
+	if (buffers.myBatchValues.size() < buffers.myValues.size() * aBatchSize)
+		buffers.myBatchValues.resize(buffers.myValues.size() * aBatchSize);
+
+	const T* weights = buffers.myLinkWeights.data();
+	T* values = buffers.myBatchValues.data();
+	std::fill(values, values + aBatchSize, T(1));
+	std::transform(someInputs.begin(), someInputs.end(), values + aBatchSize, [](double anInput) { return static_cast<T>(anInput); });
+
+	for (size_t i = 0, e = GetEvaluatedNodesCount(); i < e; ++i)
+	{
+		const std::uint32_t linkStart = myLinkOffsets[i];
+		const std::uint32_t linkEnd = myLinkOffsets[i + 1];
+		T* dst = values + (1 + myInputCount + i) * aBatchSize;
+
+		// Each link is a multiply-add over a row of samples, accumulated in registers.
+		// Multiply and add are kept separate (no FMA) so the rounding matches Evaluate.
+		size_t s = 0;
+#if NEAT_SIMD_AVX2 || NEAT_SIMD_SSE2
+		for (; s + Simd<T>::ourWidth <= aBatchSize; s += Simd<T>::ourWidth)
+		{
+			typename Simd<T>::Register sum = Simd<T>::Zero();
+			for (std::uint32_t l = linkStart; l < linkEnd; ++l)
+				sum = Simd<T>::MulAdd(sum, Simd<T>::Load(values + myLinkSources[l] * aBatchSize + s), Simd<T>::Set(weights[l]));
+			Simd<T>::Store(dst + s, sum);
+		}
+#endif
+		for (; s < aBatchSize; ++s)
+		{
+			T sum = T(0);
+			for (std::uint32_t l = linkStart; l < linkEnd; ++l)
+				sum += values[myLinkSources[l] * aBatchSize + s] * weights[l];
+			dst[s] = sum;
+		}
+
+		ActivateRow<T, A>(dst, aBatchSize);
+	}
+
+	for (size_t i = 0; i < myOutputIndices.size(); ++i)
+	{
+		const T* src = values + myOutputIndices[i] * aBatchSize;
+		std::transform(src, src + aBatchSize, someOutputs.begin() + i * aBatchSize, [](T aValue) { return static_cast<double>(aValue); });
+	}
+}
+
+}
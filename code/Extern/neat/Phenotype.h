@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Neat {
+
+// Flat, evaluation-only version of a Genome network.
+// Values are laid out as: Bias, Inputs, then the evaluated nodes (Hidden and Outputs) in execution order.
+// Disabled links and hidden nodes that don't contribute to any output are stripped.
+class Phenotype
+{
+public:
+	// Type used for the weights and the node values, inputs and outputs are always exchanged as double
+	enum class Precision
+	{
+		Double,
+		Float,
+	};
+
+	// Implementation of the sigmoid activation
+	enum class Activation
+	{
+		Exact,		// std::exp
+		Rational,	// Clamped Pade approximant of tanh, see ourRationalMaxError
+		Table,		// Clamped lookup table with linear interpolation, see ourTableMaxError
+	};
+
+	// Tolerances of the activations against the exact double precision sigmoid, for any input and both precisions.
+	// The exact one only has the rounding of the float precision.
+	static constexpr double ourExactMaxError = 1e-7;
+	static constexpr double ourRationalMaxError = 5e-5;
+	static constexpr double ourTableMaxError = 1e-6;
+	static double GetActivationMaxError(Activation anActivation);
+
+	// Max error of the activation over a dense sweep of the inputs, checked against the tolerance by NeatBench
+	static double MeasureActivationError(Precision aPrecision, Activation anActivation);
+
+	bool IsCompiled() const { return myIsCompiled; }
+	void Clear();
+
+	Precision GetPrecision() const { return myPrecision; }
+	Activation GetActivation() const { return myActivation; }
+
+	size_t GetInputCount() const { return myInputCount; }
+	size_t GetOutputCount() const { return myOutputIndices.size(); }
+	size_t GetEvaluatedNodesCount() const { return myLinkOffsets.empty() ? 0 : myLinkOffsets.size() - 1; }
+	size_t GetLinksCount() const { return myLinkSources.size(); }
+
+	// Of the structure, the weights, the precision and the activation, computed at compilation.
+	// Phenotypes with the same hash compute the same outputs, whatever the genes they were stripped from.
+	std::uint64_t GetHash() const { return myHash; }
+
+	// Doesn't allocate, uses a value buffer sized at compilation
+	bool Evaluate(std::span<const double> someInputs, std::span<double> someOutputs);
+
+	// Evaluates aBatchSize samples in one pass, inputs and outputs use a SoA layout:
+	// someInputs[i * aBatchSize + s] is the input i of the sample s, same for the outputs.
+	// Only allocates when the batch size grows, results are identical to Evaluate.
+	bool EvaluateBatch(std::span<const double> someInputs, std::span<double> someOutputs, size_t aBatchSize);
+
+private:
+	friend class Genome;
+
+	template<typename T>
+	struct Buffers
+	{
+		std::vector<T> myLinkWeights;
+		std::vector<T> myValues;
+		std::vector<T> myBatchValues; // SoA, one row of samples per value
+	};
+
+	template<typename T> Buffers<T>& GetBuffers();
+
+	// Used by Genome::Compile, nodes have to be added in execution order
+	void BeginCompilation(size_t anInputCount, Precision aPrecision, Activation anActivation);
+	void AddLink(std::uint32_t aSrcValueIdx, double aWeight);
+	void EndNode();
+	void AddOutput(std::uint32_t aValueIdx);
+	void EndCompilation(size_t aValuesCount);
+
+	template<typename T, Activation A>
+	void EvaluateImpl(std::span<const double> someInputs, std::span<double> someOutputs);
+	template<typename T, Activation A>
+	void EvaluateBatchImpl(std::span<const double> someInputs, std::span<double> someOutputs, size_t aBatchSize);
+
+	Precision myPrecision = Precision::Double;
+	Activation myActivation = Activation::Exact;
+	size_t myInputCount = 0;
+
+	// CSR layout: the input links of the evaluated node i are in [myLinkOffsets[i], myLinkOffsets[i + 1])
+	std::vector<std::uint32_t> myLinkOffsets;
+	std::vector<std::uint32_t> myLinkSources; // Index in the values
+	std::vector<std::uint32_t> myOutputIndices; // Index in the values
+
+	// Only the buffers of myPrecision are used
+	Buffers<double> myDoubleBuffers;
+	Buffers<float> myFloatBuffers;
+
+	std::uint64_t myHash = 0;
+	bool myIsCompiled = false;
+};
+
+}
@@ -1,33 +1,142 @@
 #include "Population.h"
 
+#include "Checkpoint.h"
 #include "EvolutionParams.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
 
 namespace Neat {
 
-Population::Population(size_t aCount, size_t anInputCount, size_t anOutputCount)
+namespace
 {
-	Genome baseGenome = Genome(anInputCount, anOutputCount);
+	// Keys of the streams forked from a generation stream
+	enum RandomStream : std::uint64_t
+	{
+		Initialization,
+		Speciation,
+		Offsprings,
+		Evaluation,
+		SteadyState,
+	};
+}
+
+Population::Population(size_t aCount, size_t anInputCount, size_t anOutputCount, const EvolutionParams& someParams /*= EvolutionParams()*/)
+	: myParams(someParams)
+	, myRandom(myParams.myRandomSeed)
+{
+	Random initRandom = GetGenerationRandom().Fork(RandomStream::Initialization);
+	Random baseRandom = initRandom.Fork(aCount);
+	Genome baseGenome = Genome(anInputCount, anOutputCount, baseRandom, myParams, ReserveInnovationNumbers((1 + anInputCount) * anOutputCount));
+	myNextInnovationId = std::max(myNextInnovationId.load(), myParams.myFirstMutationInnovationId);
 
+	std::uint64_t firstInnovationId = ReserveInnovationNumbers(aCount * EvolutionParams::ourMutationInnovationsCount);
 	myGenomes.reserve(aCount);
 	for (size_t i = 0; i < aCount; ++i)
 	{
+		Random genomeRandom = initRandom.Fork(i);
 		Genome& genome = myGenomes.emplace_back(baseGenome);
-		genome.Mutate();
+		genome.Mutate(genomeRandom, myParams, GetMutationInnovationId(firstInnovationId, i));
+		genome.ResolveInnovations(GetMutationInnovationId(firstInnovationId, i), myInnovationTable);
 	}
 }
 
-Population::Population(size_t aCount, const char* aFilePath)
+Population::Population(size_t aCount, const char* aFilePath, const EvolutionParams& someParams /*= EvolutionParams()*/)
+	: myParams(someParams)
+	, myRandom(myParams.myRandomSeed)
 {
+	// The innovation numbers follow the ones of the file
 	Genome baseGenome = Genome(aFilePath);
+	myNextInnovationId = std::max(EvolutionParams::GetNextInnovationNumber(), myParams.myFirstMutationInnovationId);
 
+	Random initRandom = GetGenerationRandom().Fork(RandomStream::Initialization);
+	std::uint64_t firstInnovationId = ReserveInnovationNumbers(aCount * EvolutionParams::ourMutationInnovationsCount);
 	myGenomes.reserve(aCount);
 	for (size_t i = 0; i < aCount; ++i)
 	{
+		Random genomeRandom = initRandom.Fork(i);
 		Genome& genome = myGenomes.emplace_back(baseGenome);
-		genome.Mutate();
+		genome.Mutate(genomeRandom, myParams, GetMutationInnovationId(firstInnovationId, i));
+		genome.ResolveInnovations(GetMutationInnovationId(firstInnovationId, i), myInnovationTable);
+	}
+}
+
+Population::Population(const char* aCheckpointPath)
+{
+	CheckpointReader reader(aCheckpointPath);
+	std::uint64_t nextInnovationId = 0;
+	if (!reader.IsValid() || !myParams.ReadCheckpoint(reader, nextInnovationId))
+		return;
+	myNextInnovationId = nextInnovationId;
+
+	reader.Read(myRandom);
+	reader.Read(myGeneration);
+	reader.Read(myLastImprovementGeneration);
+	reader.Read(myFitnessRecord);
+
+	std::uint64_t speciesCount = 0;
+	reader.Read(speciesCount);
+	for (std::uint64_t i = 0; i < speciesCount && reader.IsValid(); ++i)
+	{
+		mySpecies.push_back(new Specie(myParams, myNextSpecieId++));
+		mySpecies.back()->ReadCheckpoint(reader);
+	}
+
+	std::span<const std::uint64_t> genomeSpecies = reader.ReadArray<std::uint64_t>();
+	myGenomes.resize(genomeSpecies.size());
+	for (size_t i = 0; i < myGenomes.size() && reader.IsValid(); ++i)
+	{
+		if (!myGenomes[i].ReadCheckpoint(reader))
+			break;
+		if (genomeSpecies[i] < mySpecies.size())
+			myGenomes[i].SetSpecie(mySpecies[genomeSpecies[i]]);
 	}
+
+	if (!reader.IsValid())
+	{
+		// Don't resume from a partial state
+		myGenomes.clear();
+		for (Specie* specie : mySpecies)
+			delete specie;
+		mySpecies.clear();
+	}
+}
+
+bool Population::SaveCheckpoint(const char* aCheckpointPath) const
+{
+	CheckpointWriter writer;
+	myParams.WriteCheckpoint(writer, myNextInnovationId.load());
+
+	writer.Write(myRandom);
+	writer.Write(myGeneration);
+	writer.Write(myLastImprovementGeneration);
+	writer.Write(myFitnessRecord);
+
+	writer.Write<std::uint64_t>(mySpecies.size());
+	for (const Specie* specie : mySpecies)
+		specie->WriteCheckpoint(writer);
+
+	// The genomes refer to their specie by index
+	std::unordered_map<const Specie*, std::uint64_t> specieIndices;
+	for (size_t i = 0; i < mySpecies.size(); ++i)
+		specieIndices[mySpecies[i]] = i;
+
+	std::vector<std::uint64_t> genomeSpecies(myGenomes.size(), UINT64_MAX);
+	for (size_t i = 0; i < myGenomes.size(); ++i)
+	{
+		auto it = specieIndices.find(myGenomes[i].GetSpecie());
+		if (it != specieIndices.end())
+			genomeSpecies[i] = it->second;
+	}
+	writer.WriteArray<std::uint64_t>(genomeSpecies);
+
+	for (const Genome& genome : myGenomes)
+		genome.WriteCheckpoint(writer);
+
+	return writer.Commit(aCheckpointPath);
 }
 
 Population::~Population()
@@ -36,30 +145,74 @@ Population::~Population()
 		delete specie;
 }
 
-bool Population::Check() const
+bool Population::Check(double aSampledFraction /*= 1.0*/) const
 {
-	for (const Genome& genome : myGenomes)
-		if (!genome.Check())
-			return false;
-	return true;
+	using Clock = std::chrono::steady_clock;
+
+	Clock::time_point start = Clock::now();
+	size_t sampledCount = myGenomes.size();
+	if (aSampledFraction < 1.0)
+		sampledCount = std::min(myGenomes.size(), static_cast<size_t>(std::ceil(std::max(aSampledFraction, 0.0) * myGenomes.size())));
+
+	// The window doesn't use the random streams, so checking doesn't change the training
+	size_t firstIdx = myGenomes.empty() ? 0 : static_cast<size_t>(std::max(myGeneration, 0)) * sampledCount % myGenomes.size();
+	bool isValid = true;
+	for (size_t i = 0; i < sampledCount; ++i)
+	{
+		if (!myGenomes[(firstIdx + i) % myGenomes.size()].Check())
+		{
+			isValid = false;
+			break;
+		}
+	}
+
+	if (myTelemetry)
+		myTelemetry->AddPhaseDuration(Telemetry::Phase::Check, std::chrono::duration<double>(Clock::now() - start).count());
+	return isValid;
 }
 
 void Population::TrainOneGeneration(const TrainingCallbacks& someCallbacks)
 {
-	if (someCallbacks.myOnTrainGenerationStart)
-		someCallbacks.myOnTrainGenerationStart();
+	using Clock = std::chrono::steady_clock;
 
+	// An empty population trains nothing, so it doesn't begin a telemetry record that would never be committed
 	if (myGenomes.size() == 0)
 	{
+		if (someCallbacks.myOnTrainGenerationStart)
+			someCallbacks.myOnTrainGenerationStart();
 		if (someCallbacks.myOnTrainGenerationEnd)
 			someCallbacks.myOnTrainGenerationEnd();
 		return;
 	}
 
-	StartGeneration();
+	// The generation is started by StartGeneration
+	Clock::time_point generationStart = Clock::now();
+	if (myTelemetry)
+		myTelemetry->BeginGeneration(myGeneration + 1);
+
+	if (someCallbacks.myOnTrainGenerationStart)
+		someCallbacks.myOnTrainGenerationStart();
+
+	Clock::time_point phaseStart = Clock::now();
+	auto endPhase = [this, &phaseStart](Telemetry::Phase aPhase) {
+		Clock::time_point now = Clock::now();
+		if (myTelemetry)
+			myTelemetry->AddPhaseDuration(aPhase, std::chrono::duration<double>(now - phaseStart).count());
+		phaseStart = now;
+	};
+
+	StartGeneration(someCallbacks);
+	endPhase(Telemetry::Phase::Speciation);
 
+	LookUpFitnessCache(someCallbacks);
 	if (someCallbacks.myEvaluateGenomes)
 		someCallbacks.myEvaluateGenomes();
+	UpdateFitnessCache();
+	endPhase(Telemetry::Phase::Evaluation);
+
+	if (myTelemetry)
+		RecordGenomesStats();
+	phaseStart = Clock::now();
 
 	for (Neat::Specie* specie : mySpecies)
 		specie->ComputeBestFitness();
@@ -92,18 +245,7 @@ void Population::TrainOneGeneration(const TrainingCallbacks& someCallbacks)
 	}
 	else
 	{
-		if (mySpecies.size() > 2)
-		{
-			// The least performing old specie should go extinct
-			for (int i = (int)mySpecies.size() - 1; i >= 0; --i)
-			{
-				if (mySpecies[i]->IsOld())
-				{
-					mySpecies[i]->ShouldExtinct();
-					break;
-				}
-			}
-		}
+		MarkWorstOldSpecieExtinct();
 
 		for (Neat::Specie* specie : mySpecies)
 			specie->AdjustFitness();
@@ -115,15 +257,36 @@ void Population::TrainOneGeneration(const TrainingCallbacks& someCallbacks)
 		if (myGenomes.size() > offspringsCount && mySpecies.size() > 0)
 			mySpecies[0]->AllowExtraOffsprings(myGenomes.size() - offspringsCount);
 	}
+	endPhase(Telemetry::Phase::FitnessAdjustment);
 
-	// TODO : May want to parallelize this
-	for (Neat::Specie* specie : mySpecies)
-		specie->GenerateOffsprings();
-
+	GenerateOffsprings(someCallbacks);
 	EndGeneration();
+	endPhase(Telemetry::Phase::Reproduction);
 
 	if (someCallbacks.myOnTrainGenerationEnd)
 		someCallbacks.myOnTrainGenerationEnd();
+
+	if (myTelemetry)
+	{
+		Telemetry::GenerationRecord& record = myTelemetry->GetPendingRecord();
+		record.myBestFitness = bestFitness;
+		record.myDurationSec = std::chrono::duration<double>(Clock::now() - generationStart).count();
+		double evaluationSec = record.myPhaseDurationsSec[static_cast<size_t>(Telemetry::Phase::Evaluation)];
+		record.myEvaluationsPerSec = evaluationSec > 0.0 ? record.myEvaluationsCount / evaluationSec : 0.0;
+		myTelemetry->CommitGeneration();
+	}
+}
+
+void Population::AddImmigrants(const std::vector<const Genome*>& someImmigrants)
+{
+	// The last genomes are the offsprings of the worst species, the species are sorted before the reproduction
+	size_t immigrantsCount = std::min(someImmigrants.size(), myGenomes.size());
+	for (size_t i = 0; i < immigrantsCount; ++i)
+	{
+		Genome& genome = myGenomes[myGenomes.size() - 1 - i];
+		genome = *someImmigrants[i];
+		genome.SetSpecie(nullptr);
+	}
 }
 
 void Population::TrainGenerations(const TrainingCallbacks& someCallbacks, int aMaxGenerationCount, double aSatisfactionThreshold)
@@ -137,6 +300,225 @@ void Population::TrainGenerations(const TrainingCallbacks& someCallbacks, int aM
 	}
 }
 
+void Population::TrainSteadyState(const SteadyStateCallbacks& someCallbacks, size_t aWorkersCount, size_t aMaxEvaluationsCount, double aSatisfactionThreshold)
+{
+	using Clock = std::chrono::steady_clock;
+
+	mySteadyStateStats = SteadyStateStats();
+	if (myGenomes.size() == 0 || !someCallbacks.myEvaluateGenome)
+		return;
+
+	Clock::time_point start = Clock::now();
+	aWorkersCount = std::max<size_t>(aWorkersCount, 1);
+	auto runWorkers = [&someCallbacks, aWorkersCount](const std::function<void(size_t)>& aWorker) {
+		if (someCallbacks.myParallelFor)
+		{
+			someCallbacks.myParallelFor(aWorkersCount, aWorker);
+		}
+		else
+		{
+			for (size_t i = 0; i < aWorkersCount; ++i)
+				aWorker(i);
+		}
+	};
+
+	// The genomes are evaluated in place first, nothing can be bred before they all have a fitness
+	TrainingCallbacks speciationCallbacks;
+	speciationCallbacks.myParallelFor = someCallbacks.myParallelFor;
+	StartGeneration(speciationCallbacks);
+	std::atomic<size_t> nextGenomeIdx = 0;
+	runWorkers([this, &someCallbacks, &nextGenomeIdx](size_t aWorkerIdx) {
+		for (size_t genomeIdx = nextGenomeIdx++; genomeIdx < myGenomes.size(); genomeIdx = nextGenomeIdx++)
+			myGenomes[genomeIdx].SetFitness(someCallbacks.myEvaluateGenome(myGenomes[genomeIdx], aWorkerIdx));
+	});
+	mySteadyStateStats.myEvaluationsCount += myGenomes.size();
+	PrepareSteadyStateSpecies();
+
+	size_t startedCount = 0;
+	size_t replacementsCount = 0;
+	bool isSatisfied = GetBestGenome()->GetFitness() >= aSatisfactionThreshold;
+	runWorkers([&](size_t aWorkerIdx) {
+		Genome offspring;
+		std::uint64_t firstInnovationId = 0;
+		std::uint64_t specieId = 0;
+		for (;;)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mySteadyStateMutex);
+				if (isSatisfied || startedCount >= aMaxEvaluationsCount)
+					return;
+				startedCount++;
+				BreedSteadyStateOffspring(offspring, firstInnovationId, specieId);
+			}
+
+			// The only step out of the lock, the offspring belongs to this worker until it replaces a genome
+			offspring.SetFitness(someCallbacks.myEvaluateGenome(offspring, aWorkerIdx));
+
+			std::lock_guard<std::mutex> lock(mySteadyStateMutex);
+			isSatisfied |= offspring.GetFitness() >= aSatisfactionThreshold;
+			ReplaceWorstGenome(offspring, firstInnovationId, specieId);
+			mySteadyStateStats.myEvaluationsCount++;
+			if (++replacementsCount % std::max<size_t>(myParams.mySteadyStateRespeciationInterval, 1) == 0)
+			{
+				// The workers can't run a ParallelFor of their own
+				Respeciate(ParallelFor());
+				if (someCallbacks.myOnRespeciation)
+					someCallbacks.myOnRespeciation();
+			}
+		}
+	});
+
+	mySteadyStateStats.myDurationSec = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void Population::Respeciate(const ParallelFor& aParallelFor)
+{
+	myGeneration++;
+	mySteadyStateStats.myRespeciationsCount++;
+	Speciate(aParallelFor);
+	PrepareSteadyStateSpecies();
+}
+
+void Population::PrepareSteadyStateSpecies()
+{
+	myBreedingsCount = 0;
+	myInnovationTable.Clear();
+
+	for (Specie* specie : mySpecies)
+		specie->PrepareParents();
+
+	std::sort(mySpecies.begin(), mySpecies.end(), [](const Specie* aSpecie1, const Specie* aSpecie2) { return aSpecie1->GetBestFitness() > aSpecie2->GetBestFitness(); });
+	if (mySpecies.size() > 0 && mySpecies[0]->GetBestFitness() > myFitnessRecord)
+	{
+		myFitnessRecord = mySpecies[0]->GetBestFitness();
+		myLastImprovementGeneration = myGeneration;
+	}
+
+	MarkWorstOldSpecieExtinct();
+	for (Specie* specie : mySpecies)
+		specie->AdjustFitness();
+}
+
+void Population::BreedSteadyStateOffspring(Genome& anOutOffspring, std::uint64_t& anOutFirstInnovationId, std::uint64_t& anOutSpecieId)
+{
+	Random random = GetGenerationRandom().Fork(RandomStream::SteadyState).Fork(myBreedingsCount++);
+
+	// The parent specie is chosen in proportion to its adjusted fitness, as its share of the offsprings of a generation
+	double adjustedFitnessSum = 0.0;
+	for (const Specie* specie : mySpecies)
+		adjustedFitnessSum += specie->GetAdjustedFitnessSum();
+
+	std::uniform_real_distribution<> rand(0.0, adjustedFitnessSum);
+	double rng = rand(random);
+	Specie* parentSpecie = mySpecies.back();
+	for (Specie* specie : mySpecies)
+	{
+		rng -= specie->GetAdjustedFitnessSum();
+		if (rng <= 0.0)
+		{
+			parentSpecie = specie;
+			break;
+		}
+	}
+
+	anOutFirstInnovationId = GetMutationInnovationId(ReserveInnovationNumbers(EvolutionParams::ourMutationInnovationsCount), 0);
+	parentSpecie->BreedOffspring(anOutOffspring, random, anOutFirstInnovationId);
+
+	// The pointer is only valid under the lock
+	const Specie* offspringSpecie = anOutOffspring.GetSpecie();
+	anOutSpecieId = offspringSpecie ? offspringSpecie->GetId() : 0;
+	anOutOffspring.SetSpecie(nullptr);
+}
+
+void Population::ReplaceWorstGenome(Genome& anOffspring, std::uint64_t aFirstInnovationId, std::uint64_t aSpecieId)
+{
+	anOffspring.ResolveInnovations(aFirstInnovationId, myInnovationTable);
+
+	// The specie of the parent may have died out during the evaluation, and the offspring may have drifted away from it.
+	// The genomes only change specie when they are replaced, so a drifted offspring has to found its own specie here.
+	Specie* specie = nullptr;
+	if (aSpecieId != 0)
+	{
+		auto specieIt = std::find_if(mySpecies.begin(), mySpecies.end(), [aSpecieId](const Specie* aSpecie) { return aSpecie->GetId() == aSpecieId; });
+		if (specieIt != mySpecies.end() && (*specieIt)->BelongsToSpecie(&anOffspring))
+			specie = *specieIt;
+	}
+	if (!specie)
+	{
+		for (Specie* existingSpecie : mySpecies)
+		{
+			if (existingSpecie->BelongsToSpecie(&anOffspring))
+			{
+				specie = existingSpecie;
+				break;
+			}
+		}
+	}
+
+	// The species compete through the choice of the parents, the worst genome is the least fit one.
+	// Replacing by adjusted fitness instead lets the small species keep their poor genomes, and the species proliferate.
+	Genome* worstGenome = nullptr;
+	for (Genome& genome : myGenomes)
+	{
+		if (!worstGenome || genome.GetFitness() < worstGenome->GetFitness())
+			worstGenome = &genome;
+	}
+	if (!worstGenome)
+		return;
+
+	// The specie of the worst genome is deleted with it when it was its last genome
+	if (specie == worstGenome->GetSpecie() && specie->GetSize() == 1)
+		specie = nullptr;
+	RemoveFromSpecie(*worstGenome);
+
+	*worstGenome = std::move(anOffspring);
+	if (!specie)
+	{
+		specie = new Specie(myParams, myNextSpecieId++);
+		mySpecies.push_back(specie);
+	}
+	worstGenome->SetSpecie(specie);
+	specie->AddGenome(worstGenome);
+	if (!specie->GetRepresentative())
+	{
+		Random representativeRandom = GetGenerationRandom().Fork(RandomStream::Speciation).Fork(myBreedingsCount);
+		specie->ChooseRepresentative(representativeRandom);
+	}
+	specie->PrepareParents();
+	specie->AdjustFitness();
+
+	if (worstGenome->GetFitness() > myFitnessRecord)
+	{
+		myFitnessRecord = worstGenome->GetFitness();
+		myLastImprovementGeneration = myGeneration;
+	}
+}
+
+void Population::RemoveFromSpecie(Genome& aGenome)
+{
+	Specie* specie = aGenome.GetSpecie();
+	if (!specie)
+		return;
+
+	aGenome.SetSpecie(nullptr);
+	specie->RemoveGenome(&aGenome);
+	if (specie->GetSize() > 0)
+	{
+		// Keep a representative, or the next offsprings would all found new species
+		if (!specie->GetRepresentative())
+		{
+			Random representativeRandom = GetGenerationRandom().Fork(RandomStream::Speciation).Fork(myBreedingsCount);
+			specie->ChooseRepresentative(representativeRandom);
+		}
+		specie->PrepareParents();
+		specie->AdjustFitness();
+		return;
+	}
+
+	mySpecies.erase(std::find(mySpecies.begin(), mySpecies.end(), specie));
+	delete specie;
+}
+
 const Genome* Population::GetBestGenome() const
 {
 	const Genome* bestGenome = nullptr;
@@ -154,7 +536,115 @@ const Genome* Population::GetBestGenome() const
 
 bool Population::IsStagnant() const
 {
-	return myGeneration - myLastImprovementGeneration > EvolutionParams::ourPopulationStagnantThreshold;
+	return myGeneration - myLastImprovementGeneration > myParams.myPopulationStagnantThreshold;
+}
+
+Random Population::GetEvaluationRandom(size_t aGenomeIdx) const
+{
+	return GetGenerationRandom().Fork(RandomStream::Evaluation).Fork(aGenomeIdx);
+}
+
+void Population::ExcludeFromFitnessCache(size_t aGenomeIdx)
+{
+	if (aGenomeIdx < myCacheStates.size())
+		myCacheStates[aGenomeIdx] = CacheState::Excluded;
+}
+
+void Population::LookUpFitnessCache(const TrainingCallbacks& someCallbacks)
+{
+	myFitnessCacheStats = FitnessCacheStats();
+	myCacheKeys.resize(myGenomes.size());
+	myCacheStates.assign(myGenomes.size(), CacheState::Miss);
+	if (!myIsFitnessCacheEnabled)
+		return;
+
+	// The phenotypes are compiled anyway for the evaluation
+	auto computeKey = [this](size_t aGenomeIdx) {
+		std::uint64_t key = myGenomes[aGenomeIdx].GetPhenotypeHash();
+		myCacheKeys[aGenomeIdx] = key ^ (myEvaluationSeed * 0x9E3779B97F4A7C15ull);
+	};
+	if (someCallbacks.myParallelFor)
+	{
+		someCallbacks.myParallelFor(myGenomes.size(), computeKey);
+	}
+	else
+	{
+		for (size_t i = 0; i < myGenomes.size(); ++i)
+			computeKey(i);
+	}
+
+	for (size_t i = 0; i < myGenomes.size(); ++i)
+	{
+		auto it = myFitnessCache.find(myCacheKeys[i]);
+		if (it == myFitnessCache.end())
+			continue;
+
+		myGenomes[i].SetFitness(it->second);
+		myCacheStates[i] = CacheState::Hit;
+	}
+}
+
+void Population::UpdateFitnessCache()
+{
+	if (!myIsFitnessCacheEnabled)
+		return;
+
+	// Only the previous generation is kept, the champions and the unchanged offsprings carry their entries forward
+	myFitnessCache.clear();
+	for (size_t i = 0; i < myGenomes.size(); ++i)
+	{
+		if (myCacheStates[i] == CacheState::Excluded)
+			continue;
+
+		myFitnessCache.emplace(myCacheKeys[i], myGenomes[i].GetFitness());
+		if (myCacheStates[i] == CacheState::Hit)
+			myFitnessCacheStats.myHitsCount++;
+	}
+	myFitnessCacheStats.myLookUpsCount = myGenomes.size();
+}
+
+void Population::RecordGenomesStats()
+{
+	Telemetry::GenerationRecord& record = myTelemetry->GetPendingRecord();
+	record.myGenomesCount = myGenomes.size();
+	record.mySpeciesCount = mySpecies.size();
+	record.myEvaluationsCount = myGenomes.size() - myFitnessCacheStats.myHitsCount;
+
+	std::vector<size_t> linksCounts;
+	linksCounts.reserve(myGenomes.size());
+	size_t nodesCount = 0;
+	for (const Genome& genome : myGenomes)
+	{
+		linksCounts.push_back(genome.GetGenesCount());
+		nodesCount += genome.GetNodesCount();
+		record.myMaxNodesCount = std::max<std::uint64_t>(record.myMaxNodesCount, genome.GetNodesCount());
+	}
+
+	auto median = linksCounts.begin() + linksCounts.size() / 2;
+	std::nth_element(linksCounts.begin(), median, linksCounts.end());
+	record.myMedianLinksCount = *median;
+	record.myMinLinksCount = *std::min_element(linksCounts.begin(), linksCounts.end());
+	record.myMaxLinksCount = *std::max_element(linksCounts.begin(), linksCounts.end());
+	size_t linksCount = 0;
+	for (size_t count : linksCounts)
+		linksCount += count;
+	record.myAverageLinksCount = static_cast<double>(linksCount) / myGenomes.size();
+	record.myAverageNodesCount = static_cast<double>(nodesCount) / myGenomes.size();
+}
+
+std::uint64_t Population::GetMutationInnovationId(std::uint64_t aFirstReservedId, size_t aMutationIdx) const
+{
+	// The counter keeps going past the end of the range, the numbers after it are never given to a link
+	std::uint64_t firstInnovationId = aFirstReservedId + aMutationIdx * EvolutionParams::ourMutationInnovationsCount;
+	if (firstInnovationId + EvolutionParams::ourMutationInnovationsCount > myParams.myMutationInnovationIdsEnd)
+		return EvolutionParams::ourNoMutationInnovationId;
+	return firstInnovationId;
+}
+
+Random Population::GetGenerationRandom() const
+{
+	// The construction uses the generation -1
+	return myRandom.Fork(static_cast<std::uint64_t>(myGeneration + 1));
 }
 
 double Population::GetAverageAdjustedFitness() const
@@ -168,10 +658,21 @@ double Population::GetAverageAdjustedFitness() const
 	return averageAdjustedFitness / myGenomes.size();
 }
 
-void Population::StartGeneration()
+void Population::StartGeneration(const TrainingCallbacks& someCallbacks)
 {
 	myGeneration++;
 
+	for (Genome& genome : myGenomes)
+	{
+		genome.SetFitness(0.0);
+		genome.AdjustFitness(0.0);
+	}
+
+	Speciate(someCallbacks.myParallelFor);
+}
+
+void Population::Speciate(const ParallelFor& aParallelFor)
+{
 	// First remove all the genomes from the species
 	for (Specie* specie : mySpecies)
 	{
@@ -181,9 +682,6 @@ void Population::StartGeneration()
 	// And group all genomes (offsprings of the previous generation) that already know about their specie
 	for (Genome& genome : myGenomes)
 	{
-		genome.SetFitness(0.0);
-		genome.AdjustFitness(0.0);
-
 		if (Specie* specie = genome.GetSpecie())
 		{
 			specie->AddGenome(&genome);
@@ -206,32 +704,121 @@ void Population::StartGeneration()
 		++it;
 	}
 
-	// Finally group the remaining genomes in their species, creating new species as necessary
-	for (Genome& genome : myGenomes)
-	{
+	// Fix the representatives of the remaining species for this generation
+	Random speciationRandom = GetGenerationRandom().Fork(RandomStream::Speciation);
+	for (Specie* specie : mySpecies)
+		specie->ChooseRepresentative(speciationRandom);
+
+	// Then find the first existing specie of the remaining genomes, this only reads the representatives so it can run in parallel
+	size_t existingSpeciesCount = mySpecies.size();
+	myGenomeSpecies.assign(myGenomes.size(), nullptr);
+	auto findSpecie = [this, existingSpeciesCount](size_t aGenomeIdx) {
+		const Genome& genome = myGenomes[aGenomeIdx];
 		if (genome.GetSpecie())
-			continue;
+			return;
 
-		for (Specie* specie : mySpecies)
+		for (size_t i = 0; i < existingSpeciesCount; ++i)
 		{
-			if (specie->BelongsToSpecie(&genome))
+			if (mySpecies[i]->BelongsToSpecie(&genome))
 			{
-				genome.SetSpecie(specie);
-				specie->AddGenome(&genome);
-				break;
+				myGenomeSpecies[aGenomeIdx] = mySpecies[i];
+				return;
 			}
 		}
+	};
 
-		if (!genome.GetSpecie())
+	if (aParallelFor)
+	{
+		aParallelFor(myGenomes.size(), findSpecie);
+	}
+	else
+	{
+		for (size_t i = 0; i < myGenomes.size(); ++i)
+			findSpecie(i);
+	}
+
+	// Finally group the genomes in their species, creating new species as necessary
+	for (size_t i = 0; i < myGenomes.size(); ++i)
+	{
+		Genome& genome = myGenomes[i];
+		if (genome.GetSpecie())
+			continue;
+
+		Specie* specie = myGenomeSpecies[i];
+		for (size_t j = existingSpeciesCount; j < mySpecies.size() && !specie; ++j)
+		{
+			if (mySpecies[j]->BelongsToSpecie(&genome))
+				specie = mySpecies[j];
+		}
+
+		if (!specie)
+		{
+			specie = new Specie(myParams, myNextSpecieId++);
+			mySpecies.push_back(specie);
+		}
+
+		genome.SetSpecie(specie);
+		specie->AddGenome(&genome);
+		if (!specie->GetRepresentative())
+			specie->ChooseRepresentative(speciationRandom);
+	}
+}
+
+void Population::MarkWorstOldSpecieExtinct()
+{
+	if (mySpecies.size() <= 2)
+		return;
+
+	// The least performing old specie should go extinct, the species are sorted by best fitness
+	for (int i = (int)mySpecies.size() - 1; i >= 0; --i)
+	{
+		if (mySpecies[i]->IsOld())
 		{
-			Specie* newSpecie = new Specie;
-			genome.SetSpecie(newSpecie);
-			newSpecie->AddGenome(&genome);
-			mySpecies.push_back(newSpecie);
+			mySpecies[i]->ShouldExtinct();
+			break;
 		}
 	}
 }
 
+void Population::GenerateOffsprings(const TrainingCallbacks& someCallbacks)
+{
+	// Preallocate the offspring slots, each slot then only depends on its own random stream and innovation numbers,
+	// so the slots can be generated in any order with the same result
+	myOffspringSlots.clear();
+	for (size_t i = 0; i < mySpecies.size(); ++i)
+	{
+		size_t offspringsCount = mySpecies[i]->PrepareOffsprings();
+		for (size_t j = 0; j < offspringsCount; ++j)
+			myOffspringSlots.push_back({ mySpecies[i], i, j });
+	}
+
+	std::uint64_t firstInnovationId = ReserveInnovationNumbers(myOffspringSlots.size() * EvolutionParams::ourMutationInnovationsCount);
+	Random offspringsRandom = GetGenerationRandom().Fork(RandomStream::Offsprings);
+	auto generateOffspring = [this, firstInnovationId, &offspringsRandom](size_t aSlotIdx) {
+		const OffspringSlot& slot = myOffspringSlots[aSlotIdx];
+		Random random = offspringsRandom.Fork(slot.mySpecieIdx).Fork(slot.myOffspringIdx);
+		slot.mySpecie->GenerateOffspring(slot.myOffspringIdx, random, GetMutationInnovationId(firstInnovationId, aSlotIdx));
+	};
+
+	if (someCallbacks.myParallelFor)
+	{
+		someCallbacks.myParallelFor(myOffspringSlots.size(), generateOffspring);
+	}
+	else
+	{
+		for (size_t i = 0; i < myOffspringSlots.size(); ++i)
+			generateOffspring(i);
+	}
+
+	// Then give the same innovation number to the same structural mutations, in the slots order to stay deterministic
+	myInnovationTable.Clear();
+	for (size_t i = 0; i < myOffspringSlots.size(); ++i)
+	{
+		const OffspringSlot& slot = myOffspringSlots[i];
+		slot.mySpecie->GetOffspring(slot.myOffspringIdx).ResolveInnovations(GetMutationInnovationId(firstInnovationId, i), myInnovationTable);
+	}
+}
+
 void Population::EndGeneration()
 {
 	myGenomes.clear();
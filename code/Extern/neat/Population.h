@@ -1,9 +1,16 @@
 #pragma once
 
+#include "EvolutionParams.h"
 #include "Genome.h"
+#include "InnovationTable.h"
 #include "Specie.h"
+#include "Telemetry.h"
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace Neat {
@@ -11,24 +18,76 @@ namespace Neat {
 class Population
 {
 public:
-	Population(size_t aCount, size_t anInputCount, size_t anOutputCount);
-	Population(size_t aCount, const char* aFilePath);
+	// The params are copied, by default from the EvolutionParams::ourX of the moment
+	Population(size_t aCount, size_t anInputCount, size_t anOutputCount, const EvolutionParams& someParams = EvolutionParams());
+	Population(size_t aCount, const char* aFilePath, const EvolutionParams& someParams = EvolutionParams());
+	// Resumes from a checkpoint, restoring its params as well, the population is empty if it could not be loaded
+	explicit Population(const char* aCheckpointPath);
 	~Population();
 
-	bool Check() const; // Asserts that the genomes are not malformed
+	const EvolutionParams& GetParams() const { return myParams; }
+
+	// Saves the whole evolution state, to be called between generations
+	bool SaveCheckpoint(const char* aCheckpointPath) const;
+
+	// Asserts that the genomes are not malformed. A fraction below 1 only checks that share of the genomes, a window which
+	// moves every generation so that all the genomes get checked over the generations, to keep the checks in long trainings.
+	bool Check(double aSampledFraction = 1.0) const;
 
 	size_t GetSize() const { return myGenomes.size(); }
+	int GetGeneration() const { return myGeneration; }
 	
+	// Runs aJob for every index in [0, aCount) and waits for them, the jobs can run in parallel
+	using ParallelFor = std::function<void(size_t aCount, const std::function<void(size_t)>& aJob)>;
+
 	struct TrainingCallbacks
 	{
 		std::function<void()> myOnTrainGenerationStart;
 		std::function<void()> myOnTrainGenerationEnd; // Exposed for parallelization
 		
 		std::function<void()> myEvaluateGenomes;
+
+		// Used for the speciation and the reproduction, which run serially when not set
+		ParallelFor myParallelFor;
 	};
 	void TrainOneGeneration(const TrainingCallbacks& someCallbacks);
 	void TrainGenerations(const TrainingCallbacks& someCallbacks, int aMaxGenerationCount, double aSatisfactionThreshold);
 
+	// Steady-state training (rtNEAT): the workers don't wait for each other at the end of a generation, each one breeds
+	// an offspring, evaluates it and replaces the worst genome of the population with it.
+	// An offspring joins the specie of its parent when it is still compatible with its representative, else the first
+	// compatible specie or a new one. Every EvolutionParams::mySteadyStateRespeciationInterval replacements, which count
+	// as a generation, the species are aged and get new representatives, the empty ones are removed.
+	// Not deterministic: the replacements depend on the order the workers finish their evaluations.
+	struct SteadyStateCallbacks
+	{
+		// Returns the fitness of aGenome, called by all the workers at the same time with their own index
+		std::function<double(Genome& aGenome, size_t aWorkerIdx)> myEvaluateGenome;
+		// Called after each respeciation, the other workers keep evaluating but can't replace any genome meanwhile
+		std::function<void()> myOnRespeciation;
+
+		// Runs the workers, serially when not set
+		ParallelFor myParallelFor;
+	};
+	// The population is evaluated first, aMaxEvaluationsCount is the count of offsprings evaluated afterwards
+	void TrainSteadyState(const SteadyStateCallbacks& someCallbacks, size_t aWorkersCount, size_t aMaxEvaluationsCount, double aSatisfactionThreshold);
+
+	// Of the last TrainSteadyState
+	struct SteadyStateStats
+	{
+		double myDurationSec = 0.0;
+		size_t myEvaluationsCount = 0;
+		size_t myRespeciationsCount = 0;
+
+		double GetEvaluationsPerSec() const { return myDurationSec > 0.0 ? myEvaluationsCount / myDurationSec : 0.0; }
+	};
+	const SteadyStateStats& GetSteadyStateStats() const { return mySteadyStateStats; }
+
+	// Replaces the last genomes, the offsprings of the worst species, with copies of someImmigrants that are speciated at the
+	// next generation. To be called between generations, the immigrants must not share innovation numbers with this
+	// population for different structures, see EvolutionParams::myFirstMutationInnovationId.
+	void AddImmigrants(const std::vector<const Genome*>& someImmigrants);
+
 	Genome* GetGenome(size_t aGenomeIdx) { return aGenomeIdx < myGenomes.size() ? &myGenomes[aGenomeIdx] : nullptr; }
 	const Genome* GetBestGenome() const;
 
@@ -36,18 +95,110 @@ public:
 
 	bool IsStagnant() const;
 
+	// Stream for the evaluation of a genome during the current generation,
+	// keyed by the genome and not by the worker so that results don't depend on the workers count
+	Random GetEvaluationRandom(size_t aGenomeIdx) const;
+
+	// Fitness cache, for the deterministic evaluations only: the fitness must depend on nothing but the phenotype and the
+	// evaluation seed, so the tasks drawing their scenarios from GetEvaluationRandom can't use it.
+	// Before myEvaluateGenomes, the genomes whose phenotype was scored in the previous generation get their fitness back,
+	// the champions and the offsprings differing only by disabled or stripped genes, and the evaluators skip them.
+	void EnableFitnessCache(bool anEnable) { myIsFitnessCacheEnabled = anEnable; myFitnessCache.clear(); }
+	bool IsFitnessCacheEnabled() const { return myIsFitnessCacheEnabled; }
+	// Part of the cache keys, to change when the scenarios of the evaluation change
+	void SetEvaluationSeed(std::uint64_t aSeed) { myEvaluationSeed = aSeed; }
+	std::uint64_t GetEvaluationSeed() const { return myEvaluationSeed; }
+
+	bool IsFitnessCached(size_t aGenomeIdx) const { return aGenomeIdx < myCacheStates.size() && myCacheStates[aGenomeIdx] == CacheState::Hit; }
+	// Keeps the fitness of the genome out of the cache, when it isn't its exact score, e.g. pruned or relative to the others
+	void ExcludeFromFitnessCache(size_t aGenomeIdx);
+
+	// Of the last generation
+	struct FitnessCacheStats
+	{
+		size_t myLookUpsCount = 0;
+		size_t myHitsCount = 0;
+
+		double GetHitRate() const { return myLookUpsCount > 0 ? static_cast<double>(myHitsCount) / myLookUpsCount : 0.0; }
+	};
+	const FitnessCacheStats& GetFitnessCacheStats() const { return myFitnessCacheStats; }
+
+	// Records the phase durations and the statistics of every TrainOneGeneration into aTelemetry, which has to outlive the
+	// training. Null to stop recording.
+	void SetTelemetry(Telemetry* aTelemetry) { myTelemetry = aTelemetry; }
+	Telemetry* GetTelemetry() const { return myTelemetry; }
+
 private:
+	std::uint64_t ReserveInnovationNumbers(std::uint64_t aCount) { return myNextInnovationId.fetch_add(aCount); } // Returns the first reserved number
+	// First number of the mutation aMutationIdx of a reservation of several mutations, or
+	// EvolutionParams::ourNoMutationInnovationId once they are past EvolutionParams::myMutationInnovationIdsEnd
+	std::uint64_t GetMutationInnovationId(std::uint64_t aFirstReservedId, size_t aMutationIdx) const;
+
+	Random GetGenerationRandom() const;
+
 	double GetAverageAdjustedFitness() const;
 
-	void StartGeneration();
+	void StartGeneration(const TrainingCallbacks& someCallbacks);
+	void Speciate(const ParallelFor& aParallelFor);
+	void MarkWorstOldSpecieExtinct();
+	void GenerateOffsprings(const TrainingCallbacks& someCallbacks);
 	void EndGeneration();
 
+	void LookUpFitnessCache(const TrainingCallbacks& someCallbacks);
+	void UpdateFitnessCache();
+
+	void RecordGenomesStats(); // Into the pending record of myTelemetry, after the evaluation
+
+	// Steady-state steps, called with mySteadyStateMutex locked
+	void Respeciate(const ParallelFor& aParallelFor);
+	void PrepareSteadyStateSpecies();
+	// The offspring leaves the lock without a specie, as its specie can die out during the evaluation, and is given
+	// back the one of id anOutSpecieId if it still exists (0 for none)
+	void BreedSteadyStateOffspring(Genome& anOutOffspring, std::uint64_t& anOutFirstInnovationId, std::uint64_t& anOutSpecieId);
+	void ReplaceWorstGenome(Genome& anOffspring, std::uint64_t aFirstInnovationId, std::uint64_t aSpecieId);
+	void RemoveFromSpecie(Genome& aGenome);
+
+	EvolutionParams myParams;
+	std::atomic_uint64_t myNextInnovationId = 0;
+
 	std::vector<Genome> myGenomes;
 	std::vector<Specie*> mySpecies;
+	std::uint64_t myNextSpecieId = 1; // 0 is for no specie
+	std::vector<Specie*> myGenomeSpecies; // Specie found for each genome during the speciation
+
+	Random myRandom;
+
+	struct OffspringSlot
+	{
+		Specie* mySpecie = nullptr;
+		size_t mySpecieIdx = 0;
+		size_t myOffspringIdx = 0;
+	};
+	std::vector<OffspringSlot> myOffspringSlots;
+	InnovationTable myInnovationTable; // Structural innovations of the current generation, shared by its mutations
 
 	int myGeneration = -1;
 	int myLastImprovementGeneration = -1;
 	double myFitnessRecord = 0.0;
+
+	enum class CacheState : std::uint8_t
+	{
+		Miss,
+		Hit,
+		Excluded,
+	};
+	bool myIsFitnessCacheEnabled = false;
+	std::uint64_t myEvaluationSeed = 0;
+	std::unordered_map<std::uint64_t, double> myFitnessCache; // Fitness by key, of the genomes of the previous generation
+	std::vector<std::uint64_t> myCacheKeys; // Of every genome
+	std::vector<CacheState> myCacheStates; // Of every genome
+	FitnessCacheStats myFitnessCacheStats;
+
+	Telemetry* myTelemetry = nullptr;
+
+	std::mutex mySteadyStateMutex;
+	std::uint64_t myBreedingsCount = 0; // Of the current generation, keys the random stream of each offspring
+	SteadyStateStats mySteadyStateStats;
 };
 
 }
@@ -0,0 +1,42 @@
+#include "Random.h"
+
+namespace Neat {
+
+namespace {
+	std::uint64_t SplitMix64(std::uint64_t aValue)
+	{
+		aValue += 0x9E3779B97F4A7C15ull;
+		aValue = (aValue ^ (aValue >> 30)) * 0xBF58476D1CE4E5B9ull;
+		aValue = (aValue ^ (aValue >> 27)) * 0x94D049BB133111EBull;
+		return aValue ^ (aValue >> 31);
+	}
+}
+
+Random::Random(std::uint64_t aSeed, std::uint64_t aStream)
+	: mySeed(aSeed)
+	, myStream(aStream)
+{
+	// Standard PCG32 seeding, the increment has to be odd
+	myIncrement = (aStream << 1u) | 1u;
+	myState = 0;
+	(*this)();
+	myState += aSeed;
+	(*this)();
+}
+
+Random::result_type Random::operator()()
+{
+	std::uint64_t oldState = myState;
+	myState = oldState * 6364136223846793005ull + myIncrement;
+	std::uint32_t xorShifted = static_cast<std::uint32_t>(((oldState >> 18u) ^ oldState) >> 27u);
+	std::uint32_t rotation = static_cast<std::uint32_t>(oldState >> 59u);
+	return (xorShifted >> rotation) | (xorShifted << ((0u - rotation) & 31u));
+}
+
+Random Random::Fork(std::uint64_t aKey) const
+{
+	std::uint64_t key = SplitMix64(aKey);
+	return Random(SplitMix64(mySeed ^ key), SplitMix64(myStream + key));
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Neat {
+
+// PCG32 generator, usable with the std distributions.
+// A generator is identified by a seed and a stream: Fork derives child generators from this identity only,
+// so a child does not depend on how many numbers were drawn from its parent, nor on which thread uses it.
+class Random
+{
+public:
+	using result_type = std::uint32_t;
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return UINT32_MAX; }
+
+	explicit Random(std::uint64_t aSeed = 0, std::uint64_t aStream = 0);
+
+	result_type operator()();
+
+	Random Fork(std::uint64_t aKey) const;
+
+	std::uint64_t GetSeed() const { return mySeed; }
+	std::uint64_t GetStream() const { return myStream; }
+
+private:
+	std::uint64_t mySeed = 0;
+	std::uint64_t myStream = 0;
+
+	std::uint64_t myState = 0;
+	std::uint64_t myIncrement = 0;
+};
+
+}
@@ -1,57 +1,114 @@
 #include "Specie.h"
 
+#include "Checkpoint.h"
 #include "EvolutionParams.h"
 #include "Genome.h"
 
+#include <algorithm>
+
 namespace Neat {
 
-bool Specie::BelongsToSpecie(const Genome* aGenome) const
+void Specie::WriteCheckpoint(CheckpointWriter& aWriter) const
 {
-	if (myGenomes.empty())
-		return false;
+	aWriter.Write(myBestFitness);
+	aWriter.Write(myFitnessRecord);
+	aWriter.Write(myAge);
+	aWriter.Write(myLastImprovementAge);
+	aWriter.Write(myShouldExctinct);
+}
+
+bool Specie::ReadCheckpoint(CheckpointReader& aReader)
+{
+	aReader.Read(myBestFitness);
+	aReader.Read(myFitnessRecord);
+	aReader.Read(myAge);
+	aReader.Read(myLastImprovementAge);
+	aReader.Read(myShouldExctinct);
+	return aReader.IsValid();
+}
+
+double Specie::ComputeDistance(const Genome* aGenome1, const Genome* aGenome2, const EvolutionParams& someParams, double aMaxDistance /*= DBL_MAX*/)
+{
+	const std::vector<Link>& links1 = aGenome1->GetLinks();
+	const std::vector<Link>& links2 = aGenome2->GetLinks();
+
+	// The original paper divides the non matching genes count by the genes count of the largest genome, except for small genomes
+	double nonMatchingGeneCoeff = someParams.myNonMatchingGeneCoeff;
+	size_t genesCount = std::max(links1.size(), links2.size());
+	if (someParams.myNormalizeSpecieDistance && genesCount >= someParams.myNormalizeSpecieDistanceMinGenes)
+		nonMatchingGeneCoeff /= genesCount;
 
-	std::uniform_int_distribution<> rand(0, (int)myGenomes.size() - 1);
-	const Genome* representativeGenome = myGenomes[rand(EvolutionParams::GetRandomGenerator())];
-	
 	size_t matchingGenesCount = 0;
 	size_t nonMatchingGenesCount = 0;
 	double averageWeightDifference = 0.0;
 
-	for (auto it = representativeGenome->GetLinks().begin(); it != representativeGenome->GetLinks().end(); ++it)
-	{
-		std::uint64_t innovationId = it->first;
-		const Link& representativeLink = it->second;
+	// The non matching genes count can only grow, by at least the difference of the remaining genes counts,
+	// and the weight term is positive, so the computation can stop once this lower bound reaches the max distance
+	auto getLowerBound = [&](size_t i, size_t j) {
+		size_t remaining1 = links1.size() - i;
+		size_t remaining2 = links2.size() - j;
+		size_t minNonMatchingGenesCount = nonMatchingGenesCount + (remaining1 > remaining2 ? remaining1 - remaining2 : remaining2 - remaining1);
+		return nonMatchingGeneCoeff * minNonMatchingGenesCount;
+	};
 
-		auto it2 = aGenome->GetLinks().find(innovationId);
-		if (it2 != aGenome->GetLinks().end())
+	double lowerBound = getLowerBound(0, 0);
+	if (lowerBound >= aMaxDistance)
+		return lowerBound;
+
+	// Both genomes are sorted by innovation id, so the genes are compared with a single merge
+	size_t i = 0;
+	size_t j = 0;
+	while (i < links1.size() && j < links2.size())
+	{
+		if (links1[i].GetInnovationId() == links2[j].GetInnovationId())
 		{
 			// Common gene
 			matchingGenesCount++;
-			averageWeightDifference += std::abs(representativeLink.GetWeight() - it2->second.GetWeight());
+			averageWeightDifference += std::abs(links1[i].GetWeight() - links2[j].GetWeight());
+			++i;
+			++j;
+			continue;
 		}
+
+		// Disjoint gene
+		nonMatchingGenesCount++;
+		if (links1[i].GetInnovationId() < links2[j].GetInnovationId())
+			++i;
 		else
-		{
-			// Disjoint or Excess gene
-			nonMatchingGenesCount++;
-		}
-	}
-	for (auto it = aGenome->GetLinks().begin(); it != aGenome->GetLinks().end(); ++it)
-	{
-		std::uint64_t innovationId = it->first;
-		auto it2 = representativeGenome->GetLinks().find(innovationId);
-		if (it2 == representativeGenome->GetLinks().end())
-		{
-			// Disjoint or Excess gene
-			nonMatchingGenesCount++;
-		}
+			++j;
+
+		lowerBound = getLowerBound(i, j);
+		if (lowerBound >= aMaxDistance)
+			return lowerBound;
 	}
+	// Excess genes
+	nonMatchingGenesCount += (links1.size() - i) + (links2.size() - j);
 
 	if (matchingGenesCount > 0)
 		averageWeightDifference /= matchingGenesCount;
 
-	return (EvolutionParams::ourMatchingGeneCoeff * averageWeightDifference
-		+ EvolutionParams::ourNonMatchingGeneCoeff * nonMatchingGenesCount) // TODO : Note the original paper divides by the genes count
-		< EvolutionParams::ourSpecieThreshold;
+	return someParams.myMatchingGeneCoeff * averageWeightDifference
+		+ nonMatchingGeneCoeff * nonMatchingGenesCount;
+}
+
+void Specie::ChooseRepresentative(Random& aRandom)
+{
+	if (myGenomes.empty())
+	{
+		myRepresentative = nullptr;
+		return;
+	}
+
+	std::uniform_int_distribution<> rand(0, (int)myGenomes.size() - 1);
+	myRepresentative = myGenomes[rand(aRandom)];
+}
+
+bool Specie::BelongsToSpecie(const Genome* aGenome) const
+{
+	if (!myRepresentative)
+		return false;
+
+	return ComputeDistance(myRepresentative, aGenome, myParams, myParams.mySpecieThreshold) < myParams.mySpecieThreshold;
 }
 
 void Specie::ComputeBestFitness()
@@ -74,10 +131,10 @@ void Specie::AdjustFitness()
 		double adjustedFitness = genome->GetFitness();
 
 		if (myShouldExctinct || IsStagnant())
-			adjustedFitness *= EvolutionParams::ourSpecieStagnantPenality;
+			adjustedFitness *= myParams.mySpecieStagnantPenality;
 
 		if (IsNew())
-			adjustedFitness *= EvolutionParams::ourSpecieNewBonus;
+			adjustedFitness *= myParams.mySpecieNewBonus;
 
 		if (adjustedFitness < DBL_EPSILON)
 			adjustedFitness = DBL_EPSILON;
@@ -90,10 +147,7 @@ void Specie::AdjustFitness()
 
 size_t Specie::ComputeOffspringsCount(double anAverageAdjustedFitness)
 {
-	double adjustedFitnessSum = 0.0;
-	for (const Genome* genome : myGenomes)
-		adjustedFitnessSum += genome->GetAdjustedFitness();
-	myOffspringsCount = static_cast<size_t>(adjustedFitnessSum / anAverageAdjustedFitness);
+	myOffspringsCount = static_cast<size_t>(GetAdjustedFitnessSum() / anAverageAdjustedFitness);
 	return myOffspringsCount;
 }
 
@@ -103,58 +157,107 @@ void Specie::ResetEvolution(size_t anOffspringsCount)
 	myLastImprovementAge = myAge;
 }
 
-void Specie::GenerateOffsprings()
+size_t Specie::PrepareOffsprings()
 {
 	if (myOffspringsCount == 0)
-		return;
+		return 0;
 
-	size_t countGenomesToMate = static_cast<size_t>(std::ceil(EvolutionParams::ourAmountGenomesToKeep * myGenomes.size()));
+	size_t countGenomesToMate = ComputeParentsCount();
 	myGenomes.resize(countGenomesToMate);
 
 	if (countGenomesToMate == 0)
-		return;
+	{
+		myOffspringsCount = 0;
+		return 0;
+	}
 
+	SetParentsCount(countGenomesToMate);
+	myOffsprings.resize(myOffspringsCount);
+	myOffspringsCount = 0;
+	return myOffsprings.size();
+}
+
+void Specie::GenerateOffspring(size_t anOffspringIdx, Random& aRandom, std::uint64_t aFirstInnovationId)
+{
 	// Copy the best genome as is for the next generation
-	myOffsprings.push_back(Genome(*myGenomes[0]));
-	myOffspringsCount--;
+	if (anOffspringIdx == 0)
+	{
+		myOffsprings[0] = *myGenomes[0];
+		return;
+	}
+
+	BreedOffspring(myOffsprings[anOffspringIdx], aRandom, aFirstInnovationId);
+}
+
+void Specie::PrepareParents()
+{
+	ComputeBestFitness();
+	SetParentsCount(std::min(ComputeParentsCount(), myGenomes.size()));
+}
 
-	// Generate as many offsprings as needed
-	// randomly choose if we want only mutation or crossover
+void Specie::SetParentsCount(size_t aParentsCount)
+{
+	// The genomes are sorted by ComputeBestFitness
+	myParentsCount = aParentsCount;
+	myTotalFitness = 0.0;
+	for (size_t i = 0; i < myParentsCount; ++i)
+		myTotalFitness += myGenomes[i]->GetFitness();
+}
+
+void Specie::BreedOffspring(Genome& anOutOffspring, Random& aRandom, std::uint64_t aFirstInnovationId) const
+{
+	// Randomly choose if we want only mutation or crossover
 	// and select the parent(s) randomly, weighted by their fitness to favor performing genomes
-	double totalFitness = 0.0;
-	for (const Genome* genome : myGenomes)
-		totalFitness += genome->GetFitness();
-	std::uniform_real_distribution<> rand(0.0, totalFitness);
-	auto getWeightedRandomGenome = [totalFitness, &rand, this]() -> const Genome* {
-		double rng = rand(EvolutionParams::GetRandomGenerator());
+	auto getWeightedRandomGenome = [&aRandom, this]() -> const Genome* {
+		std::uniform_real_distribution<> rand(0.0, myTotalFitness);
+		double rng = rand(aRandom);
 		double cumulFitness = 0.0;
-		for (const Genome* genome : myGenomes)
+		for (size_t i = 0; i < myParentsCount; ++i)
 		{
-			cumulFitness += genome->GetFitness();
+			cumulFitness += myGenomes[i]->GetFitness();
 			if (cumulFitness >= rng)
-				return genome;
+				return myGenomes[i];
 		}
 		// Can't happen
 		return myGenomes[0];
 	};
 
-	while (myOffspringsCount > 0)
+	std::uniform_real_distribution<> rand2(0.0, 1.0);
+	if (rand2(aRandom) < myParams.mySingleParentReproductionProba)
 	{
-		std::uniform_real_distribution<> rand2(0.0, 1.0);
-		if (rand2(EvolutionParams::GetRandomGenerator()) < EvolutionParams::ourSingleParentReproductionProba)
-		{
-			// Offspring from one parent (mutation only)
-			Genome& offspring = myOffsprings.emplace_back(*getWeightedRandomGenome());
-			offspring.Mutate();
-		}
-		else
-		{
-			// Offspring from two parents + mutation
-			Genome& offspring = myOffsprings.emplace_back(getWeightedRandomGenome(), getWeightedRandomGenome());
-			offspring.Mutate();
-		}
-		myOffspringsCount--;
+		// Offspring from one parent (mutation only)
+		anOutOffspring = *getWeightedRandomGenome();
+	}
+	else
+	{
+		// Offspring from two parents + mutation
+		const Genome* parent1 = getWeightedRandomGenome();
+		const Genome* parent2 = getWeightedRandomGenome();
+		anOutOffspring = Genome(parent1, parent2, aRandom);
 	}
+	anOutOffspring.Mutate(aRandom, myParams, aFirstInnovationId);
+}
+
+double Specie::GetAdjustedFitnessSum() const
+{
+	double adjustedFitnessSum = 0.0;
+	for (const Genome* genome : myGenomes)
+		adjustedFitnessSum += genome->GetAdjustedFitness();
+	return adjustedFitnessSum;
+}
+
+size_t Specie::ComputeParentsCount() const
+{
+	return static_cast<size_t>(std::ceil(myParams.myAmountGenomesToKeep * myGenomes.size()));
+}
+
+void Specie::RemoveGenome(const Genome* aGenome)
+{
+	auto it = std::find(myGenomes.begin(), myGenomes.end(), aGenome);
+	if (it != myGenomes.end())
+		myGenomes.erase(it);
+	if (myRepresentative == aGenome)
+		myRepresentative = nullptr;
 }
 
 void Specie::CollectOffsprings(std::vector<Genome>& someOutOffsprings)
@@ -167,17 +270,17 @@ void Specie::CollectOffsprings(std::vector<Genome>& someOutOffsprings)
 
 bool Specie::IsNew() const
 {
-	return myAge <= EvolutionParams::ourSpecieNewThreshold;
+	return myAge <= myParams.mySpecieNewThreshold;
 }
 
 bool Specie::IsOld() const
 {
-	return myAge > EvolutionParams::ourSpecieOldThreshold;
+	return myAge > myParams.mySpecieOldThreshold;
 }
 
 bool Specie::IsStagnant() const
 {
-	return myAge - myLastImprovementAge > EvolutionParams::ourSpecieStagnantThreshold;
+	return myAge - myLastImprovementAge > myParams.mySpecieStagnantThreshold;
 }
 
 }
@@ -1,19 +1,46 @@
 #pragma once
 
+#include "Random.h"
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 namespace Neat {
 
+class CheckpointReader;
+class CheckpointWriter;
+class EvolutionParams;
 class Genome;
 
 class Specie
 {
 public:
+	// The params of the population, which outlives its species. anId is unique in the population, unlike the address
+	// of a specie which can be reused by a new one once it is deleted
+	Specie(const EvolutionParams& someParams, std::uint64_t anId) : myParams(someParams), myId(anId) {}
+
+	std::uint64_t GetId() const { return myId; }
+
 	size_t GetSize() const { return myGenomes.size(); }
+
+	// Evolution state for the population checkpoints, the genomes are regrouped at the start of each generation
+	void WriteCheckpoint(CheckpointWriter& aWriter) const;
+	bool ReadCheckpoint(CheckpointReader& aReader);
+
+	// Compatibility distance between two genomes, the computation stops as soon as the distance reaches aMaxDistance,
+	// in which case the returned value is only a lower bound of the distance
+	static double ComputeDistance(const Genome* aGenome1, const Genome* aGenome2, const EvolutionParams& someParams, double aMaxDistance = DBL_MAX);
+
+	// The representative is fixed for the whole generation
+	void ChooseRepresentative(Random& aRandom);
+	const Genome* GetRepresentative() const { return myRepresentative; }
 	bool BelongsToSpecie(const Genome* aGenome) const;
 
 	void AddGenome(Genome* aGenome) { myGenomes.push_back(aGenome); }
-	void ClearGenomes() { myGenomes.clear(); }
+	void RemoveGenome(const Genome* aGenome);
+	void ClearGenomes() { myGenomes.clear(); myRepresentative = nullptr; }
 
 	double GetBestFitness() const { return myBestFitness; }
 	void ComputeBestFitness();
@@ -23,9 +50,19 @@ public:
 	void AllowExtraOffsprings(size_t anExtraOffspringsCount) { myOffspringsCount += anExtraOffspringsCount; }
 	void ResetEvolution(size_t anOffspringsCount);
 
-	void GenerateOffsprings();
+	// Keeps the best genomes as parents and allocates the offspring slots, returns the slots count
+	size_t PrepareOffsprings();
+	// Fills one slot, different slots can be generated in parallel
+	void GenerateOffspring(size_t anOffspringIdx, Random& aRandom, std::uint64_t aFirstInnovationId);
+	Genome& GetOffspring(size_t anOffspringIdx) { return myOffsprings[anOffspringIdx]; }
 	void CollectOffsprings(std::vector<Genome>& someOutOffsprings);
 
+	// Steady-state training: the genomes change one by one, the parents are updated after each change instead of
+	// being truncated once per generation, and an offspring is bred from them like the slots of GenerateOffspring
+	void PrepareParents(); // Sorts the genomes, see ComputeBestFitness
+	void BreedOffspring(Genome& anOutOffspring, Random& aRandom, std::uint64_t aFirstInnovationId) const;
+	double GetAdjustedFitnessSum() const;
+
 	bool IsNew() const;
 	bool IsOld() const;
 	bool IsStagnant() const;
@@ -33,7 +70,13 @@ public:
 	void Age() { myAge++; }
 
 private:
+	size_t ComputeParentsCount() const;
+	void SetParentsCount(size_t aParentsCount);
+
+	const EvolutionParams& myParams;
+	std::uint64_t myId = 0;
 	std::vector<Genome*> myGenomes;
+	const Genome* myRepresentative = nullptr;
 	double myBestFitness = 0.0;
 	double myFitnessRecord = 0.0;
 
@@ -42,6 +85,8 @@ private:
 	bool myShouldExctinct = false;
 
 	size_t myOffspringsCount = 0;
+	size_t myParentsCount = 0; // The best genomes, first in myGenomes
+	double myTotalFitness = 0.0; // Of the parents
 	std::vector<Genome> myOffsprings;
 };
 
@@ -0,0 +1,211 @@
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace Neat {
+
+namespace
+{
+	// Field of a record, in the CSV and JSON column order
+	struct Column
+	{
+		const char* myName;
+		double (*myGetValue)(const Telemetry::GenerationRecord& aRecord);
+	};
+
+	template<Telemetry::Phase aPhase>
+	double GetPhaseDurationSec(const Telemetry::GenerationRecord& aRecord)
+	{
+		return aRecord.myPhaseDurationsSec[static_cast<size_t>(aPhase)];
+	}
+
+	const Column ourColumns[] = {
+		{ "generation", [](const Telemetry::GenerationRecord& aRecord) { return static_cast<double>(aRecord.myGeneration); } },
+		{ "durationSec", [](const Telemetry::GenerationRecord& aRecord) { return aRecord.myDurationSec; } },
+		{ "speciationSec", GetPhaseDurationSec<Telemetry::Phase::Speciation> },
+		{ "evaluationSec", GetPhaseDurationSec<Telemetry::Phase::Evaluation> },
+		{ "fitnessAdjustmentSec", GetPhaseDurationSec<Telemetry::Phase::FitnessAdjustment> },
+		{ "reproductionSec", GetPhaseDurationSec<Telemetry::Phase::Reproduction> },
+		{ "checkSec", GetPhaseDurationSec<Telemetry::Phase::Check> },
+		{ "genomes", [](const Telemetry::GenerationRecord& aRecord) { return static_cast<double>(aRecord.myGenomesCount); } },
+		{ "species", [](const Telemetry::GenerationRecord& aRecord) { return static_cast<double>(aRecord.mySpeciesCount); } },
+		{ "evaluations", [](const Telemetry::GenerationRecord& aRecord) { return static_cast<double>(aRecord.myEvaluationsCount); } },
+		{ "evaluationsPerSec", [](const Telemetry::GenerationRecord& aRecord) { return aRecord.myEvaluationsPerSec; } },
+		{ "bestFitness", [](const Telemetry::GenerationRecord& aRecord) { return aRecord.myBestFitness; } },
+		{ "minLinks", [](const Telemetry::GenerationRecord& aRecord) { return static_cast<double>(aRecord.myMinLinksCount); } },
+		{ "medianLinks", [](const Telemetry::GenerationRecord& aRecord) { return static_cast<double>(aRecord.myMedianLinksCount); } },
+		{ "maxLinks", [](const Telemetry::GenerationRecord& aRecord) { return static_cast<double>(aRecord.myMaxLinksCount); } },
+		{ "averageLinks", [](const Telemetry::GenerationRecord& aRecord) { return aRecord.myAverageLinksCount; } },
+		{ "averageNodes", [](const Telemetry::GenerationRecord& aRecord) { return aRecord.myAverageNodesCount; } },
+		{ "maxNodes", [](const Telemetry::GenerationRecord& aRecord) { return static_cast<double>(aRecord.myMaxNodesCount); } },
+	};
+}
+
+const char* Telemetry::GetPhaseName(Phase aPhase)
+{
+	switch (aPhase)
+	{
+	case Phase::Speciation: return "speciation";
+	case Phase::Evaluation: return "evaluation";
+	case Phase::FitnessAdjustment: return "fitnessAdjustment";
+	case Phase::Reproduction: return "reproduction";
+	case Phase::Check: return "check";
+	default: return "";
+	}
+}
+
+Telemetry::Telemetry(size_t aCapacity /*= 4096*/)
+	: myCapacity(std::max<size_t>(aCapacity, 1))
+	, mySlots(std::make_unique<Slot[]>(myCapacity))
+{
+}
+
+Telemetry::~Telemetry() = default;
+
+void Telemetry::BeginGeneration(std::int64_t aGeneration)
+{
+	myPendingRecord = GenerationRecord();
+	myPendingRecord.myGeneration = aGeneration;
+	myIsGenerationPending = true;
+}
+
+void Telemetry::AddPhaseDuration(Phase aPhase, double aDurationSec)
+{
+	if (myIsGenerationPending)
+		myPendingRecord.myPhaseDurationsSec[static_cast<size_t>(aPhase)] += aDurationSec;
+}
+
+void Telemetry::CommitGeneration()
+{
+	if (!myIsGenerationPending)
+		return;
+	myIsGenerationPending = false;
+
+	std::uint64_t words[ourRecordWordsCount];
+	std::memcpy(words, &myPendingRecord, sizeof(words));
+
+	std::uint64_t recordIdx = myCommittedCount.load(std::memory_order_relaxed);
+	Slot& slot = mySlots[recordIdx % myCapacity];
+	slot.mySequence.store(2 * recordIdx + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	for (size_t i = 0; i < ourRecordWordsCount; ++i)
+		slot.myWords[i].store(words[i], std::memory_order_relaxed);
+	slot.mySequence.store(2 * recordIdx + 2, std::memory_order_release);
+
+	// Only this thread writes the totals
+	for (size_t phase = 0; phase < myPhaseTotalDurationsSec.size(); ++phase)
+		myPhaseTotalDurationsSec[phase].store(myPhaseTotalDurationsSec[phase].load(std::memory_order_relaxed) + myPendingRecord.myPhaseDurationsSec[phase], std::memory_order_relaxed);
+
+	myCommittedCount.store(recordIdx + 1, std::memory_order_release);
+}
+
+void Telemetry::Clear()
+{
+	myIsGenerationPending = false;
+	myCommittedCount.store(0, std::memory_order_release);
+
+	// The readers of a cleared slot fail like for an overwritten one
+	for (size_t i = 0; i < myCapacity; ++i)
+		mySlots[i].mySequence.store(0, std::memory_order_release);
+	for (std::atomic<double>& totalSec : myPhaseTotalDurationsSec)
+		totalSec.store(0.0, std::memory_order_relaxed);
+}
+
+bool Telemetry::GetRecord(std::uint64_t aRecordIdx, GenerationRecord& anOutRecord) const
+{
+	// The slot holds the record from the end of its write until the writer starts the next record of the slot
+	const Slot& slot = mySlots[aRecordIdx % myCapacity];
+	std::uint64_t expectedSequence = 2 * aRecordIdx + 2;
+	if (slot.mySequence.load(std::memory_order_acquire) != expectedSequence)
+		return false;
+
+	std::uint64_t words[ourRecordWordsCount];
+	for (size_t i = 0; i < ourRecordWordsCount; ++i)
+		words[i] = slot.myWords[i].load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (slot.mySequence.load(std::memory_order_relaxed) != expectedSequence)
+		return false;
+
+	std::memcpy(&anOutRecord, words, sizeof(words));
+	return true;
+}
+
+std::uint64_t Telemetry::CopyRecords(std::vector<GenerationRecord>& someOutRecords, std::uint64_t aFirstRecordIdx /*= 0*/) const
+{
+	std::uint64_t recordsCount = GetRecordsCount();
+	if (recordsCount > myCapacity)
+		aFirstRecordIdx = std::max<std::uint64_t>(aFirstRecordIdx, recordsCount - myCapacity);
+
+	// The records overwritten during the copy are skipped
+	GenerationRecord record;
+	for (std::uint64_t i = aFirstRecordIdx; i < recordsCount; ++i)
+	{
+		if (GetRecord(i, record))
+			someOutRecords.push_back(record);
+	}
+	return std::max(aFirstRecordIdx, recordsCount);
+}
+
+double Telemetry::GetPhaseTotalDurationSec(Phase aPhase) const
+{
+	return myPhaseTotalDurationsSec[static_cast<size_t>(aPhase)].load(std::memory_order_relaxed);
+}
+
+bool Telemetry::SaveCsv(const char* aFilePath) const
+{
+	std::vector<GenerationRecord> records;
+	CopyRecords(records);
+
+	std::ofstream file(aFilePath);
+	if (!file.is_open())
+		return false;
+
+	file.precision(std::numeric_limits<double>::max_digits10);
+	for (size_t i = 0; i < std::size(ourColumns); ++i)
+		file << (i > 0 ? "," : "") << ourColumns[i].myName;
+	file << std::endl;
+
+	for (const GenerationRecord& record : records)
+	{
+		for (size_t i = 0; i < std::size(ourColumns); ++i)
+			file << (i > 0 ? "," : "") << ourColumns[i].myGetValue(record);
+		file << std::endl;
+	}
+	return file.good();
+}
+
+bool Telemetry::SaveJson(const char* aFilePath) const
+{
+	std::vector<GenerationRecord> records;
+	CopyRecords(records);
+
+	std::ofstream file(aFilePath);
+	if (!file.is_open())
+		return false;
+
+	// JSON has no infinity nor NaN
+	file.precision(std::numeric_limits<double>::max_digits10);
+	file << "{" << std::endl << "\t\"generations\": [";
+	for (size_t r = 0; r < records.size(); ++r)
+	{
+		file << (r > 0 ? "," : "") << std::endl << "\t\t{ ";
+		for (size_t i = 0; i < std::size(ourColumns); ++i)
+		{
+			double value = ourColumns[i].myGetValue(records[r]);
+			file << (i > 0 ? ", " : "") << "\"" << ourColumns[i].myName << "\": ";
+			if (std::isfinite(value))
+				file << value;
+			else
+				file << "null";
+		}
+		file << " }";
+	}
+	file << std::endl << "\t]" << std::endl << "}" << std::endl;
+	return file.good();
+}
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Neat {
+
+// Per generation measures of a population, see Population::SetTelemetry.
+// The records are kept in a fixed-size ring buffer written by the training thread, which any other thread can read while
+// the training runs: the reads never block the writer, they retry the records being overwritten meanwhile.
+class Telemetry
+{
+public:
+	enum class Phase
+	{
+		Speciation,
+		Evaluation, // Including the fitness cache
+		FitnessAdjustment, // The best fitnesses and the offsprings counts of the species
+		Reproduction,
+		Check, // Population::Check, when called during the generation e.g. by myOnTrainGenerationEnd
+		Count,
+	};
+	static const char* GetPhaseName(Phase aPhase);
+
+	// Only made of 8 bytes fields, to be copied word by word with atomics
+	struct GenerationRecord
+	{
+		std::int64_t myGeneration = 0;
+		std::array<double, static_cast<size_t>(Phase::Count)> myPhaseDurationsSec = {};
+		double myDurationSec = 0.0; // Of the whole generation, with the callbacks
+
+		std::uint64_t myGenomesCount = 0;
+		std::uint64_t mySpeciesCount = 0;
+		std::uint64_t myEvaluationsCount = 0; // The fitness cache hits are not evaluated
+		double myEvaluationsPerSec = 0.0; // Over the evaluation phase
+		double myBestFitness = 0.0;
+
+		// Links of the evaluated genomes, enabled or not
+		std::uint64_t myMinLinksCount = 0;
+		std::uint64_t myMedianLinksCount = 0;
+		std::uint64_t myMaxLinksCount = 0;
+		double myAverageLinksCount = 0.0;
+		double myAverageNodesCount = 0.0;
+		std::uint64_t myMaxNodesCount = 0;
+	};
+
+	explicit Telemetry(size_t aCapacity = 4096); // The last aCapacity generations are kept
+	~Telemetry();
+
+	Telemetry(const Telemetry&) = delete;
+	Telemetry& operator=(const Telemetry&) = delete;
+
+	size_t GetCapacity() const { return myCapacity; }
+
+	// Writer side, only called by the training thread of the population
+	void BeginGeneration(std::int64_t aGeneration);
+	GenerationRecord& GetPendingRecord() { return myPendingRecord; } // Filled until CommitGeneration
+	void AddPhaseDuration(Phase aPhase, double aDurationSec); // Ignored out of a generation
+	void CommitGeneration();
+	// Forgets the records and the totals, between two trainings. The readers continuing from a record index start over.
+	void Clear();
+
+	// Reader side, from any thread. The records are numbered from 0 in commit order, only the last GetCapacity are kept.
+	std::uint64_t GetRecordsCount() const { return myCommittedCount.load(std::memory_order_acquire); }
+	bool GetRecord(std::uint64_t aRecordIdx, GenerationRecord& anOutRecord) const; // False if not committed or overwritten
+	// Appends the kept records from aFirstRecordIdx, returns the index following the last one, to continue from
+	std::uint64_t CopyRecords(std::vector<GenerationRecord>& someOutRecords, std::uint64_t aFirstRecordIdx = 0) const;
+	// Sum over all the committed generations, including the ones no longer kept
+	double GetPhaseTotalDurationSec(Phase aPhase) const;
+
+	// Exports the kept records, one line per generation for the CSV
+	bool SaveCsv(const char* aFilePath) const;
+	bool SaveJson(const char* aFilePath) const;
+
+private:
+	static constexpr size_t ourRecordWordsCount = sizeof(GenerationRecord) / sizeof(std::uint64_t);
+	static_assert(sizeof(GenerationRecord) % sizeof(std::uint64_t) == 0);
+
+	// Sequence lock: the sequence is odd while the slot is written, and tells which record the slot holds
+	struct Slot
+	{
+		std::atomic<std::uint64_t> mySequence = 0;
+		std::array<std::atomic<std::uint64_t>, ourRecordWordsCount> myWords;
+	};
+
+	size_t myCapacity = 0;
+	std::unique_ptr<Slot[]> mySlots;
+	std::atomic<std::uint64_t> myCommittedCount = 0;
+	std::array<std::atomic<double>, static_cast<size_t>(Phase::Count)> myPhaseTotalDurationsSec = {};
+
+	GenerationRecord myPendingRecord;
+	bool myIsGenerationPending = false;
+};
+
+}
@@ -1,6 +1,8 @@
 #include "Core_Thread.h"
 
+#if defined(_WIN32)
 #include <windows.h>
+#endif
 
 namespace Thread
 {
@@ -30,6 +32,8 @@ namespace Thread
 	{
 		myWorkerThread = std::thread(&Worker::RunJobs, this);
 
+		// The other platforms keep the default priority and name
+#if defined(_WIN32)
 		int priority = THREAD_PRIORITY_NORMAL;
 		switch (myPool->myWorkersPriority)
 		{
@@ -52,6 +56,7 @@ namespace Thread
 			workerName += std::to_wstring(myPool->myWorkers.size());
 			SetThreadDescription(myWorkerThread.native_handle(), workerName.c_str());
 		}
+#endif
 #endif
 	}
 
@@ -198,6 +203,27 @@ namespace Thread
 		}
 	}
 
+	void WorkerPool::ParallelFor(size_t aCount, const std::function<void(size_t)>& aJob)
+	{
+		if (myWorkers.empty())
+		{
+			for (size_t i = 0; i < aCount; ++i)
+				aJob(i);
+			return;
+		}
+
+		// Every worker picks the next index until all are done, which balances jobs of uneven durations
+		std::atomic<size_t> nextIdx = 0;
+		for (uint i = 0; i < myWorkers.size(); ++i)
+		{
+			RequestJob([&nextIdx, aCount, &aJob]() {
+				for (size_t idx = nextIdx++; idx < aCount; idx = nextIdx++)
+					aJob(idx);
+			}, i);
+		}
+		WaitIdle();
+	}
+
 	bool WorkerPool::AssignJobTo(Worker* aWorker)
 	{
 		std::lock_guard<std::mutex> lock(myWaitingJobQueueMutex);
@@ -220,6 +246,8 @@ namespace Thread
 		mySleepIntervalMs = aSleepIntervalMs;
 		myThread = std::thread(&WorkerThread::Run, this);
 
+		// The other platforms keep the default priority and name
+#if defined(_WIN32)
 		int priority = THREAD_PRIORITY_NORMAL;
 		switch (aPriority)
 		{
@@ -240,6 +268,9 @@ namespace Thread
 			std::wstring name = std::wstring(myThreadName.begin(), myThreadName.end());
 			SetThreadDescription(myThread.native_handle(), name.c_str());
 		}
+#endif
+#else
+		(void)aPriority;
 #endif
 	}
 
@@ -1,13 +1,37 @@
 #include "Core_Utils.h"
 
-#if DEBUG_BUILD
+#include <cstdarg>
+#include <cstdio>
+
+#if DEBUG_BUILD && defined(_WIN32)
 #include <crtdbg.h>
 #endif
 
 void InitMemoryLeaksDetection()
 {
-#if DEBUG_BUILD
+#if DEBUG_BUILD && defined(_WIN32)
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 	_CrtSetReportMode(_CRT_WARN, _CRTDBG_MODE_DEBUG);
 #endif
 }
+
+std::string FormatString(const char* aFormat, ...)
+{
+	va_list vaArgs;
+	va_start(vaArgs, aFormat);
+
+	va_list vaCopy;
+	va_copy(vaCopy, vaArgs);
+	int len = std::vsnprintf(NULL, 0, aFormat, vaCopy);
+	va_end(vaCopy);
+
+	std::string result;
+	if (len > 0)
+	{
+		result.resize((size_t)len + 1);
+		std::vsnprintf(result.data(), result.size(), aFormat, vaArgs);
+		result.resize((size_t)len);
+	}
+	va_end(vaArgs);
+	return result;
+}
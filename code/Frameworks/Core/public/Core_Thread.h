@@ -47,6 +47,9 @@ namespace Thread
 		void WaitForJob(JobHandle aJobHandle);
 		void WaitIdle();
 
+		// Runs aJob for every index in [0, aCount) over all the workers, and waits for them
+		void ParallelFor(size_t aCount, const std::function<void(size_t)>& aJob);
+
 	private:
 		struct Worker
 		{
@@ -16,3 +16,10 @@ inline uint Align(uint aValue, uint aAlignment)
 #define newDebug new
 #endif
 void InitMemoryLeaksDetection();
+
+// printf-like formatting into a string, unlike std::format it is available on all the compilers of the tools
+#if defined(__GNUC__)
+std::string FormatString(const char* aFormat, ...) __attribute__((format(printf, 1, 2)));
+#else
+std::string FormatString(const char* aFormat, ...);
+#endif